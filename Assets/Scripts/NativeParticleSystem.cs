@@ -90,7 +90,7 @@ public class ParticleInitState
 public class ParticleSystremUpdateData
 {
     public Matrix4x4 worldMatrix;
-    public int index;
+    public int handle;
 }
 
 public class NativeParticleSystem : MonoBehaviour
@@ -123,10 +123,13 @@ public enum ERenderType : byte
     private static extern void SetTextureFromUnity(System.IntPtr texture);
 
     [DllImport(NativePlugin.PluginName)]
-    private static extern void Native_Render(int index, byte renderType);
+    private static extern void Native_Render(int handle, byte renderType);
 
     [DllImport(NativePlugin.PluginName)]
-    private static extern void Native_SetActive(int index, bool isActive);
+    private static extern void Native_SetActive(int handle, bool isActive);
+
+    [DllImport(NativePlugin.PluginName)]
+    private static extern void Native_DestroyParticleSystem(int handle);
 
     private Coroutine m_Coroutine = null;
     public ParticleInitState InitState = new ParticleInitState();
@@ -140,8 +143,8 @@ public enum ERenderType : byte
     // Use this for initialization
     void Awake()
     {
-        m_UpdateData.index = Internal_CreateParticleSystem(InitState);
-        Debug.Log("index:"+ m_UpdateData.index.ToString());
+        m_UpdateData.handle = Internal_CreateParticleSystem(InitState);
+        Debug.Log("handle:"+ m_UpdateData.handle.ToString());
         m_Coroutine = StartCoroutine(NativeUpdate());
     }
 
@@ -152,12 +155,12 @@ void Awake()
 
     private void OnEnable()
     {
-        Native_SetActive(m_UpdateData.index, true);
+        Native_SetActive(m_UpdateData.handle, true);
     }
 
     private void OnDisable()
     {
-        Native_SetActive(m_UpdateData.index, false);
+        Native_SetActive(m_UpdateData.handle, false);
     }
 
     void OnDestroy()
@@ -166,6 +169,9 @@ void OnDestroy()
             StopCoroutine(m_Coroutine);
 
         m_Coroutine = null;
+
+        Native_DestroyParticleSystem(m_UpdateData.handle);
+        m_UpdateData.handle = 0;
     }
 
     // Update is called once per frame
@@ -186,13 +192,18 @@ IEnumerator NativeUpdate()
         }
     }
 
+    // The transforms of all systems are sent in one call by NativePlugin before they are rendered
+    public void GetTransformUpdate(ref NativeTransformUpdate update)
+    {
+        update.worldMatrix = transform.localToWorldMatrix;
+        update.handle = m_UpdateData.handle;
+    }
+
     public void Render(ERenderType renderType)
     {
         m_Material.SetPass(0);
 
         Graphics.DrawMeshNow(m_Mesh, m_DefaultMeshPos, this.gameObject.transform.rotation);
-        m_UpdateData.worldMatrix = transform.localToWorldMatrix;
-        Internal_ParticleSystem_Update(m_UpdateData);
-        Native_Render(m_UpdateData.index, (byte)renderType);
+        Native_Render(m_UpdateData.handle, (byte)renderType);
     }
 }
@@ -13,6 +13,13 @@ class NativeUpdateData
     public Matrix4x4 viewMatrix; 
 }
 
+[StructLayoutAttribute(LayoutKind.Sequential)]
+public struct NativeTransformUpdate
+{
+    public Matrix4x4 worldMatrix;
+    public int handle;
+}
+
 public class NativePlugin : MonoBehaviour
 {
     public const string PluginName = "NativeParticleSystem";
@@ -25,6 +32,10 @@ public class NativePlugin : MonoBehaviour
     [DllImport(PluginName)]
     private static extern void ShutDown();
 
+    // Blittable array, pinned for the call instead of copied
+    [DllImport(PluginName)]
+    private static extern void Native_UpdateTransforms(NativeTransformUpdate[] updates, int count);
+
     [UnmanagedFunctionPointer(CallingConvention.StdCall)]
     private delegate void DebugLog(string log);
 
@@ -38,6 +49,8 @@ public class NativePlugin : MonoBehaviour
 
     private NativeUpdateData m_NativeUpdateData = new NativeUpdateData();
 
+    private NativeTransformUpdate[] m_TransformUpdates = new NativeTransformUpdate[0];
+
     // todo 
     public List<NativeParticleSystem> m_ParticleSystems = new List<NativeParticleSystem>();
 
@@ -59,6 +72,14 @@ void Update()
 
     void OnPostRender()
     {
+        int count = m_ParticleSystems.Count;
+        if (m_TransformUpdates.Length < count)
+            m_TransformUpdates = new NativeTransformUpdate[Mathf.NextPowerOfTwo(count)];
+
+        for (int i = 0; i < count; ++i)
+            m_ParticleSystems[i].GetTransformUpdate(ref m_TransformUpdates[i]);
+        Native_UpdateTransforms(m_TransformUpdates, count);
+
         for (int i = 0; i < m_ParticleSystems.Count; ++i)
         {
             NativeParticleSystem.ERenderType renderType = NativeParticleSystem.ERenderType.normal;
@@ -15,8 +15,11 @@
 #include "Mono/ScriptingAPI.h"
 #include "Input/TimeManager.h"
 #include "Jobs/JobSystem.h"
+#include "Allocator/MemoryManager.h"
+#include "Allocator/AllocationTracer.h"
+#include "Allocator/FrameAllocator.h"
 
-static void DoRender(int index, char renderType);
+static void DoRender(int handle, char renderType);
 void SetD3DDevice(IDirect3DDevice9* device, GfxDeviceEventType eventType);
 static void InitMono();
 static void* g_TexturePointer;
@@ -38,6 +41,8 @@ void Internal_Update(ScriptingObject* updateData)
 	SetDeltaTime(pUpdateData->deltaTime);
     g_ViewMatrix = pUpdateData->viewMatrix;
 	GetGfxDevice().SetViewMatrix(g_ViewMatrix);
+	EndMemoryLabelStatsFrame();
+	GetFrameAllocator().FrameMaintenance();
 	ParticleSystem::BeginUpdateAll();
 }
 
@@ -112,6 +117,7 @@ extern "C"
 		InitMonoSystem();
 		RegisterRenderingPluginBindings();
 		CreateJobSystem();
+		InitializeFrameAllocator();
 		ParticleSystem::Init();
 	}
 
@@ -119,6 +125,8 @@ extern "C"
 	{
 		SetDebugLog(nullptr);
 		ParticleSystem::ShutDown();
+		CleanupFrameAllocator();
+		AllocationTracer::Stop();
 	}
 
 	void EXPORT_API SetTextureFromUnity(void* texturePtr)
@@ -126,9 +134,48 @@ extern "C"
 		g_TexturePointer = texturePtr;
 	}
 
-	void EXPORT_API Native_Render(int index, char renderType)
+	void EXPORT_API Native_Render(int handle, char renderType)
 	{
-		DoRender(index, renderType);
+		DoRender(handle, renderType);
+	}
+
+	// Labels are the MemLabelIdentifier values, from 0 to Native_GetMemoryLabelCount() - 1
+	EXPORT_API int Native_GetMemoryLabelCount()
+	{
+		return kMemLabelCount;
+	}
+
+	EXPORT_API const char* Native_GetMemoryLabelName(int label)
+	{
+		return label >= 0 && label < kMemLabelCount ? MemLabelName[label] : NULL;
+	}
+
+	// Live counters and the counts of the last completed frame, see MemLabelStats. Lock-free, callable from any thread.
+	EXPORT_API bool Native_GetMemoryLabelStats(int label, MemLabelStats* stats)
+	{
+		if (label < 0 || label >= kMemLabelCount || stats == NULL)
+			return false;
+#if ENABLE_MEMORY_MANAGER
+		return GetMemoryManager().GetLabelStats((MemLabelIdentifier)label, *stats);
+#else
+		return GetMemoryLabelStats((MemLabelIdentifier)label, *stats);
+#endif
+	}
+
+	EXPORT_API void Native_ResetMemoryLabelPeaks()
+	{
+		ResetMemoryLabelPeaks();
+	}
+
+	// Writes about one in sampleInterval allocations to path, see AllocationTracer. Replay with Tools/AllocationTraceReplay.
+	EXPORT_API bool Native_StartAllocationTrace(const char* path, int sampleInterval)
+	{
+		return path != NULL && AllocationTracer::Start(path, sampleInterval);
+	}
+
+	EXPORT_API void Native_StopAllocationTrace()
+	{
+		AllocationTracer::Stop();
 	}
 }
 
@@ -200,7 +247,7 @@ enum
     kLastRender = 1 << 3
 };
 
-void DoRender(int index, char renderType)
+void DoRender(int handle, char renderType)
 {
 	DebugLog("Do Native Render!");
 
@@ -281,8 +328,8 @@ void DoRender(int index, char renderType)
         ParticleSystem::EndUpdateAll();
     }
 
-    ParticleSystem::Prepare(index);
-	ParticleSystem::Render(index);
+    ParticleSystem::Prepare(handle);
+	ParticleSystem::Render(handle);
 
     if (renderType & kLastRender)
 	    GetGfxDevice().InvalidateState();
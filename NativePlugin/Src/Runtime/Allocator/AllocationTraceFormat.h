@@ -0,0 +1,49 @@
+#ifndef ALLOCATION_TRACE_FORMAT_H_
+#define ALLOCATION_TRACE_FORMAT_H_
+
+// Binary stream written by AllocationTracer and replayed by Tools/AllocationTraceReplay.
+// Native endianness, all structs are naturally aligned so they are written as is.
+//
+//   AllocationTraceHeader
+//   labelCount times: UInt8 length, name characters
+//   records until the end of the file: AllocationTraceRecord, then frameCount UInt64 return addresses
+
+const char kAllocationTraceTag[4] = { 'P', 'S', 'A', 'T' };
+
+enum
+{
+	kAllocationTraceVersion = 1,
+	kAllocationTraceMaxFrames = 8,
+	kAllocationTraceNoLabel = 0xffff,
+};
+
+enum AllocationTraceEventType
+{
+	kAllocationTraceAllocate,
+	kAllocationTraceDeallocate,		// size is 0, the matching allocation has it
+	kAllocationTracePoolCreate,		// Memory reserved by an allocator to sub allocate from, never sampled
+	kAllocationTracePoolDestroy,
+};
+
+struct AllocationTraceHeader
+{
+	char tag[4];
+	UInt32 version;
+	UInt32 sampleInterval;		// About one in sampleInterval allocations is in the stream
+	UInt32 labelCount;
+	UInt64 moduleBase;			// Load address of the plugin, return addresses minus this are offsets into the binary
+	UInt64 timestampFrequency;	// Timestamp ticks per second
+};
+
+struct AllocationTraceRecord
+{
+	UInt8 type;					// AllocationTraceEventType
+	UInt8 frameCount;
+	UInt16 label;
+	UInt32 thread;				// Small index in order of the first traced event on the thread
+	UInt64 timestamp;
+	UInt64 address;
+	UInt64 size;
+};
+
+#endif // ALLOCATION_TRACE_FORMAT_H_
@@ -0,0 +1,206 @@
+#include "PluginPrefix.h"
+#include "Allocator/AllocationTracer.h"
+#include "Allocator/AllocationTraceFormat.h"
+#include "Threads/AtomicOps.h"
+#include "Threads/Mutex.h"
+#include "Threads/ThreadSpecificValue.h"
+#include <stdio.h>
+#include <string.h>
+
+#if UNITY_WIN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <time.h>
+#endif
+
+volatile int AllocationTracer::s_SampleInterval = 0;
+
+// Records are collected in a static buffer, the tracer must not allocate through the hooks it serves
+static const size_t kTraceBufferSize = 64 * 1024;
+static UInt8 s_TraceBuffer[kTraceBufferSize];
+static size_t s_TraceBufferUsed = 0;
+static FILE* s_TraceFile = NULL;
+static Mutex s_TraceMutex;
+
+static volatile int s_TraceThreadCount = 0;
+static UNITY_TLS_VALUE(int) s_TraceThreadIndex;		// 0 until the first traced event of the thread
+
+// CaptureFrames, WriteRecord and the AllocationTracer entry point, they are the same for every record
+static const int kSkippedFrames = 3;
+
+static UInt64 GetTraceTimestamp()
+{
+#if UNITY_WIN
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (UInt64)counter.QuadPart;
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (UInt64)now.tv_sec * 1000000000ULL + (UInt64)now.tv_nsec;
+#endif
+}
+
+static UInt64 GetTraceTimestampFrequency()
+{
+#if UNITY_WIN
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (UInt64)frequency.QuadPart;
+#else
+	return 1000000000ULL;
+#endif
+}
+
+static UInt64 GetModuleBase()
+{
+#if UNITY_WIN
+	HMODULE module = NULL;
+	GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&GetModuleBase, &module);
+	return (UInt64)(UIntPtr)module;
+#else
+	Dl_info info;
+	if (dladdr((void*)&GetModuleBase, &info) == 0)
+		return 0;
+	return (UInt64)(UIntPtr)info.dli_fbase;
+#endif
+}
+
+static int CaptureFrames(UInt64* frames)
+{
+	void* addresses[kAllocationTraceMaxFrames + kSkippedFrames];
+#if UNITY_WIN
+	const int count = CaptureStackBackTrace(kSkippedFrames, kAllocationTraceMaxFrames, addresses, NULL);
+	for (int i = 0; i < count; ++i)
+		frames[i] = (UInt64)(UIntPtr)addresses[i];
+	return count;
+#else
+	const int count = backtrace(addresses, kAllocationTraceMaxFrames + kSkippedFrames) - kSkippedFrames;
+	for (int i = 0; i < count; ++i)
+		frames[i] = (UInt64)(UIntPtr)addresses[i + kSkippedFrames];
+	return count > 0 ? count : 0;
+#endif
+}
+
+// Spreads the address bits so every alignment samples evenly, the low bits are always zero
+static inline bool IsSampled(const void* ptr, int sampleInterval)
+{
+	if (sampleInterval == 1)
+		return true;
+
+	UInt64 hash = (UInt64)(UIntPtr)ptr;
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return hash % (UInt64)sampleInterval == 0;
+}
+
+static void FlushTraceBuffer()
+{
+	if (s_TraceBufferUsed != 0 && s_TraceFile != NULL)
+		fwrite(s_TraceBuffer, 1, s_TraceBufferUsed, s_TraceFile);
+	s_TraceBufferUsed = 0;
+}
+
+static void WriteRecord(AllocationTraceEventType type, const void* address, size_t size, int label, bool captureFrames)
+{
+	int threadIndex = s_TraceThreadIndex;
+	if (threadIndex == 0)
+	{
+		threadIndex = AtomicIncrement(&s_TraceThreadCount);
+		s_TraceThreadIndex = threadIndex;
+	}
+
+	UInt64 frames[kAllocationTraceMaxFrames];
+	AllocationTraceRecord record;
+	record.type = (UInt8)type;
+	record.frameCount = (UInt8)(captureFrames ? CaptureFrames(frames) : 0);
+	record.label = (UInt16)label;
+	record.thread = (UInt32)threadIndex;
+	record.address = (UInt64)(UIntPtr)address;
+	record.size = (UInt64)size;
+
+	const size_t framesSize = record.frameCount * sizeof(UInt64);
+	Mutex::AutoLock lock(s_TraceMutex);
+	if (s_TraceFile == NULL)
+		return;
+
+	// Taken under the lock so the records of a stream are in timestamp order
+	record.timestamp = GetTraceTimestamp();
+	if (s_TraceBufferUsed + sizeof(record) + framesSize > kTraceBufferSize)
+		FlushTraceBuffer();
+	memcpy(s_TraceBuffer + s_TraceBufferUsed, &record, sizeof(record));
+	memcpy(s_TraceBuffer + s_TraceBufferUsed + sizeof(record), frames, framesSize);
+	s_TraceBufferUsed += sizeof(record) + framesSize;
+}
+
+bool AllocationTracer::Start(const char* path, int sampleInterval)
+{
+	Mutex::AutoLock lock(s_TraceMutex);
+	if (s_TraceFile != NULL || sampleInterval < 1)
+		return false;
+
+	s_TraceFile = fopen(path, "wb");
+	if (s_TraceFile == NULL)
+		return false;
+
+	AllocationTraceHeader header;
+	memcpy(header.tag, kAllocationTraceTag, sizeof(header.tag));
+	header.version = kAllocationTraceVersion;
+	header.sampleInterval = (UInt32)sampleInterval;
+	header.labelCount = kMemLabelCount;
+	header.moduleBase = GetModuleBase();
+	header.timestampFrequency = GetTraceTimestampFrequency();
+	fwrite(&header, sizeof(header), 1, s_TraceFile);
+	for (int i = 0; i < kMemLabelCount; ++i)
+	{
+		const UInt8 length = (UInt8)std::min<size_t>(strlen(MemLabelName[i]), 255);
+		fwrite(&length, 1, 1, s_TraceFile);
+		fwrite(MemLabelName[i], 1, length, s_TraceFile);
+	}
+
+	s_TraceBufferUsed = 0;
+	AtomicExchange(&s_SampleInterval, sampleInterval);
+	return true;
+}
+
+void AllocationTracer::Stop()
+{
+	AtomicExchange(&s_SampleInterval, 0);
+
+	Mutex::AutoLock lock(s_TraceMutex);
+	if (s_TraceFile == NULL)
+		return;
+
+	FlushTraceBuffer();
+	fclose(s_TraceFile);
+	s_TraceFile = NULL;
+}
+
+void AllocationTracer::Allocation(const void* ptr, size_t size, MemLabelRef label)
+{
+	const int sampleInterval = s_SampleInterval;
+	if (ptr != NULL && sampleInterval != 0 && IsSampled(ptr, sampleInterval))
+		WriteRecord(kAllocationTraceAllocate, ptr, size, GetLabelIdentifier(label), true);
+}
+
+void AllocationTracer::Deallocation(const void* ptr, MemLabelRef label)
+{
+	const int sampleInterval = s_SampleInterval;
+	if (ptr != NULL && sampleInterval != 0 && IsSampled(ptr, sampleInterval))
+		WriteRecord(kAllocationTraceDeallocate, ptr, 0, GetLabelIdentifier(label), false);
+}
+
+void AllocationTracer::PoolCreated(const void* base, size_t size)
+{
+	if (IsActive())
+		WriteRecord(kAllocationTracePoolCreate, base, size, kAllocationTraceNoLabel, false);
+}
+
+void AllocationTracer::PoolDestroyed(const void* base, size_t size)
+{
+	if (IsActive())
+		WriteRecord(kAllocationTracePoolDestroy, base, size, kAllocationTraceNoLabel, false);
+}
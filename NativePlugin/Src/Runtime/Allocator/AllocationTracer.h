@@ -0,0 +1,44 @@
+#ifndef ALLOCATION_TRACER_H_
+#define ALLOCATION_TRACER_H_
+
+#include "Misc/AllocatorLabels.h"
+
+// Sampling allocation tracer, writes the stream described in AllocationTraceFormat.h.
+// Blocks are sampled by a hash of their address instead of a running count: about one in sampleInterval
+// allocations is logged, and the deallocation of a sampled block is always logged too, without keeping
+// a set of the sampled addresses. Use a sampleInterval of 1 for an exact fragmentation replay.
+// When stopped the hooks cost one load and branch.
+class AllocationTracer
+{
+public:
+	// Returns false if tracing is already running or the file can't be created
+	static bool Start(const char* path, int sampleInterval);
+	// Flushes and closes the stream
+	static void Stop();
+
+	static inline bool IsActive() { return s_SampleInterval != 0; }
+
+	static void Allocation(const void* ptr, size_t size, MemLabelRef label);
+	static void Deallocation(const void* ptr, MemLabelRef label);
+	static void PoolCreated(const void* base, size_t size);
+	static void PoolDestroyed(const void* base, size_t size);
+
+private:
+	static volatile int s_SampleInterval;
+};
+
+// Hooks for the allocation paths. Deallocations must be traced before the block is released,
+// allocations after it was handed out, so a reused address is never logged out of order.
+inline void TraceAllocation(const void* ptr, size_t size, MemLabelRef label)
+{
+	if (AllocationTracer::IsActive())
+		AllocationTracer::Allocation(ptr, size, label);
+}
+
+inline void TraceDeallocation(const void* ptr, MemLabelRef label)
+{
+	if (AllocationTracer::IsActive())
+		AllocationTracer::Deallocation(ptr, label);
+}
+
+#endif // ALLOCATION_TRACER_H_
@@ -0,0 +1,562 @@
+#include "PluginPrefix.h"
+
+#if ENABLE_PERFORMANCE_TESTS
+
+#include "Runtime/Testing/Testing.h"
+#include "Allocator/FrameAllocator.h"
+#include "Allocator/LowLevelDefaultAllocator.h"
+#include "Allocator/MemoryMacros.h"
+#include "Threads/AtomicOps.h"
+#include "Threads/ExtendedAtomicOps.h"
+#include "Threads/Thread.h"
+#include "Threads/ThreadUtility.h"
+#include "Math/Random/rand.h"
+#include "Utilities/ArrayUtility.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#if UNITY_WIN
+#include <malloc.h>
+#elif UNITY_APPLE
+#include <malloc/malloc.h>
+#elif UNITY_LINUX || UNITY_ANDROID
+#include <malloc.h>
+#endif
+
+// Baseline for the allocators the plugin actually uses: malloc_internal (the platform heap behind UNITY_MALLOC),
+// LowLevelHugePageAllocator behind the ParticleSystem label, and the FrameAllocator behind ALLOC_FRAME.
+// Each allocator replays synthetic traces shaped like the particle system's allocations on 1 to 8 threads and
+// prints ##perf lines like ParticleSystemCurvesPerformanceTests, with alloc and free latency percentiles in ns.
+// Fragmentation is 1 - requested / reserved at the peak of requested live bytes. Reserved is what the allocator holds
+// for the live blocks: the heap's block sizes for malloc_internal, whole granules for the huge pages, and all blocks
+// created so far for the FrameAllocator, which keeps the blocks of the last frames of its window.
+// The Stress tests replay the same traces with guard patterns to catch blocks handed out twice.
+
+SUITE (AllocatorPerformanceTests)
+{
+	enum TraceOpType { kTraceAllocate, kTraceDeallocate, kTraceFrame };
+	enum Lifetime { kLifetimeRandom, kLifetimeFrame };
+
+	struct TraceOp
+	{
+		UInt32 type;
+		UInt32 slot;
+		UInt32 size;
+	};
+
+	struct Workload
+	{
+		const char* name;
+		UInt32      minSize;
+		UInt32      maxSize;
+		int         maxLive;        // Live allocations of the trace at most
+		int         opsPerFrame;
+		Lifetime    lifetime;
+	};
+
+	// Modules, curves and sub-emitter lists, allocated and released as systems come and go
+	static const Workload kSmallObjects = { "SmallObjects", 16, 128, 4096, 2000, kLifetimeRandom };
+	// Particle SoA arrays, reallocated as the particle counts of the systems change
+	static const Workload kParticleArrays = { "ParticleArrays", 64 * 1024, 1024 * 1024, 64, 50, kLifetimeRandom };
+	// Job inputs, dropped when the jobs are synced at the end of the frame
+	static const Workload kJobData = { "JobData", 32, 1024, 1000, 500, kLifetimeFrame };
+
+	static const int kFrames = 100;
+	static const int kThreadCounts[] = { 1, 2, 4, 8 };
+	static const int kMaxThreads = 8;
+	static const int kMaxSlots = 4096;
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Allocators under test. Deallocate is a no-op for allocators that only release memory per frame.
+	class TestAllocator
+	{
+	public:
+		virtual ~TestAllocator() {}
+		virtual void* Allocate(size_t size) = 0;
+		virtual void  Deallocate(void* ptr) = 0;
+		// Called by one thread between frames while no other thread allocates
+		virtual void  FrameMaintenance() {}
+		// Bytes held for the block. Allocators without per block sizes report their whole reservation instead.
+		virtual bool   HasBlockSizes() const { return true; }
+		virtual size_t GetBlockSize(const void* ptr) const = 0;
+		virtual size_t GetReservedSize() const { return 0; }
+	};
+
+	static size_t GetHeapBlockSize(void* ptr)
+	{
+#if UNITY_WIN
+		// Same alignment argument as the heap's own size query in MemoryManager.cpp
+		return _aligned_msize(ptr, sizeof(void*), 0);
+#elif UNITY_APPLE
+		return malloc_size(ptr);
+#elif UNITY_LINUX || UNITY_ANDROID
+		return malloc_usable_size(ptr);
+#else
+		return 0;
+#endif
+	}
+
+	class MallocInternalAllocator : public TestAllocator
+	{
+	public:
+		explicit MallocInternalAllocator(MemLabelId label) : m_Label(label) {}
+		virtual void* Allocate(size_t size) { return UNITY_MALLOC_ALIGNED(m_Label, size, kDefaultMemoryAlignment); }
+		virtual void  Deallocate(void* ptr) { UNITY_FREE(m_Label, ptr); }
+		virtual size_t GetBlockSize(const void* ptr) const { return GetHeapBlockSize(const_cast<void*>(ptr)); }
+	private:
+		MemLabelId m_Label;
+	};
+
+	class HugePageAllocator : public TestAllocator
+	{
+	public:
+		virtual void* Allocate(size_t size) { return LowLevelHugePageAllocator::Malloc(size, kDefaultMemoryAlignment); }
+		virtual void  Deallocate(void* ptr) { LowLevelHugePageAllocator::Free(ptr); }
+		virtual size_t GetBlockSize(const void* ptr) const { return LowLevelHugePageAllocator::GetPtrSize(ptr); }
+	};
+
+	class FrameTestAllocator : public TestAllocator
+	{
+	public:
+		// Same configuration as the global ALLOC_FRAME allocator
+		FrameTestAllocator() : m_Allocator(256 * 1024, 64) {}
+		virtual void* Allocate(size_t size) { return m_Allocator.Allocate(size, kDefaultMemoryAlignment); }
+		virtual void  Deallocate(void* ptr) {}
+		virtual void  FrameMaintenance() { m_Allocator.FrameMaintenance(); }
+		virtual bool   HasBlockSizes() const { return false; }
+		virtual size_t GetBlockSize(const void* ptr) const { return 0; }
+		virtual size_t GetReservedSize() const { return m_Allocator.GetReservedSize(); }
+	private:
+		FrameAllocator m_Allocator;
+	};
+
+	static UInt32 GenerateSize(Rand& random, const Workload& workload)
+	{
+		// Log-uniform, small allocations are much more common than large ones
+		const float t = random.GetFloat();
+		const float size = workload.minSize * powf(float(workload.maxSize) / float(workload.minSize), t);
+		return (UInt32(size) + 15) & ~15u;
+	}
+
+	// Every thread's trace has the same number of frames, the threads meet at the frame ops
+	static void GenerateTrace(const Workload& workload, UInt32 seed, dynamic_array<TraceOp>& ops)
+	{
+		Rand random(seed);
+		ops.clear();
+		ops.reserve(kFrames * (workload.opsPerFrame * 2 + 1));
+
+		dynamic_array<UInt32> liveSlots(kMemTempAlloc);
+		dynamic_array<UInt32> slotSizes(kMemTempAlloc);
+		dynamic_array<UInt32> freeSlots(kMemTempAlloc);
+		slotSizes.resize_initialized(workload.maxLive, 0);
+		for (int i = workload.maxLive - 1; i >= 0; --i)
+			freeSlots.push_back(i);
+
+		for (int frame = 0; frame <= kFrames; ++frame)
+		{
+			const bool lastFrame = frame == kFrames;
+			for (int i = 0; i < workload.opsPerFrame && !lastFrame; ++i)
+			{
+				const bool allocate = !freeSlots.empty() && (liveSlots.empty() || workload.lifetime == kLifetimeFrame || (random.Get() & 1));
+				TraceOp op;
+				if (allocate)
+				{
+					op.type = kTraceAllocate;
+					op.slot = freeSlots.back();
+					op.size = slotSizes[op.slot] = GenerateSize(random, workload);
+					freeSlots.pop_back();
+					liveSlots.push_back(op.slot);
+				}
+				else
+				{
+					const size_t index = random.Get() % liveSlots.size();
+					op.type = kTraceDeallocate;
+					op.slot = liveSlots[index];
+					op.size = slotSizes[op.slot];
+					liveSlots[index] = liveSlots.back();
+					liveSlots.pop_back();
+					freeSlots.push_back(op.slot);
+				}
+				ops.push_back(op);
+			}
+
+			// Frame lifetimes don't outlive the frame, and nothing outlives the trace
+			if (workload.lifetime == kLifetimeFrame || lastFrame)
+			{
+				while (!liveSlots.empty())
+				{
+					TraceOp op = { kTraceDeallocate, liveSlots.back(), slotSizes[liveSlots.back()] };
+					ops.push_back(op);
+					freeSlots.push_back(liveSlots.back());
+					liveSlots.pop_back();
+				}
+			}
+
+			TraceOp op = { kTraceFrame, 0, 0 };
+			ops.push_back(op);
+		}
+	}
+
+	// Lets one thread run FrameMaintenance while the others wait, like the main thread after syncing the jobs
+	struct FrameBarrier
+	{
+		FrameBarrier(int threads) : threadCount(threads), arrived(0), frame(0) {}
+
+		// Returns true for the thread that has to run the frame maintenance, it has to call Release afterwards
+		bool Wait()
+		{
+			const int currentFrame = frame;
+			if (AtomicIncrement(&arrived) == threadCount)
+				return true;
+			while (frame == currentFrame)
+				atomic_pause();
+			return false;
+		}
+
+		void Release()
+		{
+			arrived = 0;
+			UnityMemoryBarrier();
+			AtomicIncrement(&frame);
+		}
+
+		const int    threadCount;
+		volatile int arrived;
+		volatile int frame;
+	};
+
+	struct ReplayContext
+	{
+		ReplayContext()
+			: allocator(NULL), ops(NULL), barrier(NULL), measureLatency(false), verify(false)
+			, allocateNs(kMemTempAlloc), deallocateNs(kMemTempAlloc), peakRequested(0), reservedAtPeak(0), errors(0) {}
+
+		TestAllocator*                allocator;
+		const dynamic_array<TraceOp>* ops;
+		FrameBarrier*                 barrier;
+		bool                          measureLatency;
+		bool                          verify;
+
+		dynamic_array<UInt32>         allocateNs;
+		dynamic_array<UInt32>         deallocateNs;
+		size_t                        peakRequested;
+		size_t                        reservedAtPeak;
+		int                           errors;
+	};
+
+	static inline UInt32 ElapsedNs(Clock::time_point start)
+	{
+		return UInt32(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+	}
+
+	// Stamps the slot at both ends of the allocation, a block handed out twice gets overwritten by its other owner
+	static void WritePattern(void* ptr, UInt32 slot, UInt32 size)
+	{
+		UInt32* words = static_cast<UInt32*>(ptr);
+		words[0] = slot ^ 0xA110CA7E;
+		words[size / sizeof(UInt32) - 1] = slot ^ 0x5EED5EED;
+	}
+
+	static bool CheckPattern(const void* ptr, UInt32 slot, UInt32 size)
+	{
+		const UInt32* words = static_cast<const UInt32*>(ptr);
+		return words[0] == (slot ^ 0xA110CA7E) && words[size / sizeof(UInt32) - 1] == (slot ^ 0x5EED5EED);
+	}
+
+	static void ReplayTrace(ReplayContext& context)
+	{
+		TestAllocator& allocator = *context.allocator;
+		const dynamic_array<TraceOp>& ops = *context.ops;
+
+		const bool hasBlockSizes = allocator.HasBlockSizes();
+		void* slots[kMaxSlots];
+		size_t requested = 0;
+		size_t reserved = 0;
+		for (size_t i = 0; i < ops.size(); ++i)
+		{
+			const TraceOp& op = ops[i];
+			if (op.type == kTraceAllocate)
+			{
+				Clock::time_point start;
+				if (context.measureLatency)
+					start = Clock::now();
+
+				void* ptr = allocator.Allocate(op.size);
+				slots[op.slot] = ptr;
+				if (ptr == NULL)
+				{
+					context.errors++;
+					continue;
+				}
+				// Touch the memory like the owner would
+				*static_cast<UInt8*>(ptr) = 0;
+
+				if (context.measureLatency)
+				{
+					context.allocateNs.push_back(ElapsedNs(start));
+
+					// Block sizes are queried outside the timed part
+					requested += op.size;
+					if (hasBlockSizes)
+						reserved += allocator.GetBlockSize(ptr);
+					if (requested > context.peakRequested)
+					{
+						context.peakRequested = requested;
+						context.reservedAtPeak = hasBlockSizes ? reserved : allocator.GetReservedSize();
+					}
+				}
+				if (context.verify)
+					WritePattern(ptr, op.slot, op.size);
+			}
+			else if (op.type == kTraceDeallocate)
+			{
+				void* ptr = slots[op.slot];
+				if (ptr == NULL)
+					continue;
+				if (context.verify && !CheckPattern(ptr, op.slot, op.size))
+					context.errors++;
+
+				if (context.measureLatency)
+				{
+					requested -= op.size;
+					if (hasBlockSizes)
+						reserved -= allocator.GetBlockSize(ptr);
+				}
+
+				Clock::time_point start;
+				if (context.measureLatency)
+					start = Clock::now();
+
+				allocator.Deallocate(ptr);
+
+				if (context.measureLatency)
+					context.deallocateNs.push_back(ElapsedNs(start));
+			}
+			else if (context.barrier->Wait())
+			{
+				allocator.FrameMaintenance();
+				context.barrier->Release();
+			}
+		}
+	}
+
+	static void* ReplayThreadFunc(void* data)
+	{
+		ReplayTrace(*static_cast<ReplayContext*>(data));
+		return NULL;
+	}
+
+	static double RunReplayPass(ReplayContext* contexts, int threadCount)
+	{
+		FrameBarrier barrier(threadCount);
+		for (int t = 0; t < threadCount; ++t)
+			contexts[t].barrier = &barrier;
+
+		Clock::time_point start = Clock::now();
+		Thread threads[kMaxThreads];
+		for (int t = 1; t < threadCount; ++t)
+			threads[t].Run(ReplayThreadFunc, &contexts[t]);
+		ReplayTrace(contexts[0]);
+		for (int t = 1; t < threadCount; ++t)
+			threads[t].WaitForExit(false);
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	static UInt32 Percentile(dynamic_array<UInt32>& samples, double percentile)
+	{
+		if (samples.empty())
+			return 0;
+		const size_t index = size_t(percentile * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+
+	static void RunAllocatorTest(const char* allocatorName, TestAllocator& allocator, const Workload& workload)
+	{
+		dynamic_array<TraceOp> traces[kMaxThreads];
+		for (int t = 0; t < kMaxThreads; ++t)
+			GenerateTrace(workload, 0x2BADF00D + t, traces[t]);
+
+		for (size_t c = 0; c < ARRAY_SIZE(kThreadCounts); ++c)
+		{
+			const int threadCount = kThreadCounts[c];
+			ReplayContext contexts[kMaxThreads];
+			size_t opsCount = 0;
+			for (int t = 0; t < threadCount; ++t)
+			{
+				contexts[t].allocator = &allocator;
+				contexts[t].ops = &traces[t];
+				opsCount += traces[t].size();
+			}
+
+			// Warm up, lets the allocators map their regions and blocks before timing
+			RunReplayPass(contexts, threadCount);
+			const double milliseconds = RunReplayPass(contexts, threadCount);
+
+			for (int t = 0; t < threadCount; ++t)
+				contexts[t].measureLatency = true;
+			RunReplayPass(contexts, threadCount);
+
+			dynamic_array<UInt32> allocateNs(kMemTempAlloc);
+			dynamic_array<UInt32> deallocateNs(kMemTempAlloc);
+			size_t peakRequested = 0;
+			size_t reservedAtPeak = 0;
+			int errors = 0;
+			for (int t = 0; t < threadCount; ++t)
+			{
+				allocateNs.insert(allocateNs.end(), contexts[t].allocateNs.begin(), contexts[t].allocateNs.end());
+				deallocateNs.insert(deallocateNs.end(), contexts[t].deallocateNs.begin(), contexts[t].deallocateNs.end());
+				peakRequested += contexts[t].peakRequested;
+				// Per block sizes add up over the threads, the whole allocator's reservation is shared by them
+				if (allocator.HasBlockSizes())
+					reservedAtPeak += contexts[t].reservedAtPeak;
+				else
+					reservedAtPeak = std::max(reservedAtPeak, contexts[t].reservedAtPeak);
+				errors += contexts[t].errors;
+			}
+			CHECK_EQUAL(0, errors);
+
+			// Per thread peaks don't line up in time, the summed requested size is an upper bound
+			const double fragmentation = reservedAtPeak > peakRequested ? 1.0 - double(peakRequested) / double(reservedAtPeak) : 0.0;
+
+			printf("##perf {\"suite\":\"Allocator\",\"test\":\"%s_%s\",\"threads\":%d,\"ops\":%u,\"ms\":%.4f,\"nsPerOp\":%.3f,"
+				"\"allocP50\":%u,\"allocP90\":%u,\"allocP99\":%u,\"allocMax\":%u,\"freeP50\":%u,\"freeP90\":%u,\"freeP99\":%u,\"freeMax\":%u,"
+				"\"peakRequested\":%u,\"reservedAtPeak\":%u,\"fragmentation\":%.3f}\n",
+				allocatorName, workload.name, threadCount, (unsigned)opsCount, milliseconds, milliseconds * 1000000.0 / double(opsCount),
+				Percentile(allocateNs, 0.5), Percentile(allocateNs, 0.9), Percentile(allocateNs, 0.99), Percentile(allocateNs, 1.0),
+				Percentile(deallocateNs, 0.5), Percentile(deallocateNs, 0.9), Percentile(deallocateNs, 0.99), Percentile(deallocateNs, 1.0),
+				(unsigned)peakRequested, (unsigned)reservedAtPeak, fragmentation);
+		}
+	}
+
+	static void RunStressTest(TestAllocator& allocator, const Workload& workload)
+	{
+		dynamic_array<TraceOp> traces[kMaxThreads];
+		ReplayContext contexts[kMaxThreads];
+		for (int t = 0; t < kMaxThreads; ++t)
+		{
+			GenerateTrace(workload, 0x5EED0000 + t, traces[t]);
+			contexts[t].allocator = &allocator;
+			contexts[t].ops = &traces[t];
+			contexts[t].verify = true;
+		}
+
+		RunReplayPass(contexts, kMaxThreads);
+
+		for (int t = 0; t < kMaxThreads; ++t)
+			CHECK_EQUAL(0, contexts[t].errors);
+	}
+
+	// Time to write every float of the live particle arrays once, what the update loops do every frame.
+	// This is where huge pages are supposed to pay off, through fewer TLB misses.
+	static void RunArraySweepTest(const char* allocatorName, TestAllocator& allocator)
+	{
+		const int kArrayCount = 64;
+		const int kSweeps = 20;
+		float* arrays[kArrayCount];
+		size_t sizes[kArrayCount];
+		size_t totalBytes = 0;
+		Rand random(0x2BADF00D);
+		for (int i = 0; i < kArrayCount; ++i)
+		{
+			sizes[i] = GenerateSize(random, kParticleArrays);
+			arrays[i] = static_cast<float*>(allocator.Allocate(sizes[i]));
+			CHECK(arrays[i] != NULL);
+			if (arrays[i] == NULL)
+				return;
+			memset(arrays[i], 0, sizes[i]);
+			totalBytes += sizes[i];
+		}
+
+		Clock::time_point start = Clock::now();
+		for (int sweep = 0; sweep < kSweeps; ++sweep)
+		{
+			for (int i = 0; i < kArrayCount; ++i)
+			{
+				float* values = arrays[i];
+				const size_t count = sizes[i] / sizeof(float);
+				for (size_t q = 0; q < count; ++q)
+					values[q] += 1.0f;
+			}
+		}
+		const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kSweeps;
+
+		// Keeps the sweeps alive
+		CHECK_EQUAL(float(kSweeps), arrays[kArrayCount / 2][0]);
+		printf("##perf {\"suite\":\"Allocator\",\"test\":\"%s_Sweep\",\"bytes\":%u,\"iterations\":%d,\"ms\":%.4f,\"nsPerKB\":%.3f}\n",
+			allocatorName, (unsigned)totalBytes, kSweeps, milliseconds, milliseconds * 1000000.0 / (double(totalBytes) / 1024.0));
+
+		for (int i = 0; i < kArrayCount; ++i)
+			allocator.Deallocate(arrays[i]);
+	}
+
+	TEST (MallocInternal_SmallObjects)
+	{
+		MallocInternalAllocator allocator(kMemUtility);
+		RunAllocatorTest("MallocInternal", allocator, kSmallObjects);
+	}
+
+	TEST (MallocInternal_JobData)
+	{
+		MallocInternalAllocator allocator(kMemUtility);
+		RunAllocatorTest("MallocInternal", allocator, kJobData);
+	}
+
+	// The platform heap path of the particle arrays, for comparison with the huge page label below
+	TEST (MallocInternal_ParticleArrays)
+	{
+		MallocInternalAllocator allocator(kMemUtility);
+		RunAllocatorTest("MallocInternal", allocator, kParticleArrays);
+		RunArraySweepTest("MallocInternal", allocator);
+	}
+
+	// What dynamic_array uses for the particle arrays, huge pages where the platform supports them
+	TEST (MallocInternalParticleSystemLabel_ParticleArrays)
+	{
+		MallocInternalAllocator allocator(kMemParticleSystem);
+		RunAllocatorTest("MallocInternalParticleSystemLabel", allocator, kParticleArrays);
+		RunArraySweepTest("MallocInternalParticleSystemLabel", allocator);
+	}
+
+#if ENABLE_HUGE_PAGE_ALLOCATOR
+	TEST (HugePage_ParticleArrays)
+	{
+		HugePageAllocator allocator;
+		RunAllocatorTest("HugePage", allocator, kParticleArrays);
+		RunArraySweepTest("HugePage", allocator);
+	}
+#endif
+
+	TEST (Frame_JobData)
+	{
+		FrameTestAllocator allocator;
+		RunAllocatorTest("Frame", allocator, kJobData);
+	}
+
+	TEST (Stress_MallocInternal)
+	{
+		MallocInternalAllocator allocator(kMemUtility);
+		RunStressTest(allocator, kSmallObjects);
+		MallocInternalAllocator particleAllocator(kMemParticleSystem);
+		RunStressTest(particleAllocator, kParticleArrays);
+	}
+
+#if ENABLE_HUGE_PAGE_ALLOCATOR
+	TEST (Stress_HugePage)
+	{
+		HugePageAllocator allocator;
+		RunStressTest(allocator, kParticleArrays);
+	}
+#endif
+
+	TEST (Stress_Frame)
+	{
+		FrameTestAllocator allocator;
+		RunStressTest(allocator, kJobData);
+	}
+}
+
+#endif // ENABLE_PERFORMANCE_TESTS
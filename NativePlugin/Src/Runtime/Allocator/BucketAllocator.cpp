@@ -3,6 +3,7 @@
 #include "Runtime/Allocator/AllocationHeader.h"
 #include "Runtime/Allocator/MemoryMacros.h"
 #include "Runtime/Allocator/MemoryManager.h"
+#include "Runtime/Allocator/AllocationTracer.h"
 #include "Runtime/Profiler/MemoryProfiler.h"
 #include "Runtime/Utilities/StaticAssert.h"
 
@@ -48,7 +49,10 @@ BucketAllocator::~BucketAllocator()
 		UNITY_DELETE(m_Buckets[i], kMemDefault);
 
 	for (int i = 0; i < m_UsedLargeBlocks; ++i)
+	{
+		AllocationTracer::PoolDestroyed(m_LargeBlocks[i].realPtr, m_LargeBlockSize);
 		MemoryManager::LowLevelFree(m_LargeBlocks[i].realPtr, m_LargeBlockSize);
+	}
 
 	UNITY_FREE(kMemDefault, m_LargeBlocks);
 }
@@ -205,6 +209,7 @@ bool BucketAllocator::AddLargeBlock()
 	m_LargeBlocks[m_UsedLargeBlocks].realPtr = ptr;
 	m_LargeBlocks[m_UsedLargeBlocks].endPtr = static_cast<char*>(ptr) + m_LargeBlockSize;
 	m_LargeBlocks[m_UsedLargeBlocks].firstBlockPtr = static_cast<char*>(AlignPtr(ptr, kBlockSize));
+	AllocationTracer::PoolCreated(ptr, m_LargeBlockSize);
 
 	AtomicExchange(&m_CurrentLargeBlockUsedSize, kBlockSize | m_UsedLargeBlocks); // One block is wasted because of alignment
 	AtomicIncrement(&m_UsedLargeBlocks);
@@ -5,6 +5,7 @@
 
 #include "Runtime/Allocator/AllocationHeader.h"
 #include "Runtime/Allocator/BucketAllocator.h"
+#include "Runtime/Allocator/AllocationTracer.h"
 #include "Runtime/Utilities/BitUtility.h"
 #include "Runtime/Profiler/MemoryProfiler.h"
 #if UNITY_XENON
@@ -54,6 +55,7 @@ DynamicHeapAllocator<LLAllocator>::~DynamicHeapAllocator()
 	for(ListIterator<PoolElement> i=m_SmallTLSFPools.begin();i != m_SmallTLSFPools.end();i++)
 	{
 		PoolElement& pool = *i;
+		AllocationTracer::PoolDestroyed(pool.memoryBase, pool.memorySize);
 		tlsf_destroy(pool.tlsfPool);
 		LLAllocator::Free(pool.memoryBase, pool.memorySize);
 	}
@@ -61,6 +63,7 @@ DynamicHeapAllocator<LLAllocator>::~DynamicHeapAllocator()
 	for(ListIterator<PoolElement> i=m_LargeTLSFPools.begin();i != m_LargeTLSFPools.end();i++)
 	{
 		PoolElement& pool = *i;
+		AllocationTracer::PoolDestroyed(pool.memoryBase, pool.memorySize);
 		tlsf_destroy(pool.tlsfPool);
 		LLAllocator::Free(pool.memoryBase, pool.memorySize);
 	}
@@ -180,6 +183,7 @@ void* DynamicHeapAllocator<LLAllocator>::Allocate(size_t size, int align)
 					newPool.memorySize = allocatePoolSize;
 					newPool.tlsfPool = tlsf_create(memoryBlock, allocatePoolSize);
 					newPool.allocationCount = 0;
+					AllocationTracer::PoolCreated(memoryBlock, allocatePoolSize);
 
 					{
 						Mutex::AutoLock lock(m_DHAMutex);
@@ -377,6 +381,7 @@ bool DynamicHeapAllocator<LLAllocator>::TryDeallocate(void* p)
 				Mutex::AutoLock lock(m_DHAMutex);
 				allocedPool->RemoveFromList();
 			}
+			AllocationTracer::PoolDestroyed(allocedPool->memoryBase, allocedPool->memorySize);
 			tlsf_destroy(allocedPool->tlsfPool);
 			LLAllocator::Free(allocedPool->memoryBase, allocedPool->memorySize);
 			m_TotalReservedBytes -= allocedPool->memorySize;
@@ -0,0 +1,169 @@
+#include "PluginPrefix.h"
+#include "Allocator/FrameAllocator.h"
+#include "Threads/AtomicOps.h"
+
+static const int kFrameAllocatorBlockSize = 256 * 1024;
+static const int kFrameAllocatorMaxBlocks = 64;
+static const int kFrameAllocatorBlockAlignment = 64;
+
+struct FrameAllocatorBlock
+{
+	UInt8*                     ptr;
+	ALIGN_TYPE(4) volatile int usedSize;
+	int                        next;        // Next block of the same frame or of the free list, -1 ends the list
+};
+
+static FrameAllocator* s_FrameAllocator = NULL;
+
+FrameAllocator::FrameAllocator(int blockSize, int maxBlocksCount)
+	: m_CurrentBlock(-1)
+	, m_UsedBlocks(0)
+	, m_FreeBlocks(-1)
+	, m_BlockSize(blockSize)
+	, m_MaxBlocksCount(maxBlocksCount)
+	, m_CurrentFrameIndex(0)
+{
+	for (int i = 0; i < kMaxAllocationFramespan; ++i)
+	{
+		m_FrameBlocks[i] = -1;
+		m_FrameOverflowAllocations[i] = NULL;
+	}
+
+	m_Blocks = static_cast<FrameAllocatorBlock*>(UNITY_MALLOC(kMemTempJobAlloc, sizeof(FrameAllocatorBlock) * m_MaxBlocksCount));
+	Mutex::AutoLock lock(m_NewBlockMutex);
+	SelectFreeBlock();
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	Mutex::AutoLock lock(m_NewBlockMutex);
+	for (int i = 0; i < kMaxAllocationFramespan; ++i)
+		ReleaseFrame(i);
+
+	for (int i = 0; i < m_UsedBlocks; ++i)
+		UNITY_FREE(kMemTempJobAlloc, m_Blocks[i].ptr);
+	UNITY_FREE(kMemTempJobAlloc, m_Blocks);
+}
+
+void* FrameAllocator::Allocate(size_t size, int align)
+{
+	const size_t allocSize = size + align - 1;
+	if (allocSize < static_cast<size_t>(m_BlockSize))
+	{
+		for (;;)
+		{
+			const int blockIndex = AtomicAdd(&m_CurrentBlock, 0);
+
+			// All blocks are in use by the frames of the window
+			if (blockIndex == -1)
+				break;
+
+			// Grab required memory from the current block
+			const int newUsedSize = AtomicAdd(&m_Blocks[blockIndex].usedSize, static_cast<int>(allocSize));
+			if (newUsedSize <= m_BlockSize)
+				return AlignPtr(m_Blocks[blockIndex].ptr + newUsedSize - static_cast<int>(allocSize), align);
+
+			// The rest of the block is wasted. Lock so only one thread switches to the next block
+			Mutex::AutoLock lock(m_NewBlockMutex);
+			if (blockIndex != AtomicAdd(&m_CurrentBlock, 0))
+				continue;
+
+			if (!SelectFreeBlock())
+			{
+				AtomicExchange(&m_CurrentBlock, -1);
+				break;
+			}
+		}
+	}
+
+	// Overflow. Fall back to the heap, the allocation is released together with its frame
+	Mutex::AutoLock lock(m_NewBlockMutex);
+	void** realPtr = static_cast<void**>(UNITY_MALLOC(kMemTempJobAlloc, allocSize + sizeof(void*)));
+	if (realPtr == NULL)
+		return NULL;
+
+	*realPtr = m_FrameOverflowAllocations[m_CurrentFrameIndex];
+	m_FrameOverflowAllocations[m_CurrentFrameIndex] = realPtr;
+	return AlignPtr(realPtr + 1, align);
+}
+
+void FrameAllocator::FrameMaintenance()
+{
+	Mutex::AutoLock lock(m_NewBlockMutex);
+
+	// The slot of the new frame was last used kMaxAllocationFramespan frames ago, its memory can be reused
+	m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % kMaxAllocationFramespan;
+	ReleaseFrame(m_CurrentFrameIndex);
+
+	// Start the frame on a block of its own
+	if (!SelectFreeBlock())
+		AtomicExchange(&m_CurrentBlock, -1);
+}
+
+// m_NewBlockMutex must be locked
+bool FrameAllocator::SelectFreeBlock()
+{
+	int blockIndex = m_FreeBlocks;
+	if (blockIndex != -1)
+	{
+		m_FreeBlocks = m_Blocks[blockIndex].next;
+	}
+	else
+	{
+		if (m_UsedBlocks >= m_MaxBlocksCount)
+			return false;
+
+		void* ptr = UNITY_MALLOC_ALIGNED(kMemTempJobAlloc, m_BlockSize, kFrameAllocatorBlockAlignment);
+		if (ptr == NULL)
+			return false;
+
+		blockIndex = m_UsedBlocks++;
+		m_Blocks[blockIndex].ptr = static_cast<UInt8*>(ptr);
+	}
+
+	m_Blocks[blockIndex].usedSize = 0;
+	m_Blocks[blockIndex].next = m_FrameBlocks[m_CurrentFrameIndex];
+	m_FrameBlocks[m_CurrentFrameIndex] = blockIndex;
+	AtomicExchange(&m_CurrentBlock, blockIndex);
+	return true;
+}
+
+// m_NewBlockMutex must be locked
+void FrameAllocator::ReleaseFrame(int frameIndex)
+{
+	int blockIndex = m_FrameBlocks[frameIndex];
+	while (blockIndex != -1)
+	{
+		const int next = m_Blocks[blockIndex].next;
+		m_Blocks[blockIndex].next = m_FreeBlocks;
+		m_FreeBlocks = blockIndex;
+		blockIndex = next;
+	}
+	m_FrameBlocks[frameIndex] = -1;
+
+	void* overflow = m_FrameOverflowAllocations[frameIndex];
+	while (overflow != NULL)
+	{
+		void* next = *static_cast<void**>(overflow);
+		UNITY_FREE(kMemTempJobAlloc, overflow);
+		overflow = next;
+	}
+	m_FrameOverflowAllocations[frameIndex] = NULL;
+}
+
+void InitializeFrameAllocator()
+{
+	if (s_FrameAllocator == NULL)
+		s_FrameAllocator = new FrameAllocator(kFrameAllocatorBlockSize, kFrameAllocatorMaxBlocks);
+}
+
+void CleanupFrameAllocator()
+{
+	delete s_FrameAllocator;
+	s_FrameAllocator = NULL;
+}
+
+FrameAllocator& GetFrameAllocator()
+{
+	return *s_FrameAllocator;
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_ALLOCATOR_H_
+#define FRAME_ALLOCATOR_H_
+
+#include "Allocator/MemoryMacros.h"
+#include "Threads/Mutex.h"
+
+struct FrameAllocatorBlock;
+
+// Lockless linear allocator for memory that has to outlive the scope it was allocated in, like job inputs.
+// Same block rotation as ThreadsafeLinearAllocator, but allocations are never deallocated one by one: every
+// frame of the m_MaxAllocationFramespan window owns the blocks it allocated from, and they are reused when
+// the frame falls out of the window. Memory stays valid until FrameMaintenance has been called
+// kMaxAllocationFramespan times, so it can be consumed by jobs that run up to two frames later.
+// Allocations that don't fit in a block go to the heap and are released with their frame as well.
+class FrameAllocator
+{
+public:
+	enum { kMaxAllocationFramespan = 3 };
+
+	// @param blockSize Fixed block size.
+	// @param maxBlocksCount Maximum blocks count, shared by all frames of the window.
+	FrameAllocator(int blockSize, int maxBlocksCount);
+	~FrameAllocator();
+
+	// Can be called from any thread
+	void* Allocate(size_t size, int align);
+
+	// Starts a new frame and releases the memory of the frame that falls out of the window.
+	// Call once per frame on the main thread, while no job allocates from this allocator.
+	void  FrameMaintenance();
+
+	// Bytes of the blocks created so far, heap allocations of overflowing frames are not included
+	size_t GetReservedSize() const { return (size_t)m_UsedBlocks * m_BlockSize; }
+
+private:
+	bool SelectFreeBlock();
+	void ReleaseFrame(int frameIndex);
+
+	FrameAllocatorBlock*       m_Blocks;
+	ALIGN_TYPE(4) volatile int m_CurrentBlock;
+	int                        m_UsedBlocks;
+	int                        m_FreeBlocks;                                      // Free list, linked like the frame lists
+	const int                  m_BlockSize;
+	const int                  m_MaxBlocksCount;
+	Mutex                      m_NewBlockMutex;
+
+	int                        m_CurrentFrameIndex;
+	int                        m_FrameBlocks[kMaxAllocationFramespan];            // Blocks allocated from by each frame of the window
+	void*                      m_FrameOverflowAllocations[kMaxAllocationFramespan];  // Heap allocations of each frame, linked through their first word
+};
+
+void InitializeFrameAllocator();
+void CleanupFrameAllocator();
+FrameAllocator& GetFrameAllocator();
+
+/// ALLOC_FRAME allocates memory that stays valid for FrameAllocator::kMaxAllocationFramespan frames and is never freed explicitly.
+/// Unlike ALLOC_TEMP it can be handed to jobs that outlive the allocating scope, and it never touches the heap once the blocks are warm.
+/// eg.
+/// Job* jobs;
+/// ALLOC_FRAME(jobs, Job, count);
+#define ALLOC_FRAME_ALIGNED(ptr, type, count, alignment) \
+	ptr = static_cast<type*>(GetFrameAllocator().Allocate((count) * sizeof(type), alignment))
+
+#define ALLOC_FRAME(ptr, type, count) \
+	ALLOC_FRAME_ALIGNED(ptr, type, count, kDefaultMemoryAlignment)
+
+#endif // FRAME_ALLOCATOR_H_
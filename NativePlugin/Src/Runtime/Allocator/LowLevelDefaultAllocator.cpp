@@ -1,4 +1,4 @@
-#include "UnityPrefix.h"
+#include "PluginPrefix.h"
 #include "LowLevelDefaultAllocator.h"
 #include "Runtime/Allocator/MemoryManager.h"
 
@@ -10,3 +10,196 @@ void* LowLevelAllocator::Realloc(void* ptr, size_t size, size_t oldSize) { retur
 void  LowLevelAllocator::Free(void* ptr, size_t oldSize) { MemoryManager::LowLevelFree(ptr, oldSize); }
 
 #endif
+
+#if ENABLE_HUGE_PAGE_ALLOCATOR
+
+#include "Runtime/Threads/Mutex.h"
+#include <sys/mman.h>
+
+static const int kGranulesPerRegion = LowLevelHugePageAllocator::kHugePageSize / LowLevelHugePageAllocator::kGranuleSize;
+static const int kMaxHugePageRegions = 256;
+
+// A 2MB region shared by the blocks of up to 2MB, or a dedicated mapping of a larger block
+struct HugePageRegion
+{
+	char*  base;
+	size_t size;
+	UInt32 usedGranules;                        ///< Bit per granule of a shared region
+	UInt8  blockGranules[kGranulesPerRegion];   ///< Granule count of the block starting at each granule
+	bool   dedicated;
+};
+
+static HugePageRegion s_HugePageRegions[kMaxHugePageRegions];
+static volatile int s_HugePageRegionCount = 0;
+static Mutex s_HugePageMutex;
+
+static char* MapHugePages(size_t size)
+{
+	// Explicit huge pages when the system has reserved some, the reservation is made by mmap itself
+	void* explicitPages = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (explicitPages != MAP_FAILED)
+		return (char*)explicitPages;
+
+	// Transparent huge pages only back 2MB aligned ranges, over reserve and trim to the alignment
+	const size_t reserveSize = size + LowLevelHugePageAllocator::kHugePageSize;
+	char* reserved = (char*)mmap(NULL, reserveSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (reserved == (char*)MAP_FAILED)
+		return NULL;
+
+	char* base = (char*)(((UIntPtr)reserved + LowLevelHugePageAllocator::kHugePageSize - 1) & ~(UIntPtr)(LowLevelHugePageAllocator::kHugePageSize - 1));
+	if (base != reserved)
+		munmap(reserved, base - reserved);
+	if (reserved + reserveSize != base + size)
+		munmap(base + size, reserved + reserveSize - (base + size));
+
+	// Fails without transparent huge page support, the range then stays on 4KB pages
+	madvise(base, size, MADV_HUGEPAGE);
+	return base;
+}
+
+static int FindHugePageRegion(const void* ptr)
+{
+	for (int i = 0; i < s_HugePageRegionCount; i++)
+	{
+		const HugePageRegion& region = s_HugePageRegions[i];
+		if (ptr >= region.base && ptr < region.base + region.size)
+			return i;
+	}
+	return -1;
+}
+
+static void ReleaseHugePageRegion(int index)
+{
+	munmap(s_HugePageRegions[index].base, s_HugePageRegions[index].size);
+	s_HugePageRegions[index] = s_HugePageRegions[s_HugePageRegionCount - 1];
+	s_HugePageRegionCount--;
+}
+
+static inline UInt32 GetGranuleMask(size_t granules)
+{
+	return granules >= 32 ? 0xFFFFFFFF : ((UInt32)1 << granules) - 1;
+}
+
+void* LowLevelHugePageAllocator::Malloc(size_t size, size_t align)
+{
+	if (size < kMinAllocationSize || align > kGranuleSize || size > ~(size_t)0 - kHugePageSize)
+		return NULL;
+
+	const size_t granules = (size + kGranuleSize - 1) / kGranuleSize;
+	Mutex::AutoLock lock(s_HugePageMutex);
+
+	if (granules > kGranulesPerRegion)
+	{
+		if (s_HugePageRegionCount == kMaxHugePageRegions)
+			return NULL;
+
+		const size_t mappedSize = (size + kHugePageSize - 1) & ~(size_t)(kHugePageSize - 1);
+		char* base = MapHugePages(mappedSize);
+		if (base == NULL)
+			return NULL;
+
+		HugePageRegion& region = s_HugePageRegions[s_HugePageRegionCount++];
+		region.base = base;
+		region.size = mappedSize;
+		region.usedGranules = 0;
+		region.dedicated = true;
+		return base;
+	}
+
+	// First fit of the granule run in the shared regions
+	const UInt32 blockMask = GetGranuleMask(granules);
+	for (int i = 0; i < s_HugePageRegionCount; i++)
+	{
+		HugePageRegion& region = s_HugePageRegions[i];
+		if (region.dedicated)
+			continue;
+
+		for (size_t first = 0; first + granules <= kGranulesPerRegion; first++)
+		{
+			if ((region.usedGranules & (blockMask << first)) == 0)
+			{
+				region.usedGranules |= blockMask << first;
+				region.blockGranules[first] = (UInt8)granules;
+				return region.base + first * kGranuleSize;
+			}
+		}
+	}
+
+	if (s_HugePageRegionCount == kMaxHugePageRegions)
+		return NULL;
+
+	char* base = MapHugePages(kHugePageSize);
+	if (base == NULL)
+		return NULL;
+
+	HugePageRegion& region = s_HugePageRegions[s_HugePageRegionCount++];
+	region.base = base;
+	region.size = kHugePageSize;
+	region.usedGranules = blockMask;
+	memset(region.blockGranules, 0, sizeof(region.blockGranules));
+	region.blockGranules[0] = (UInt8)granules;
+	region.dedicated = false;
+	return base;
+}
+
+void LowLevelHugePageAllocator::Free(void* ptr)
+{
+	Mutex::AutoLock lock(s_HugePageMutex);
+	const int index = FindHugePageRegion(ptr);
+	if (index < 0)
+		return;
+
+	HugePageRegion& region = s_HugePageRegions[index];
+	if (region.dedicated)
+	{
+		ReleaseHugePageRegion(index);
+		return;
+	}
+
+	const size_t first = ((char*)ptr - region.base) / kGranuleSize;
+	region.usedGranules &= ~(GetGranuleMask(region.blockGranules[first]) << first);
+	region.blockGranules[first] = 0;
+	if (region.usedGranules != 0)
+		return;
+
+	// Keep one empty region around, particle arrays are freed and allocated again when they grow
+	for (int i = 0; i < s_HugePageRegionCount; i++)
+	{
+		if (i != index && !s_HugePageRegions[i].dedicated && s_HugePageRegions[i].usedGranules == 0)
+		{
+			ReleaseHugePageRegion(index);
+			return;
+		}
+	}
+}
+
+bool LowLevelHugePageAllocator::Contains(const void* ptr)
+{
+	if (s_HugePageRegionCount == 0)
+		return false;
+
+	Mutex::AutoLock lock(s_HugePageMutex);
+	return FindHugePageRegion(ptr) >= 0;
+}
+
+size_t LowLevelHugePageAllocator::GetPtrSize(const void* ptr)
+{
+	Mutex::AutoLock lock(s_HugePageMutex);
+	const int index = FindHugePageRegion(ptr);
+	if (index < 0)
+		return 0;
+
+	const HugePageRegion& region = s_HugePageRegions[index];
+	if (region.dedicated)
+		return region.size;
+	return region.blockGranules[((const char*)ptr - region.base) / kGranuleSize] * (size_t)kGranuleSize;
+}
+
+#else
+
+void*  LowLevelHugePageAllocator::Malloc(size_t size, size_t align) { return NULL; }
+void   LowLevelHugePageAllocator::Free(void* ptr) {}
+bool   LowLevelHugePageAllocator::Contains(const void* ptr) { return false; }
+size_t LowLevelHugePageAllocator::GetPtrSize(const void* ptr) { return 0; }
+
+#endif // ENABLE_HUGE_PAGE_ALLOCATOR
@@ -22,4 +22,39 @@ public:
 #endif
 
 #endif
+
+#include "Misc/AllocatorLabels.h"
+
+#if UNITY_LINUX
+#define ENABLE_HUGE_PAGE_ALLOCATOR 1
+#else
+#define ENABLE_HUGE_PAGE_ALLOCATOR 0
+#endif
+
+// Backend for the labels of large, long lived buffers that are walked linearly every frame.
+// Blocks of at least kMinAllocationSize are sub allocated from 2MB aligned regions mapped with explicit
+// huge pages when the system has reserved them, transparent huge pages (MADV_HUGEPAGE) otherwise, and stay
+// on 4KB pages where neither is available. Smaller blocks and failed mappings are left to the caller.
+class LowLevelHugePageAllocator
+{
+public:
+	enum
+	{
+		kHugePageSize = 2 * 1024 * 1024,
+		kGranuleSize = 64 * 1024,
+		kMinAllocationSize = kGranuleSize,
+	};
+
+	static bool IsHugePageLabel(MemLabelRef label)
+	{
+		return ENABLE_HUGE_PAGE_ALLOCATOR && (label == kMemParticleSystem || label == kMemDynamicGeometry);
+	}
+
+	// Returns NULL if the block should come from the default allocator
+	static void*  Malloc(size_t size, size_t align);
+	static void   Free(void* ptr);
+	static bool   Contains(const void* ptr);
+	static size_t GetPtrSize(const void* ptr);
+};
+
 #endif // LOW_LEVEL_DEFAULT_ALLOCATOR_H_
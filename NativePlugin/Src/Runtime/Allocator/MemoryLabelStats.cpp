@@ -0,0 +1,97 @@
+#include "PluginPrefix.h"
+#include "Allocator/MemoryLabelStats.h"
+#include "Allocator/MemoryMacros.h"
+#include "Threads/ExtendedAtomicOps.h"
+
+// One cache line per label on 64 bit platforms, so threads allocating from different labels don't contend.
+// Zero initialized static storage: allocations made during static initialization are counted as well.
+struct LabelCounters
+{
+	volatile atomic_word allocatedMemory;
+	volatile atomic_word peakAllocatedMemory;
+	volatile atomic_word largestAlloc;
+	volatile atomic_word numAllocs;
+	volatile atomic_word frameAllocs;
+	volatile atomic_word frameDeallocs;
+	volatile atomic_word lastFrameAllocs;
+	volatile atomic_word lastFrameDeallocs;
+};
+
+static ALIGN_TYPE(64) LabelCounters s_LabelCounters[kMemLabelCount];
+
+static inline void AtomicMaximum(volatile atomic_word* value, atomic_word candidate)
+{
+	atomic_word current = atomic_load_explicit(value, memory_order_relaxed);
+	while (current < candidate && !atomic_compare_exchange_weak_explicit(value, &current, candidate, memory_order_relaxed, memory_order_relaxed))
+	{
+	}
+}
+
+// The counters are statistics and never order other memory accesses, so relaxed atomics are enough.
+// Peak and largest only take the compare exchange loop when they actually grow.
+void RegisterLabelAllocation(MemLabelRef label, size_t size)
+{
+	const int id = GetLabelIdentifier(label);
+	if (id >= kMemLabelCount)
+		return;
+
+	LabelCounters& counters = s_LabelCounters[id];
+	atomic_fetch_add_explicit(&counters.numAllocs, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&counters.frameAllocs, 1, memory_order_relaxed);
+	if (size == 0)
+		return;
+
+	const atomic_word allocated = atomic_fetch_add_explicit(&counters.allocatedMemory, (atomic_word)size, memory_order_relaxed) + (atomic_word)size;
+	AtomicMaximum(&counters.peakAllocatedMemory, allocated);
+	AtomicMaximum(&counters.largestAlloc, (atomic_word)size);
+}
+
+void RegisterLabelDeallocation(MemLabelRef label, size_t size)
+{
+	const int id = GetLabelIdentifier(label);
+	if (id >= kMemLabelCount)
+		return;
+
+	LabelCounters& counters = s_LabelCounters[id];
+	atomic_fetch_sub_explicit(&counters.numAllocs, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&counters.frameDeallocs, 1, memory_order_relaxed);
+	if (size != 0)
+		atomic_fetch_sub_explicit(&counters.allocatedMemory, (atomic_word)size, memory_order_relaxed);
+}
+
+bool GetMemoryLabelStats(MemLabelRef label, MemLabelStats& stats)
+{
+	const int id = GetLabelIdentifier(label);
+	if (id >= kMemLabelCount)
+		return false;
+
+	// Read field by field, a snapshot taken while other threads allocate is only approximately consistent
+	const LabelCounters& counters = s_LabelCounters[id];
+	stats.allocatedBytes = (UInt64)atomic_load_explicit(&counters.allocatedMemory, memory_order_relaxed);
+	stats.peakAllocatedBytes = (UInt64)atomic_load_explicit(&counters.peakAllocatedMemory, memory_order_relaxed);
+	stats.largestAllocation = (UInt64)atomic_load_explicit(&counters.largestAlloc, memory_order_relaxed);
+	stats.allocationCount = (UInt32)atomic_load_explicit(&counters.numAllocs, memory_order_relaxed);
+	stats.allocationsLastFrame = (UInt32)atomic_load_explicit(&counters.lastFrameAllocs, memory_order_relaxed);
+	stats.deallocationsLastFrame = (UInt32)atomic_load_explicit(&counters.lastFrameDeallocs, memory_order_relaxed);
+	stats.padding = 0;
+	return true;
+}
+
+void EndMemoryLabelStatsFrame()
+{
+	for (int i = 0; i < kMemLabelCount; i++)
+	{
+		LabelCounters& counters = s_LabelCounters[i];
+		atomic_store_explicit(&counters.lastFrameAllocs, atomic_exchange_explicit(&counters.frameAllocs, 0, memory_order_relaxed), memory_order_relaxed);
+		atomic_store_explicit(&counters.lastFrameDeallocs, atomic_exchange_explicit(&counters.frameDeallocs, 0, memory_order_relaxed), memory_order_relaxed);
+	}
+}
+
+void ResetMemoryLabelPeaks()
+{
+	for (int i = 0; i < kMemLabelCount; i++)
+	{
+		LabelCounters& counters = s_LabelCounters[i];
+		atomic_store_explicit(&counters.peakAllocatedMemory, atomic_load_explicit(&counters.allocatedMemory, memory_order_relaxed), memory_order_relaxed);
+	}
+}
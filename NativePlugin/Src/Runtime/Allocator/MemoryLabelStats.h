@@ -0,0 +1,34 @@
+#ifndef MEMORY_LABEL_STATS_H_
+#define MEMORY_LABEL_STATS_H_
+
+#include "Misc/AllocatorLabels.h"
+
+// Snapshot of the counters kept for every label, see GetMemoryLabelStats.
+// Plain fixed size fields, it is handed to scripts through the C API as is.
+struct MemLabelStats
+{
+	UInt64 allocatedBytes;			// Usable size of the live allocations
+	UInt64 peakAllocatedBytes;		// High water mark of allocatedBytes since startup or the last ResetMemoryLabelPeaks
+	UInt64 largestAllocation;
+	UInt32 allocationCount;			// Live allocations
+	UInt32 allocationsLastFrame;
+	UInt32 deallocationsLastFrame;
+	UInt32 padding;
+};
+
+// Lock-free per label counters, fed by MemoryManager or by the low level allocation functions when it is disabled.
+// Only relaxed atomic adds on the allocation path, so they are kept in release builds.
+// size is the usable size of the block and must be the same for its allocation and deallocation. Pass 0 to only count it.
+void RegisterLabelAllocation(MemLabelRef label, size_t size);
+void RegisterLabelDeallocation(MemLabelRef label, size_t size);
+
+// Returns false for labels that are not tracked (custom allocator labels)
+bool GetMemoryLabelStats(MemLabelRef label, MemLabelStats& stats);
+
+// Moves the allocation and deallocation counts of the current frame to the last frame ones, call once per frame
+void EndMemoryLabelStatsFrame();
+
+// Restarts the high water marks at the currently allocated bytes
+void ResetMemoryLabelPeaks();
+
+#endif // MEMORY_LABEL_STATS_H_
@@ -103,6 +103,8 @@ EXPORT_COREMODULE void* calloc_internal(size_t count, size_t size, int align, Me
 EXPORT_COREMODULE void* realloc_internal(void* ptr, size_t size, int align, MemLabelRef label, int allocateOptions, const char* file, int line);
 void free_internal(void* ptr);
 EXPORT_COREMODULE void  free_alloc_internal(void* ptr, MemLabelRef label);
+// Returns the small blocks the calling thread keeps for reuse to the heap, called by Thread before the thread exits
+void FlushThreadSmallBlockCache();
 
 #define GET_CURRENT_ALLOC_ROOT_REFERENCE() (AllocationRootReference*)NULL
 #define SET_ALLOC_OWNER(root) {}
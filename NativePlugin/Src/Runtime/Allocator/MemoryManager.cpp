@@ -1,6 +1,8 @@
 #include "PluginPrefix.h"
 #include "Allocator/MemoryManager.h"
 #include "Allocator/AllocationHeader.h"
+#include "Allocator/MemoryLabelStats.h"
+#include "Allocator/AllocationTracer.h"
 #include "Utilities/MemoryUtilities.h"
 //#include "Utilities/Argv.h"
 #include "Threads/AtomicOps.h"
@@ -41,15 +43,19 @@
 
 #if UNITY_ANDROID
 
+#include <malloc.h>
 #define UNITY_LL_ALLOC(l,s,a) ::memalign(a, s)
 #define UNITY_LL_REALLOC(l,p,s,a) ::realloc(p, s)
 #define UNITY_LL_FREE(l,p) ::free(p)
+#define UNITY_LL_SIZE(p) ::malloc_usable_size(p)
 
 #elif UNITY_WIN
 
 #define UNITY_LL_ALLOC(l,s,a) ::_aligned_malloc(s, a)
 #define UNITY_LL_REALLOC(l,p,s,a) ::_aligned_realloc(p, s, a)
 #define UNITY_LL_FREE(l,p) ::_aligned_free(p)
+// The alignment only offsets the result by a constant of the block, it just has to be the same for allocation and free
+#define UNITY_LL_SIZE(p) ::_aligned_msize(p, sizeof(void*), 0)
 
 #elif UNITY_USE_PLATFORM_MEMORY			// define UNITY_USE_PLATFORM_MEMORY in PlatformPrefixConfigure.h
 
@@ -60,9 +66,24 @@
 #define UNITY_LL_ALLOC(l,s,a) ::malloc(s)
 #define UNITY_LL_REALLOC(l,p,s,a) ::realloc(p, s)
 #define UNITY_LL_FREE(l,p) ::free(p)
+#if UNITY_APPLE
+#include <malloc/malloc.h>
+#define UNITY_LL_SIZE(p) ::malloc_size(p)
+#elif UNITY_LINUX
+#include <malloc.h>
+#define UNITY_LL_SIZE(p) ::malloc_usable_size(p)
+#endif
 
 #endif
 
+// Platforms without a block size query only count allocations in the label stats
+#ifndef UNITY_LL_SIZE
+#define UNITY_LL_SIZE(p) 0
+#define UNITY_LL_HAS_SIZE 0
+#else
+#define UNITY_LL_HAS_SIZE 1
+#endif
+
 const size_t kMaxAllocatorOverhead = 64 * 1024;
 const char OverflowInMemoryAllocatorString[] = "Overflow in memory allocator.";
 
@@ -1003,7 +1024,11 @@ void* MemoryManager::Allocate(size_t size, int align, MemLabelRef label, int all
 	{
 		void* ptr = ((TempTLSAllocator*) m_FrameTempAllocator)->TempTLSAllocator::Allocate(size, align);
 		if (ptr != NULL)
+		{
+			// Only counted, the bytes of the temp allocator are read from the allocator itself
+			RegisterLabelAllocation(label, 0);
 			return ptr;
+		}
 
 		// If tempallocator thread has not been initialized fallback to kMemTempOverflow label
 		return Allocate(size, align, kMemTempOverflow, allocateOptions, file, line);
@@ -1019,6 +1044,9 @@ void* MemoryManager::Allocate(size_t size, int align, MemLabelRef label, int all
 	CheckAllocation( ptr, size, align, label, file, line );
 	DebugAssert(((UIntPtr)ptr & (align-1)) == 0);
 
+	RegisterLabelAllocation(label, alloc->GetPtrSize(ptr));
+	TraceAllocation(ptr, size, label);
+
 	// Register allocation in the profiler
 	if (!IsTempLabel(label))
 	{
@@ -1079,7 +1107,21 @@ void* MemoryManager::Reallocate(void* ptr, size_t size, int align, MemLabelRef l
 		if (IsTempAllocatorLabel(label))
 			newptr = ((TempTLSAllocator*) m_FrameTempAllocator)->TempTLSAllocator::Reallocate(ptr, size, align);
 		else
-			newptr = GetAllocator(label)->Reallocate(ptr, size, align);
+		{
+			BaseAllocator* tempAlloc = GetAllocator(label);
+			const size_t oldSize = tempAlloc->Contains(ptr) ? tempAlloc->GetPtrSize(ptr) : 0;
+			if (oldSize != 0)
+				TraceDeallocation(ptr, label);
+			newptr = tempAlloc->Reallocate(ptr, size, align);
+			if (newptr != NULL && oldSize != 0)
+			{
+				RegisterLabelDeallocation(label, oldSize);
+				RegisterLabelAllocation(label, tempAlloc->GetPtrSize(newptr));
+				TraceAllocation(newptr, size, label);
+			}
+			else if (oldSize != 0)
+				TraceAllocation(ptr, oldSize, label);
+		}
 
 		if (newptr)
 			return newptr;
@@ -1107,6 +1149,8 @@ void* MemoryManager::Reallocate(void* ptr, size_t size, int align, MemLabelRef l
 	}
 
 	VerifyPtrIntegrity(alloc, ptr);
+	const size_t oldSize = alloc->GetPtrSize(ptr);
+	TraceDeallocation(ptr, label);
 
 #if ENABLE_MEM_PROFILER
 	// register the deletion of the old allocation and extract the old root owner
@@ -1122,11 +1166,19 @@ void* MemoryManager::Reallocate(void* ptr, size_t size, int align, MemLabelRef l
 
 	void* newptr = alloc->Reallocate(ptr, size, align);
 	if ((allocateOptions & kAllocateOptionReturnNullIfOutOfMemory) && !newptr)
+	{
+		// The old block is still alive
+		TraceAllocation(ptr, oldSize, label);
 		return NULL;
+	}
 
 	CheckAllocation(newptr, size, align, label, file, line);
 	DebugAssert(((UIntPtr) newptr & (align - 1)) == 0);
 
+	RegisterLabelDeallocation(label, oldSize);
+	RegisterLabelAllocation(label, alloc->GetPtrSize(newptr));
+	TraceAllocation(newptr, size, label);
+
 #if ENABLE_MEM_PROFILER
 	RegisterAllocation(newptr, size, CreateMemLabel(GetLabelIdentifier(label), root), "Reallocate", file, line);
 	if(root)
@@ -1163,7 +1215,9 @@ void MemoryManager::Deallocate(void* ptr, MemLabelRef label)
 		if (IsTempAllocatorLabel(label))
 		{
 			// If not found, Fallback to kMemDefault allocator has the pointer
-			if (!((TempTLSAllocator*) m_FrameTempAllocator)->TempTLSAllocator::TryDeallocate(ptr))
+			if (((TempTLSAllocator*) m_FrameTempAllocator)->TempTLSAllocator::TryDeallocate(ptr))
+				RegisterLabelDeallocation(label, 0);
+			else
 				Deallocate(ptr, kMemTempOverflow);
 		}
 		else
@@ -1171,6 +1225,8 @@ void MemoryManager::Deallocate(void* ptr, MemLabelRef label)
 #if !STOMP_TEMP_MEMORY_ON_DEALLOC
 			BaseAllocator* tempAlloc = GetAllocator(label);
 #endif
+			RegisterLabelDeallocation(label, tempAlloc->GetPtrSize(ptr));
+			TraceDeallocation(ptr, label);
 			tempAlloc->Deallocate(ptr);
 		}
 
@@ -1193,6 +1249,8 @@ void MemoryManager::Deallocate(void* ptr, MemLabelRef label)
 	VerifyPtrIntegrity(alloc, ptr);
 
 	RegisterDeallocation(ptr, label, "Deallocate");
+	RegisterLabelDeallocation(label, alloc->GetPtrSize(ptr));
+	TraceDeallocation(ptr, label);
 
 #if STOMP_MEMORY_ON_DEALLOC
 	if(!alloc->IsDelayedRelease())
@@ -1204,8 +1262,14 @@ void MemoryManager::Deallocate(void* ptr, MemLabelRef label)
 
 #else // ENABLE_MEM_PROFILER
 
-	// Without profiler we can go fast path by default
-	if (!alloc->TryDeallocate(ptr))
+	// Without profiler we can go fast path by default, only the label counters need the size before the block is released
+	if (alloc->Contains(ptr))
+	{
+		RegisterLabelDeallocation(label, alloc->GetPtrSize(ptr));
+		TraceDeallocation(ptr, label);
+		alloc->Deallocate(ptr);
+	}
+	else
 		Deallocate(ptr);
 
 #endif // ENABLE_MEM_PROFILER
@@ -1494,15 +1558,8 @@ int MemoryManager::GetAllocatorCount( )
 
 size_t MemoryManager::GetAllocatedMemory( MemLabelRef label )
 {
-#if ENABLE_MEM_PROFILER
-	if (IsTempAllocatorLabel(label))
-	{
-		return m_FrameTempAllocator->GetAllocatedMemorySize();
-	}
-	return AtomicAdd(&m_AllocatorMap[GetLabelIdentifier(label)].allocatedMemory, 0);
-#else
-	return 0;
-#endif
+	MemLabelStats stats;
+	return GetLabelStats(label, stats) ? (size_t)stats.allocatedBytes : 0;
 }
 
 size_t MemoryManager::GetTotalProfilerMemory()
@@ -1512,20 +1569,28 @@ size_t MemoryManager::GetTotalProfilerMemory()
 
 int MemoryManager::GetAllocCount( MemLabelRef label )
 {
-#if ENABLE_MEM_PROFILER
-	return AtomicAdd(&m_AllocatorMap[GetLabelIdentifier(label)].numAllocs, 0);
-#else
-	return 0;
-#endif
+	MemLabelStats stats;
+	return GetMemoryLabelStats(label, stats) ? (int)stats.allocationCount : 0;
 }
 
 size_t MemoryManager::GetLargestAlloc( MemLabelRef label )
 {
-#if ENABLE_MEM_PROFILER
-	return AtomicAdd(&m_AllocatorMap[GetLabelIdentifier(label)].largestAlloc, 0);
-#else
-	return 0;
-#endif
+	MemLabelStats stats;
+	return GetMemoryLabelStats(label, stats) ? (size_t)stats.largestAllocation : 0;
+}
+
+bool MemoryManager::GetLabelStats(MemLabelRef label, MemLabelStats& stats)
+{
+	if (!GetMemoryLabelStats(label, stats))
+		return false;
+
+	// Allocations of the temp allocator are only counted, its bytes come from the per thread stacks
+	if (IsTempAllocatorLabel(label))
+	{
+		stats.allocatedBytes = m_FrameTempAllocator->GetAllocatedMemorySize();
+		stats.peakAllocatedBytes = m_FrameTempAllocator->GetPeakAllocatedMemorySize();
+	}
+	return true;
 }
 
 void MemoryManager::StartLoggingAllocations(size_t logAllocationsThreshold)
@@ -1582,26 +1647,252 @@ int catchMemoryAllocHook(int allocType, void *userData, size_t size, int blockTy
 
 #else // !ENABLE_MEMORY_MANAGER
 
-void* malloc_internal(size_t size, size_t align, MemLabelRef label, int allocateOptions, const char* file, int line)
+#include "Allocator/LowLevelDefaultAllocator.h"
+#include "Threads/ThreadSpecificValue.h"
+
+// Freed small blocks are kept in per thread caches and handed out again without going through the platform heap,
+// which takes a lock or an atomic on most platforms. Job inputs and module data are mostly this small. The block size
+// query tells which size class a freed block can serve, platforms without one don't cache.
+#define ENABLE_SMALL_BLOCK_CACHE (UNITY_LL_HAS_SIZE && SUPPORT_THREADS)
+
+#if ENABLE_SMALL_BLOCK_CACHE
+
+enum
+{
+	kSmallBlockClassCount = 5,			// 32, 64, 128, 256 and 512 bytes
+	kSmallBlockMinShift = 5,
+	kSmallBlockMaxSize = 1 << (kSmallBlockMinShift + kSmallBlockClassCount - 1),
+	kSmallBlockCacheCapacity = 32		// Blocks per class and thread, the rest goes back to the heap
+};
+
+struct SmallBlock
+{
+	SmallBlock* next;
+};
+
+struct SmallBlockCache
+{
+	SmallBlock* blocks[kSmallBlockClassCount];
+	int         count[kSmallBlockClassCount];
+};
+
+static UNITY_TLS_VALUE(SmallBlockCache*) s_SmallBlockCache;
+
+static inline size_t GetSmallBlockClassSize(int index)
+{
+	return (size_t)1 << (kSmallBlockMinShift + index);
+}
+
+static SmallBlockCache* GetSmallBlockCache()
+{
+	SmallBlockCache* cache = s_SmallBlockCache;
+	if (cache == NULL)
+	{
+		// Taken from the heap directly, malloc_internal would come back here
+		cache = (SmallBlockCache*)UNITY_LL_ALLOC(kMemDefault, sizeof(SmallBlockCache), kDefaultMemoryAlignment);
+		if (cache == NULL)
+			return NULL;
+		memset(cache, 0, sizeof(SmallBlockCache));
+		s_SmallBlockCache = cache;
+	}
+	return cache;
+}
+
+// Returns NULL if the size has no class or the thread's cache for it is empty
+static inline void* AllocateFromSmallBlockCache(size_t size, size_t align, int& classIndex)
+{
+	classIndex = -1;
+	if (size > kSmallBlockMaxSize || align > kDefaultMemoryAlignment)
+		return NULL;
+
+	classIndex = 0;
+	while (GetSmallBlockClassSize(classIndex) < size)
+		classIndex++;
+
+	SmallBlockCache* cache = s_SmallBlockCache;
+	if (cache == NULL || cache->blocks[classIndex] == NULL)
+		return NULL;
+
+	SmallBlock* block = cache->blocks[classIndex];
+	cache->blocks[classIndex] = block->next;
+	cache->count[classIndex]--;
+	return block;
+}
+
+// Returns false if the block has to go back to the heap
+static inline bool DeallocateToSmallBlockCache(void* ptr)
+{
+	// Blocks of any thread can be cached, they all come from the same heap
+	const size_t size = UNITY_LL_SIZE(ptr);
+	if (size < GetSmallBlockClassSize(0) || size >= 2 * kSmallBlockMaxSize || ((UIntPtr)ptr & (kDefaultMemoryAlignment - 1)) != 0)
+		return false;
+
+	// The largest class the block can serve, the heap may have rounded it up past the size it was allocated with
+	int classIndex = kSmallBlockClassCount - 1;
+	while (GetSmallBlockClassSize(classIndex) > size)
+		classIndex--;
+
+	SmallBlockCache* cache = GetSmallBlockCache();
+	if (cache == NULL || cache->count[classIndex] == kSmallBlockCacheCapacity)
+		return false;
+
+	SmallBlock* block = (SmallBlock*)ptr;
+	block->next = cache->blocks[classIndex];
+	cache->blocks[classIndex] = block;
+	cache->count[classIndex]++;
+	return true;
+}
+
+void FlushThreadSmallBlockCache()
 {
+	SmallBlockCache* cache = s_SmallBlockCache;
+	if (cache == NULL)
+		return;
+
+	s_SmallBlockCache = NULL;
+	for (int i = 0; i < kSmallBlockClassCount; ++i)
+	{
+		while (cache->blocks[i] != NULL)
+		{
+			SmallBlock* block = cache->blocks[i];
+			cache->blocks[i] = block->next;
+			UNITY_LL_FREE(kMemDefault, block);
+		}
+	}
+	UNITY_LL_FREE(kMemDefault, cache);
+}
+
+#else
+
+void FlushThreadSmallBlockCache()
+{
+}
+
+#endif // ENABLE_SMALL_BLOCK_CACHE
+
+// Large blocks of the huge page labels come from LowLevelHugePageAllocator, everything else from the platform heap
+
+static inline void* AllocateLowLevel(MemLabelRef label, size_t size, size_t align)
+{
+	if (LowLevelHugePageAllocator::IsHugePageLabel(label))
+	{
+		void* ptr = LowLevelHugePageAllocator::Malloc(size, align);
+		if (ptr != NULL)
+			return ptr;
+	}
+
+#if ENABLE_SMALL_BLOCK_CACHE
+	int classIndex;
+	void* ptr = AllocateFromSmallBlockCache(size, align, classIndex);
+	if (ptr != NULL)
+		return ptr;
+	// Blocks of a class all have its full size, so any of them can serve any size of the class once freed
+	if (classIndex >= 0)
+		return UNITY_LL_ALLOC(label, GetSmallBlockClassSize(classIndex), kDefaultMemoryAlignment);
+#endif
+
 	return UNITY_LL_ALLOC(label, size, align);
 }
 
+static inline size_t GetLowLevelPtrSize(MemLabelRef label, void* ptr)
+{
+	if (LowLevelHugePageAllocator::IsHugePageLabel(label) && LowLevelHugePageAllocator::Contains(ptr))
+		return LowLevelHugePageAllocator::GetPtrSize(ptr);
+	return UNITY_LL_SIZE(ptr);
+}
+
+static inline void FreeLowLevel(MemLabelRef label, void* ptr)
+{
+	if (LowLevelHugePageAllocator::IsHugePageLabel(label) && LowLevelHugePageAllocator::Contains(ptr))
+		LowLevelHugePageAllocator::Free(ptr);
+#if ENABLE_SMALL_BLOCK_CACHE
+	else if (!DeallocateToSmallBlockCache(ptr))
+		UNITY_LL_FREE(label, ptr);
+#else
+	else
+		UNITY_LL_FREE(label, ptr);
+#endif
+}
+
+static inline void* ReallocateLowLevel(MemLabelRef label, void* ptr, size_t size, size_t align, size_t oldSize)
+{
+	if (LowLevelHugePageAllocator::IsHugePageLabel(label))
+	{
+		const bool isHugePage = LowLevelHugePageAllocator::Contains(ptr);
+		if (isHugePage && size <= oldSize && size >= LowLevelHugePageAllocator::kMinAllocationSize)
+			return ptr;
+
+		// Blocks move between the heaps as arrays grow past or shrink below the huge page threshold
+		if (isHugePage || size >= LowLevelHugePageAllocator::kMinAllocationSize)
+		{
+			void* newPtr = size != 0 ? AllocateLowLevel(label, size, align) : NULL;
+			if (newPtr == NULL && size != 0)
+				return NULL;
+
+			if (newPtr != NULL)
+				memcpy(newPtr, ptr, std::min(oldSize, size));
+			FreeLowLevel(label, ptr);
+			return newPtr;
+		}
+	}
+	return UNITY_LL_REALLOC(label, ptr, size, align);
+}
+
+void* malloc_internal(size_t size, size_t align, MemLabelRef label, int allocateOptions, const char* file, int line)
+{
+	void* ptr = AllocateLowLevel(label, size, align);
+	if (ptr != NULL)
+	{
+		RegisterLabelAllocation(label, GetLowLevelPtrSize(label, ptr));
+		TraceAllocation(ptr, size, label);
+	}
+	return ptr;
+}
+
 void* calloc_internal(size_t count, size_t size, int align, MemLabelRef label, int allocateOptions, const char* file, int line)
 {
-	void* ptr = UNITY_LL_ALLOC(label, size * count, align);
+	void* ptr = AllocateLowLevel(label, size * count, align);
 	memset (ptr, 0, size * count);
+	if (ptr != NULL)
+	{
+		RegisterLabelAllocation(label, GetLowLevelPtrSize(label, ptr));
+		TraceAllocation(ptr, size * count, label);
+	}
 	return ptr;
 }
 
 void* realloc_internal(void* ptr, size_t size, int align, MemLabelRef label, int allocateOptions, const char* file, int line)
 {
-	return UNITY_LL_REALLOC(label, ptr, size, align);
+	if (ptr == NULL)
+		return malloc_internal(size, align, label, allocateOptions, file, line);
+
+	const size_t oldSize = GetLowLevelPtrSize(label, ptr);
+	TraceDeallocation(ptr, label);
+	void* newptr = ReallocateLowLevel(label, ptr, size, align, oldSize);
+	// On failure the old block stays alive, a zero size releases it
+	if (newptr == NULL && size != 0)
+	{
+		TraceAllocation(ptr, oldSize, label);
+		return NULL;
+	}
+
+	RegisterLabelDeallocation(label, oldSize);
+	if (newptr != NULL)
+	{
+		RegisterLabelAllocation(label, GetLowLevelPtrSize(label, newptr));
+		TraceAllocation(newptr, size, label);
+	}
+	return newptr;
 }
 
 void free_alloc_internal(void* ptr, MemLabelRef label)
 {
-	UNITY_LL_FREE(label, ptr);
+	if (ptr == NULL)
+		return;
+
+	RegisterLabelDeallocation(label, GetLowLevelPtrSize(label, ptr));
+	TraceDeallocation(ptr, label);
+	FreeLowLevel(label, ptr);
 }
 
 #if !((UNITY_OSX || UNITY_LINUX) && UNITY_EDITOR)
@@ -4,6 +4,7 @@
 #include "Misc/AllocatorLabels.h"
 #include "Allocator/BaseAllocator.h"
 #include "Allocator/MemoryMacros.h"
+#include "Allocator/MemoryLabelStats.h"
 #include "Threads/Mutex.h"
 
 #if ENABLE_MEMORY_MANAGER
@@ -63,6 +64,8 @@ public:
 	size_t GetAllocatedMemory( MemLabelRef label );
 	int GetAllocCount( MemLabelRef label );
 	size_t GetLargestAlloc(MemLabelRef label);
+	// Counters of MemoryLabelStats, with the bytes of the temp allocator filled in from the allocator
+	bool GetLabelStats(MemLabelRef label, MemLabelStats& stats);
 
 
 	size_t GetRegisteredGFXDriverMemory(){ return m_RegisteredGfxDriverMemory;}
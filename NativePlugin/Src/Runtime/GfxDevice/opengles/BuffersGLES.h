@@ -62,7 +62,7 @@ struct VertexBufferUsageMapperGLES
 template <class TBuffer, class UsageMapper> class DrawBufferGLES : public TBuffer
 {
 public:
-	DrawBufferGLES() : TBuffer(), m_Buffer(0), m_IsMapped(false)
+	DrawBufferGLES() : TBuffer(), m_Buffer(0), m_BufferData(kMemDynamicGeometry), m_IsMapped(false)
 	{
 		TBuffer::m_BufferSize = 0;
 		m_Usage = UsageMapper::map(TBuffer::m_Mode);
@@ -114,7 +114,7 @@ void GradientNEW::SetAlphaKeys (AlphaKey* alphaKeys, unsigned numKeys)
 	ValidateAlphaKeys();
 }
 
-void GradientNEW::SetKeys(MonoColorKey** colorKeys, unsigned numColorKeys, MonoAlphaKey** alphaKeys, unsigned numAlphaKeys)
+void GradientNEW::SetKeys(const MonoColorKey* colorKeys, unsigned numColorKeys, const MonoAlphaKey* alphaKeys, unsigned numAlphaKeys)
 {
 	if (numColorKeys > kGradientMaxNumKeys)
 		numColorKeys = kGradientMaxNumKeys;
@@ -125,8 +125,8 @@ void GradientNEW::SetKeys(MonoColorKey** colorKeys, unsigned numColorKeys, MonoA
 	int i = 0;
 	for (i = 0; i < numColorKeys; ++i)
 	{
-		m_Keys[i] = colorKeys[i]->color;
-		m_ColorTime[i] = colorKeys[i]->time;
+		m_Keys[i] = colorKeys[i].color;
+		m_ColorTime[i] = colorKeys[i].time;
 	}
 
 	m_NumColorKeys = numColorKeys;
@@ -149,8 +149,8 @@ void GradientNEW::SetKeys(MonoColorKey** colorKeys, unsigned numColorKeys, MonoA
 
 	for (i = 0; i < numAlphaKeys; ++i)
 	{
-		m_Keys[i] = alphaKeys[i]->alpha;
-		m_AlphaTime[i] = alphaKeys[i]->time;
+		m_Keys[i] = alphaKeys[i].alpha;
+		m_AlphaTime[i] = alphaKeys[i].time;
 	}
 
 	m_NumAlphaKeys = numAlphaKeys;
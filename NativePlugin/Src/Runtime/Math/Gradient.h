@@ -76,7 +76,7 @@ public:
 
 	void SetColorKeys (ColorKey* colorKeys, unsigned numKeys);
 	void SetAlphaKeys (AlphaKey* alphaKeys, unsigned numKeys);
-	void SetKeys(MonoColorKey** colorKeys, unsigned numColorKeys, MonoAlphaKey** alphaKeys, unsigned numAlphaKeys);
+	void SetKeys(const MonoColorKey* colorKeys, unsigned numColorKeys, const MonoAlphaKey* alphaKeys, unsigned numAlphaKeys);
 
 	void SetNumColorKeys (int numColorKeys) { m_NumColorKeys = numColorKeys;};
 	void SetNumAlphaKeys (int numAlphaKeys) { m_NumAlphaKeys = numAlphaKeys; };
@@ -2,6 +2,9 @@
 #include "Matrix4x4.h"
 #include "Quaternion.h"
 #include "Utilities/Utility.h"
+#if UNITY_SUPPORTS_SSE
+#include <xmmintrin.h>
+#endif
 
 const Matrix4x4f Matrix4x4f::identity(kIdentity);
 
@@ -581,17 +584,43 @@ void Matrix4x4f::SetTRInverse (const Vector3f& pos, const Quaternionf& q)
 	Translate (Vector3f (-pos[0], -pos[1], -pos[2]));
 }
 
+#if UNITY_SUPPORTS_SSE
+// Columns stay in registers for the whole array; in and out may be the same array
+static void TransformPointsSSE (const Matrix4x4f& matrix, const Vector3f* in, Vector3f* out, int count, bool translate)
+{
+	const __m128 c0 = _mm_loadu_ps (matrix.m_Data + 0);
+	const __m128 c1 = _mm_loadu_ps (matrix.m_Data + 4);
+	const __m128 c2 = _mm_loadu_ps (matrix.m_Data + 8);
+	const __m128 c3 = translate ? _mm_loadu_ps (matrix.m_Data + 12) : _mm_setzero_ps ();
+	for (int i=0;i<count;i++)
+	{
+		__m128 r = _mm_add_ps (_mm_mul_ps (c0, _mm_set1_ps (in[i].x)), _mm_mul_ps (c1, _mm_set1_ps (in[i].y)));
+		r = _mm_add_ps (r, _mm_add_ps (_mm_mul_ps (c2, _mm_set1_ps (in[i].z)), c3));
+		_mm_storel_pi ((__m64*)&out[i].x, r);
+		_mm_store_ss (&out[i].z, _mm_movehl_ps (r, r));
+	}
+}
+#endif
+
 void TransformPoints3x3 (const Matrix4x4f& matrix, const Vector3f* in, Vector3f* out, int count)
 {
+#if UNITY_SUPPORTS_SSE
+	TransformPointsSSE (matrix, in, out, count, false);
+#else
 	Matrix3x3f m = Matrix3x3f(matrix);
 	for (int i=0;i<count;i++)
 		out[i] = m.MultiplyPoint3 (in[i]);
+#endif
 }
 
 void TransformPoints3x4 (const Matrix4x4f& matrix, const Vector3f* in, Vector3f* out, int count)
 {
+#if UNITY_SUPPORTS_SSE
+	TransformPointsSSE (matrix, in, out, count, true);
+#else
 	for (int i=0;i<count;i++)
 		out[i] = matrix.MultiplyPoint3 (in[i]);
+#endif
 }
 
 void TransformPoints3x3 (const Matrix4x4f& matrix, const Vector3f* in, size_t inStride, Vector3f* out, size_t outStride, int count)
@@ -4,6 +4,8 @@ DO_LABEL(Utility)
 DO_LABEL(Thread)
 DO_LABEL(PoolAlloc)
 DO_LABEL(GfxDevice)
+DO_LABEL(ParticleSystem)
+DO_LABEL(DynamicGeometry)
 
 // Labels for temporary allocations without profiler information
 DO_TEMP_LABEL(TempAlloc)
@@ -8,7 +8,7 @@ void UpdateTpl(const ParticleSystemParticles& ps, ColorRGBA32* colorTemp, const
 	for (size_t q = fromIndex; q < toIndex; ++q)
 	{
 		const float time = NormalizedTime(ps, q);
-		const int random = GenerateRandomByte(ps.randomSeed[q] + kParticleSystemColorGradientId);
+		const int random = GenerateRandomByte(ps.randomSeed[q], kParticleSystemColorGradientId);
 
 		ColorRGBA32 value;
 		if(mode == kGEMGradient)
@@ -23,9 +23,16 @@ void UpdateTpl(const ParticleSystemParticles& ps, ColorRGBA32* colorTemp, const
 }
 
 ColorModule::ColorModule () : ParticleSystemModule(false)
+	, m_BakedGradient(nullptr)
+	, m_GradientDirty(true)
 {}
 
-void ColorModule::Init(ParticleSystemInitState* initState)
+ColorModule::~ColorModule ()
+{
+	delete m_BakedGradient;
+}
+
+void ColorModule::Init(const ParticleSystemInitState* initState)
 {
 	SetEnabled(initState->colorModuleEnable);
 
@@ -34,21 +41,54 @@ void ColorModule::Init(ParticleSystemInitState* initState)
 		m_Gradient.maxColor = initState->colorModuleMinMaxGradient->maxColor;
 		m_Gradient.minColor = initState->colorModuleMinMaxGradient->minColor;
 		m_Gradient.minMaxState = initState->colorModuleMinMaxGradient->minMaxState;
-		MonoGradient* maxGradient = initState->colorModuleMinMaxGradient->maxGradient;
+		const MonoGradient* maxGradient = initState->colorModuleMinMaxGradient->maxGradient;
 		m_Gradient.maxGradient.SetKeys(maxGradient->colorKeys, maxGradient->colorKeyCount, maxGradient->alphaKeys, maxGradient->alphaKeyCount);
-		MonoGradient* minGradient = initState->colorModuleMinMaxGradient->minGradient;
+		const MonoGradient* minGradient = initState->colorModuleMinMaxGradient->minGradient;
 		m_Gradient.minGradient.SetKeys(minGradient->colorKeys, minGradient->colorKeyCount, minGradient->alphaKeys, minGradient->alphaKeyCount);
+		RebuildGradientCache();
 	}
 }
 
-void ColorModule::Update (const ParticleSystemParticles& ps, ColorRGBA32* colorTemp, size_t fromIndex, size_t toIndex)
+void ColorModule::RebuildGradientCache ()
 {
-	OptimizedMinMaxGradient gradient;
-	m_Gradient.InitializeOptimized(gradient);
-	if(m_Gradient.minMaxState == kMMGGradient)
-		UpdateTpl<kGEMGradient>(ps, colorTemp, m_Gradient, gradient, fromIndex, toIndex);
+	m_Gradient.InitializeOptimized(m_OptimizedGradient);
+
+	const bool usesGradient = (m_Gradient.minMaxState == kMMGGradient) || (m_Gradient.minMaxState == kMMGRandomBetweenTwoGradients);
+	if (usesGradient && ParticleSystemModule::GetGradientBaking())
+	{
+		if (!m_BakedGradient)
+			m_BakedGradient = new BakedMinMaxGradient();
+		m_Gradient.Bake(*m_BakedGradient);
+	}
+	else
+	{
+		delete m_BakedGradient;
+		m_BakedGradient = nullptr;
+	}
+
+	m_GradientDirty = false;
+}
+
+void ColorModule::Update (const ParticleSystemParticles& ps, ColorRGBA32* colorTemp, size_t fromIndex, size_t toIndex) const
+{
+	if (m_BakedGradient)
+	{
+		const bool minMax = (m_Gradient.minMaxState == kMMGRandomBetweenTwoGradients);
+		float time[kParticleSystemCurveBatchSize];
+		ColorRGBA32 value[kParticleSystemCurveBatchSize];
+		for (size_t from = fromIndex; from < toIndex; from += kParticleSystemCurveBatchSize)
+		{
+			const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, toIndex - from);
+			NormalizedTimeBatch(ps, from, count, time);
+			EvaluateBatch(*m_BakedGradient, minMax, time, &ps.randomSeed[from], kParticleSystemColorGradientId, value, count);
+			for (size_t i = 0; i < count; ++i)
+				colorTemp[from + i] *= value[i];
+		}
+	}
+	else if(m_Gradient.minMaxState == kMMGGradient)
+		UpdateTpl<kGEMGradient>(ps, colorTemp, m_Gradient, m_OptimizedGradient, fromIndex, toIndex);
 	else if(m_Gradient.minMaxState == kMMGRandomBetweenTwoGradients)
-		UpdateTpl<kGEMGradientMinMax>(ps, colorTemp, m_Gradient, gradient, fromIndex, toIndex);
+		UpdateTpl<kGEMGradientMinMax>(ps, colorTemp, m_Gradient, m_OptimizedGradient, fromIndex, toIndex);
 	else
-		UpdateTpl<kGEMSlow>(ps, colorTemp, m_Gradient, gradient, fromIndex, toIndex);
+		UpdateTpl<kGEMSlow>(ps, colorTemp, m_Gradient, m_OptimizedGradient, fromIndex, toIndex);
 }
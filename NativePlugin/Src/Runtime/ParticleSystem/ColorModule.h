@@ -2,18 +2,31 @@
 
 #include "ParticleSystemModule.h"
 #include "ParticleSystemGradients.h"
+#include "Utilities/NonCopyable.h"
 
-class ColorModule : public ParticleSystemModule
+// Not copyable, it owns the baked gradient
+class ColorModule : public ParticleSystemModule, NonCopyable
 {
 public:
 	ColorModule ();
+	~ColorModule ();
 
-    void Init(ParticleSystemInitState* initState);
-	void Update (const ParticleSystemParticles& ps, ColorRGBA32* colorTemp, size_t fromIndex, size_t toIndex);
+    void Init(const ParticleSystemInitState* initState);
+	// Read-only, can run on job threads
+	void Update (const ParticleSystemParticles& ps, ColorRGBA32* colorTemp, size_t fromIndex, size_t toIndex) const;
 	void CheckConsistency() {};
 
-	inline MinMaxGradient& GetGradient() { return m_Gradient; };
+	// The optimized/baked gradients are rebuilt by the next UpdateGradientCache after the gradient was accessed for modification.
+	inline MinMaxGradient& GetGradient() { m_GradientDirty = true; return m_Gradient; };
+	// Call on the main thread, before jobs that Update this module are scheduled
+	inline void UpdateGradientCache() { if (m_GradientDirty) RebuildGradientCache(); }
+	inline const MinMaxGradient& GetGradient() const { return m_Gradient; };
 	
 private:
+	void RebuildGradientCache ();
+
 	MinMaxGradient m_Gradient;
+	OptimizedMinMaxGradient m_OptimizedGradient;
+	BakedMinMaxGradient* m_BakedGradient;	// Only allocated when gradient baking is enabled
+	bool m_GradientDirty;
 };
@@ -0,0 +1,235 @@
+#include "PluginPrefix.h"
+#include "ExternalForcesModule.h"
+#include "ParticleSystemForceFields.h"
+#include "ParticleSystemParticles.h"
+#include "ParticleSystemCurves.h"
+#include "Math/FloatConversion.h"
+#include "Math/Matrix4x4.h"
+#include "Utilities/Utility.h"
+#include <float.h>
+
+#if UNITY_SUPPORTS_SSE
+#include <xmmintrin.h>
+#endif
+
+// Force field parameters in simulation space, with the per field terms of the kernels folded in
+struct ForceFieldKernelData
+{
+	Vector3f position;
+	Vector3f direction;			// Normalized
+	float sqrRadius;			// FLT_MAX for unbounded fields
+	float falloffOverRadius;
+	float strength;
+	float frequency;
+};
+
+typedef void (*ForceFieldKernel)(const ForceFieldKernelData& field, const float* x, const float* y, const float* z, float* fx, float* fy, float* fz, size_t count);
+
+// Directional, radial and vortex fields. Positions are passed as separate x, y and z arrays so the SSE path
+// handles four particles per iteration; count must be a multiple of 4 when it is used.
+template<int type>
+static void AccumulateForce(const ForceFieldKernelData& field, const float* x, const float* y, const float* z, float* fx, float* fy, float* fz, size_t count)
+{
+#if UNITY_SUPPORTS_SSE
+	const __m128 px = _mm_set1_ps(field.position.x);
+	const __m128 py = _mm_set1_ps(field.position.y);
+	const __m128 pz = _mm_set1_ps(field.position.z);
+	const __m128 ax = _mm_set1_ps(field.direction.x);
+	const __m128 ay = _mm_set1_ps(field.direction.y);
+	const __m128 az = _mm_set1_ps(field.direction.z);
+	const __m128 sqrRadius = _mm_set1_ps(field.sqrRadius);
+	const __m128 falloffOverRadius = _mm_set1_ps(field.falloffOverRadius);
+	const __m128 strength = _mm_set1_ps(field.strength);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 epsilon = _mm_set1_ps(1e-6f);
+	for (size_t i = 0; i < count; i += 4)
+	{
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), px);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), py);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), pz);
+		const __m128 sqrDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		const __m128 distance = _mm_sqrt_ps(sqrDistance);
+		__m128 scale = _mm_mul_ps(strength, _mm_sub_ps(one, _mm_mul_ps(falloffOverRadius, distance)));
+		scale = _mm_and_ps(scale, _mm_cmplt_ps(sqrDistance, sqrRadius));
+
+		__m128 vx, vy, vz;
+		if (type == kForceFieldDirectional)
+		{
+			vx = _mm_mul_ps(ax, scale);
+			vy = _mm_mul_ps(ay, scale);
+			vz = _mm_mul_ps(az, scale);
+		}
+		else
+		{
+			// Radial pushes along the offset, vortex along the tangent around the axis
+			__m128 tx = dx, ty = dy, tz = dz, length = distance;
+			if (type == kForceFieldVortex)
+			{
+				tx = _mm_sub_ps(_mm_mul_ps(ay, dz), _mm_mul_ps(az, dy));
+				ty = _mm_sub_ps(_mm_mul_ps(az, dx), _mm_mul_ps(ax, dz));
+				tz = _mm_sub_ps(_mm_mul_ps(ax, dy), _mm_mul_ps(ay, dx));
+				length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+			}
+			const __m128 s = _mm_div_ps(scale, _mm_max_ps(length, epsilon));
+			vx = _mm_mul_ps(tx, s);
+			vy = _mm_mul_ps(ty, s);
+			vz = _mm_mul_ps(tz, s);
+		}
+
+		_mm_storeu_ps(fx + i, _mm_add_ps(_mm_loadu_ps(fx + i), vx));
+		_mm_storeu_ps(fy + i, _mm_add_ps(_mm_loadu_ps(fy + i), vy));
+		_mm_storeu_ps(fz + i, _mm_add_ps(_mm_loadu_ps(fz + i), vz));
+	}
+#else
+	const Vector3f& axis = field.direction;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vector3f offset(x[i] - field.position.x, y[i] - field.position.y, z[i] - field.position.z);
+		const float sqrDistance = SqrMagnitude(offset);
+		if (sqrDistance >= field.sqrRadius)
+			continue;
+
+		const float distance = Sqrt(sqrDistance);
+		const float scale = field.strength * (1.0f - field.falloffOverRadius * distance);
+		Vector3f force;
+		if (type == kForceFieldDirectional)
+			force = axis * scale;
+		else if (type == kForceFieldRadial)
+			force = offset * (scale / std::max(distance, 1e-6f));
+		else
+		{
+			const Vector3f tangent = Cross(axis, offset);
+			force = tangent * (scale / std::max(Magnitude(tangent), 1e-6f));
+		}
+
+		fx[i] += force.x;
+		fy[i] += force.y;
+		fz[i] += force.z;
+	}
+#endif
+}
+
+// Arnold-Beltrami-Childress flow: divergence free, so particles swirl without bunching up. Scalar, the trigonometry dominates.
+static void AccumulateTurbulence(const ForceFieldKernelData& field, const float* x, const float* y, const float* z, float* fx, float* fy, float* fz, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vector3f offset(x[i] - field.position.x, y[i] - field.position.y, z[i] - field.position.z);
+		const float sqrDistance = SqrMagnitude(offset);
+		if (sqrDistance >= field.sqrRadius)
+			continue;
+
+		const float scale = 0.5f * field.strength * (1.0f - field.falloffOverRadius * Sqrt(sqrDistance));
+		const Vector3f p = offset * field.frequency;
+		fx[i] += scale * (Sin(p.z) + Cos(p.y));
+		fy[i] += scale * (Sin(p.x) + Cos(p.z));
+		fz[i] += scale * (Sin(p.y) + Cos(p.x));
+	}
+}
+
+static const ForceFieldKernel s_ForceFieldKernels[kForceFieldTypeCount] =
+{
+	&AccumulateForce<kForceFieldDirectional>,
+	&AccumulateForce<kForceFieldRadial>,
+	&AccumulateForce<kForceFieldVortex>,
+	&AccumulateTurbulence,
+};
+
+ExternalForcesModule::ExternalForcesModule() : ParticleSystemModule(false)
+	, m_Multiplier(1.0f)
+{}
+
+void ExternalForcesModule::Update(const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, float dt) const
+{
+	const ParticleSystemForceFields& forceFields = ParticleSystemForceFields::Get();
+	const size_t particleCount = ps.array_size();
+	if (fromIndex >= particleCount || forceFields.IsEmpty())
+		return;
+
+	// Bounds of the particles as they are now, which is what the fields are looked up with
+	Vector3f boundsMin = ps.position[fromIndex];
+	Vector3f boundsMax = boundsMin;
+	for (size_t q = fromIndex + 1; q < particleCount; ++q)
+	{
+		boundsMin = min(boundsMin, ps.position[q]);
+		boundsMax = max(boundsMax, ps.position[q]);
+	}
+
+	if (initState.useLocalSpace)
+	{
+		Vector3f worldMin = state.localToWorld.MultiplyPoint3(boundsMin);
+		Vector3f worldMax = worldMin;
+		for (int corner = 1; corner < 8; ++corner)
+		{
+			const Vector3f p(corner & 1 ? boundsMax.x : boundsMin.x, corner & 2 ? boundsMax.y : boundsMin.y, corner & 4 ? boundsMax.z : boundsMin.z);
+			const Vector3f worldP = state.localToWorld.MultiplyPoint3(p);
+			worldMin = min(worldMin, worldP);
+			worldMax = max(worldMax, worldP);
+		}
+		boundsMin = worldMin;
+		boundsMax = worldMax;
+	}
+
+	dynamic_array<ForceField> fields(kMemTempAlloc);
+	forceFields.Query(boundsMin, boundsMax, fields);
+	if (fields.empty())
+		return;
+
+	// Local space systems evaluate the fields in local space, assuming a uniform scale
+	const float localScale = initState.useLocalSpace ? Magnitude(state.WorldToLocal.MultiplyVector3(Vector3f(1.0f, 0.0f, 0.0f))) : 1.0f;
+	dynamic_array<ForceFieldKernelData> kernelData(kMemTempAlloc);
+	kernelData.resize_uninitialized(fields.size());
+	for (size_t f = 0; f < fields.size(); ++f)
+	{
+		const ForceField& field = fields[f];
+		ForceFieldKernelData& data = kernelData[f];
+		data.position = field.position;
+		data.direction = NormalizeSafe(field.direction, Vector3f::yAxis);
+		if (initState.useLocalSpace)
+		{
+			data.position = state.WorldToLocal.MultiplyPoint3(data.position);
+			data.direction = NormalizeSafe(state.WorldToLocal.MultiplyVector3(data.direction), Vector3f::yAxis);
+		}
+
+		const float radius = field.radius * localScale;
+		data.sqrRadius = field.radius > 0.0f ? radius * radius : FLT_MAX;
+		data.falloffOverRadius = field.radius > 0.0f ? clamp01(field.falloff) / radius : 0.0f;
+		data.strength = field.strength * localScale;
+		data.frequency = field.frequency / localScale;
+	}
+
+	float x[kParticleSystemCurveBatchSize];
+	float y[kParticleSystemCurveBatchSize];
+	float z[kParticleSystemCurveBatchSize];
+	float fx[kParticleSystemCurveBatchSize];
+	float fy[kParticleSystemCurveBatchSize];
+	float fz[kParticleSystemCurveBatchSize];
+	const float scaledDt = m_Multiplier * dt;
+	for (size_t from = fromIndex; from < particleCount; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, particleCount - from);
+		const Vector3f* position = &ps.position[from];
+		for (size_t i = 0; i < count; ++i)
+		{
+			x[i] = position[i].x;
+			y[i] = position[i].y;
+			z[i] = position[i].z;
+		}
+
+		// Pad to a multiple of 4 for the SIMD kernels, the forces of the padding are discarded
+		const size_t paddedCount = (count + 3) & ~size_t(3);
+		for (size_t i = count; i < paddedCount; ++i)
+			x[i] = y[i] = z[i] = 0.0f;
+		std::fill(fx, fx + paddedCount, 0.0f);
+		std::fill(fy, fy + paddedCount, 0.0f);
+		std::fill(fz, fz + paddedCount, 0.0f);
+
+		// All fields for one tile at a time, so the tile stays in cache
+		for (size_t f = 0; f < fields.size(); ++f)
+			s_ForceFieldKernels[fields[f].type](kernelData[f], x, y, z, fx, fy, fz, paddedCount);
+
+		Vector3f* velocity = &ps.velocity[from];
+		for (size_t i = 0; i < count; ++i)
+			velocity[i] += Vector3f(fx[i], fy[i], fz[i]) * scaledDt;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef SHURIKENMODULEEXTERNALFORCES_H
+#define SHURIKENMODULEEXTERNALFORCES_H
+
+#include "ParticleSystemModule.h"
+
+struct ParticleSystemParticles;
+
+// Applies the force fields of ParticleSystemForceFields to the particles. Only the fields overlapping
+// the bounds of the particles are evaluated, so systems far away from any field only pay for the bounds.
+class ExternalForcesModule : public ParticleSystemModule
+{
+public:
+	ExternalForcesModule();
+
+	// Adds the forces at the particles [fromIndex, end) times dt to their velocity, before they are integrated
+	void Update(const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, float dt) const;
+
+	void SetMultiplier(float multiplier) { m_Multiplier = multiplier; }
+	float GetMultiplier() const { return m_Multiplier; }
+
+private:
+	float m_Multiplier;
+};
+
+#endif // SHURIKENMODULEEXTERNALFORCES_H
@@ -1,5 +1,6 @@
 #include "PluginPrefix.h"
 #include "InitialModule.h"
+#include "ParticleSystemUtils.h"
 
 InitialModule::InitialModule() : ParticleSystemModule(true)
 , m_GravityModifier(0.0f)
@@ -9,7 +10,7 @@ InitialModule::InitialModule() : ParticleSystemModule(true)
 
 }
 
-void InitialModule::Init(ParticleSystemInitState* initState)
+void InitialModule::Init(const ParticleSystemInitState* initState)
 {
     ResetSeed(*initState);
     ParticleSystemModule::InitCurveFromMono(m_Lifetime, initState->initModuleLiftTime);
@@ -21,42 +22,77 @@ void InitialModule::Init(ParticleSystemInitState* initState)
 
 void InitialModule::Start(const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const Matrix4x4f& matrix, size_t fromIndex, float t)
 {
+	const size_t count = ps.array_size();
+	if (fromIndex >= count)
+		return;
+
 	const float normalizedT = t / initState.lengthInSec;
 
 	Rand& random = GetRandom();
 
-	Vector3f origin = matrix.GetPosition();
+	const Vector3f origin = matrix.GetPosition();
+	const Vector3f velocity = matrix.MultiplyVector3(Vector3f::zAxis);
 
-	const size_t count = ps.array_size();
-	for (size_t q = fromIndex; q < count; ++q)
-	{
-		UInt32 randUInt32 = random.Get();
-		float rand = Rand::GetFloatFromInt(randUInt32);
-		UInt32 randByte = Rand::GetByteFromInt(randUInt32);
+	// All particles spawn at the same time, so the color only varies by the random lerp between these two
+	ColorRGBA32 minColor, maxColor;
+	EvaluateRange(m_Color, normalizedT, minColor, maxColor);
 
-		const ColorRGBA32 col = Evaluate(m_Color, normalizedT, randByte);
-		float sz = std::max<float>(0.0f, Evaluate(m_Size, normalizedT, rand));
-		Vector3f vel = matrix.MultiplyVector3(Vector3f::zAxis);
-		float ttl = std::max<float>(0.0f, Evaluate(m_Lifetime, normalizedT, rand));
-		float rot = Evaluate(m_Rotation, normalizedT, rand);
+	// One value from the system's random stream per call, the particles use it as the counter for the stateless generator
+	const UInt32 counter = random.Get();
 
-		ps.position[q] = origin;
-		ps.velocity[q] = vel;
-		ps.animatedVelocity[q] = Vector3f::zero;
-		ps.lifetime[q] = ttl;
-		ps.startLifetime[q] = ttl;
-		ps.size[q] = sz;
-		ps.rotation[q] = rot;
-		if (ps.usesRotationalSpeed)
-			ps.rotationalSpeed[q] = 0.0f;
-		ps.color[q] = col;
-		ps.randomSeed[q] = random.Get(); // One more iteration to avoid visible patterns between random spawned parameters and those used in update
-		if (ps.usesAxisOfRotation)
-			ps.axisOfRotation[q] = Vector3f::zAxis;
-		for (int acc = 0; acc < ps.numEmitAccumulators; acc++)
-			ps.emitAccumulator[acc][q] = 0.0f;
+	// The attributes are initialized in separate passes per tile so that each loop only touches a few streams
+	UInt32 particleCounter[kParticleSystemCurveBatchSize];
+	UInt32 randomUInt32[kParticleSystemCurveBatchSize];
+	float randomValue[kParticleSystemCurveBatchSize];
+	float time[kParticleSystemCurveBatchSize];
+	float value[kParticleSystemCurveBatchSize];
+	std::fill(time, time + kParticleSystemCurveBatchSize, normalizedT);
 
+	for (size_t from = fromIndex; from < count; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t batchCount = std::min<size_t>(kParticleSystemCurveBatchSize, count - from);
+
+		const UInt32 firstCounter = counter + UInt32(from - fromIndex);
+		for (size_t i = 0; i < batchCount; ++i)
+			particleCounter[i] = firstCounter + UInt32(i);
+		GenerateRandomUInt32Batch(particleCounter, kParticleSystemStartParametersId, randomUInt32, batchCount);
+		for (size_t i = 0; i < batchCount; ++i)
+			randomValue[i] = Rand::GetFloatFromInt(randomUInt32[i]);
+
+		// Separate stream to avoid visible patterns between random spawned parameters and those used in update
+		GenerateRandomUInt32Batch(particleCounter, kParticleSystemStartRandomSeedId, &ps.randomSeed[from], batchCount);
+
+		ColorRGBA32* color = &ps.color[from];
+		for (size_t i = 0; i < batchCount; ++i)
+			color[i] = Lerp(minColor, maxColor, Rand::GetByteFromInt(randomUInt32[i]));
+
+		EvaluateBatch(m_Size, time, randomValue, value, batchCount);
+		float* size = &ps.size[from];
+		for (size_t i = 0; i < batchCount; ++i)
+			size[i] = std::max<float>(0.0f, value[i]);
+
+		EvaluateBatch(m_Lifetime, time, randomValue, value, batchCount);
+		float* lifetime = &ps.lifetime[from];
+		float* startLifetime = &ps.startLifetime[from];
+		for (size_t i = 0; i < batchCount; ++i)
+		{
+			const float ttl = std::max<float>(0.0f, value[i]);
+			lifetime[i] = ttl;
+			startLifetime[i] = ttl;
+		}
+
+		EvaluateBatch(m_Rotation, time, randomValue, &ps.rotation[from], batchCount);
 	}
+
+	std::fill(&ps.position[fromIndex], &ps.position[0] + count, origin);
+	std::fill(&ps.velocity[fromIndex], &ps.velocity[0] + count, velocity);
+	std::fill(&ps.animatedVelocity[fromIndex], &ps.animatedVelocity[0] + count, Vector3f::zero);
+	if (ps.usesRotationalSpeed)
+		std::fill(&ps.rotationalSpeed[fromIndex], &ps.rotationalSpeed[0] + count, 0.0f);
+	if (ps.usesAxisOfRotation)
+		std::fill(&ps.axisOfRotation[fromIndex], &ps.axisOfRotation[0] + count, Vector3f::zAxis);
+	for (int acc = 0; acc < ps.numEmitAccumulators; acc++)
+		std::fill(&ps.emitAccumulator[acc][fromIndex], &ps.emitAccumulator[acc][0] + count, 0.0f);
 }
 
 void InitialModule::Update(const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, const size_t toIndex, float dt) const
@@ -87,9 +123,11 @@ void InitialModule::GenerateProcedural(const ParticleSystemInitState& initState,
 
 	const Matrix4x4f localToWorld = !initState.useLocalSpace ? state.localToWorld : Matrix4x4f::identity;
 	Vector3f origin = localToWorld.GetPosition();
+	const UInt32 counter = random.Get();
 	for (size_t i = 0; i < count; ++i)
 	{
-		UInt32 randUInt32 = random.Get();
+		const UInt32 particleCounter = counter + UInt32(i);
+		UInt32 randUInt32 = ParticleSystemRandomUInt32(particleCounter, kParticleSystemStartParametersId);
 		float rand = Rand::GetFloatFromInt(randUInt32);
 		UInt32 randByte = Rand::GetByteFromInt(randUInt32);
 
@@ -118,7 +156,7 @@ void InitialModule::GenerateProcedural(const ParticleSystemInitState& initState,
 		if (ps.usesRotationalSpeed)
 			ps.rotationalSpeed[q] = 0.0f;
 		ps.color[q] = col;
-		ps.randomSeed[q] = random.Get(); // One more iteration to avoid visible patterns between random spawned parameters and those used in update
+		ps.randomSeed[q] = ParticleSystemRandomUInt32(particleCounter, kParticleSystemStartRandomSeedId); // Separate stream to avoid visible patterns between random spawned parameters and those used in update
 		if (ps.usesAxisOfRotation)
 			ps.axisOfRotation[q] = Vector3f::zAxis;
 		for (int acc = 0; acc < ps.numEmitAccumulators; acc++)
@@ -0,0 +1,84 @@
+#include "PluginPrefix.h"
+#include "NoiseModule.h"
+#include "ParticleSystemNoiseVolume.h"
+#include "ParticleSystemCommon.h"
+#include "ParticleSystemParticles.h"
+#include "Math/FloatConversion.h"
+#include "Utilities/Utility.h"
+
+NoiseModule::NoiseModule() : ParticleSystemModule(false)
+	, m_Frequency(0.5f)
+	, m_ScrollSpeed(Vector3f::zero)
+	, m_ScrollOffset(Vector3f::zero)
+	, m_OctaveCount(1)
+	, m_OctaveScale(2.0f)
+{
+	m_OctaveMultiplier.SetScalar(0.5f);
+}
+
+void NoiseModule::SetParameters(float frequency, const Vector3f& scrollSpeed, int octaveCount, float octaveScale)
+{
+	m_Frequency = frequency;
+	m_ScrollSpeed = scrollSpeed;
+	m_OctaveCount = clamp<int>(octaveCount, 1, kMaxOctaves);
+	m_OctaveScale = octaveScale;
+}
+
+void NoiseModule::Update(ParticleSystemParticles& ps, size_t fromIndex, float dt)
+{
+	const ParticleSystemNoiseVolume& volume = ParticleSystemNoiseVolume::Get();
+	if (volume.IsEmpty())
+		return;
+
+	// Scrolls even without particles, wrapped so the coordinates keep their precision
+	const float resolution = float(volume.GetResolution());
+	m_ScrollOffset += m_ScrollSpeed * (float(ParticleSystemNoiseVolume::kTexelsPerFeature) * dt);
+	m_ScrollOffset = Vector3f(Repeat(m_ScrollOffset.x, resolution), Repeat(m_ScrollOffset.y, resolution), Repeat(m_ScrollOffset.z, resolution));
+
+	const size_t particleCount = ps.array_size();
+	if (fromIndex >= particleCount)
+		return;
+
+	float time[kParticleSystemCurveBatchSize];
+	float amplitude[kParticleSystemCurveBatchSize];
+	float octaveMultiplier[kParticleSystemCurveBatchSize];
+	Vector3f coords[kParticleSystemCurveBatchSize];
+	Vector3f noise[kParticleSystemCurveBatchSize];
+	Vector3f force[kParticleSystemCurveBatchSize];
+	for (size_t from = fromIndex; from < particleCount; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, particleCount - from);
+
+		NormalizedTimeBatch(ps, from, count, time);
+		EvaluateBatch(m_Strength, time, &ps.randomSeed[from], amplitude, count, kParticleSystemNoiseStrengthCurveId);
+		if (m_OctaveCount > 1)
+			EvaluateBatch(m_OctaveMultiplier, time, &ps.randomSeed[from], octaveMultiplier, count, kParticleSystemNoiseOctaveCurveId);
+		std::fill(force, force + count, Vector3f::zero);
+
+		const Vector3f* position = &ps.position[from];
+		float scale = m_Frequency * float(ParticleSystemNoiseVolume::kTexelsPerFeature);
+		for (int octave = 0; octave < m_OctaveCount; ++octave)
+		{
+			// Octaves are shifted against each other so their features don't line up at the origin
+			const Vector3f offset = m_ScrollOffset + Vector3f(11.3f, 7.7f, 5.1f) * float(octave);
+			for (size_t i = 0; i < count; ++i)
+				coords[i] = position[i] * scale + offset;
+
+			volume.SampleBatch(coords, noise, count);
+
+			for (size_t i = 0; i < count; ++i)
+				force[i] += noise[i] * amplitude[i];
+
+			if (octave + 1 < m_OctaveCount)
+			{
+				for (size_t i = 0; i < count; ++i)
+					amplitude[i] *= octaveMultiplier[i];
+				scale *= m_OctaveScale;
+			}
+		}
+
+		Vector3f* velocity = &ps.velocity[from];
+		for (size_t i = 0; i < count; ++i)
+			velocity[i] += force[i] * dt;
+	}
+}
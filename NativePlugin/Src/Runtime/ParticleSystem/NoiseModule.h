@@ -0,0 +1,38 @@
+#ifndef SHURIKENMODULENOISE_H
+#define SHURIKENMODULENOISE_H
+
+#include "ParticleSystemModule.h"
+#include "ParticleSystemCurves.h"
+
+struct ParticleSystemParticles;
+
+// Turbulence from the shared curl noise volume, see ParticleSystemNoiseVolume. Each octave is one trilinear
+// lookup per particle; strength and the amplitude falloff between octaves are curves over the particle lifetime.
+class NoiseModule : public ParticleSystemModule
+{
+public:
+	enum { kMaxOctaves = 4 };
+
+	NoiseModule();
+
+	// Adds the noise at the particles [fromIndex, end) times dt to their velocity, before they are integrated
+	void Update(ParticleSystemParticles& ps, size_t fromIndex, float dt);
+
+	// frequency is in noise features per unit, scrollSpeed in features per second. Every octave
+	// samples the volume at octaveScale times the frequency of the previous one.
+	void SetParameters(float frequency, const Vector3f& scrollSpeed, int octaveCount, float octaveScale);
+
+	inline MinMaxCurve& GetStrengthCurve() { return m_Strength; }
+	inline MinMaxCurve& GetOctaveMultiplierCurve() { return m_OctaveMultiplier; }
+
+private:
+	MinMaxCurve m_Strength;				// Acceleration in units per second squared
+	MinMaxCurve m_OctaveMultiplier;		// Amplitude of every octave relative to the previous one
+	float m_Frequency;
+	Vector3f m_ScrollSpeed;
+	Vector3f m_ScrollOffset;			// In texels, wrapped to the volume
+	int m_OctaveCount;
+	float m_OctaveScale;
+};
+
+#endif // SHURIKENMODULENOISE_H
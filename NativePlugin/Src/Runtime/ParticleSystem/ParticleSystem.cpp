@@ -2,11 +2,19 @@
 #include "ParticleSystem.h"
 #include "ParticleSystemRenderer.h"
 #include "ParticleSystemModule.h"
+#include "ParticleSystemInitStateBlob.h"
 #include "RotationModule.h"
 #include "ColorModule.h"
 #include "SizeModule.h"
 #include "UVModule.h"
 #include "ShapeModule.h"
+#include "ExternalForcesModule.h"
+#include "NoiseModule.h"
+#include "ParticleSystemForceFields.h"
+#include "ParticleSystemNoiseVolume.h"
+#include "ParticleSystemEmitterMesh.h"
+#include "ParticleSystemSubEmitter.h"
+#include "ParticleSystemSlotMap.h"
 #include "InitialModule.h"
 #include "EmissionModule.h"
 #include "ParticleSystemParticles.h"
@@ -21,9 +29,12 @@
 #include "Log/Log.h"
 #include "Shaders/GraphicsCaps.h"
 #include "UnityPluginInterface.h"
+#include "Threads/AtomicOps.h"
+#include <algorithm>
 
 #if ENABLE_MULTITHREADED_PARTICLES
 #include "Jobs/Jobs.h"
+#include "Allocator/FrameAllocator.h"
 #endif
 
 struct ParticleSystemManager
@@ -32,13 +43,21 @@ struct ParticleSystemManager
 		: needSync(false)
 	{
 		activeEmitters.reserve(8);
+		pendingChanges = CreateConcurrentStack();
 	}
 
-	std::vector<ParticleSystem*> activeEmitters;
-	std::vector<ParticleSystem*> particleSystems;
+	~ParticleSystemManager()
+	{
+		DestroyConcurrentStack(pendingChanges);
+	}
+
+	std::vector<ParticleSystem*> activeEmitters;	// Main thread only, changed by ApplyPendingChanges
+	ParticleSystemSlotMap systems;
+	ConcurrentStack* pendingChanges;				// Slots with changes queued since the last ApplyPendingChanges
 
 #if ENABLE_MULTITHREADED_PARTICLES
 	JobFence jobGroup; // for any other collisions
+	JobFence subEmitterJobGroup; // Sub-emitter updates, depend on jobGroup
 #endif
 
 	bool needSync;
@@ -46,11 +65,57 @@ struct ParticleSystemManager
 
 ParticleSystemManager* gParticleSystemManager = nullptr;
 
+// ParticleSystemSlotMap::Slot::pendingFlags
+enum
+{
+	kPendingQueued = 1 << 0,	// The slot is in pendingChanges
+	kPendingAdd = 1 << 1,
+	kPendingRemove = 1 << 2,
+	kPendingDestroy = 1 << 3
+};
+
+// NULL for stale handles, the systems they referred to have been destroyed
+static ParticleSystem* GetParticleSystem(int handle)
+{
+	return gParticleSystemManager->systems.Get(ParticleSystemSlotMap::HandleFromInt(handle));
+}
+
+// Lock-free, the slot goes into pendingChanges once no matter how many changes are queued before they are applied
+static void QueuePendingChange(int index, int change)
+{
+	ParticleSystemSlotMap::Slot* slot = gParticleSystemManager->systems.GetSlot(index);
+	if (slot == NULL)
+		return;
+
+	int flags;
+	int newFlags;
+	do
+	{
+		flags = slot->pendingFlags;
+		// The last of add and remove wins, destroy wins over both
+		if (change == kPendingDestroy)
+			newFlags = flags | kPendingDestroy | kPendingQueued;
+		else
+			newFlags = (flags & ~(kPendingAdd | kPendingRemove)) | change | kPendingQueued;
+	}
+	while (!AtomicCompareExchange(&slot->pendingFlags, newFlags, flags));
+
+	if ((flags & kPendingQueued) == 0)
+		gParticleSystemManager->pendingChanges->Push(&slot->pendingNode);
+}
+
 class ParticleSystemUpdateData
 {
 public:
 	Matrix4x4f worldMatrix;
-    int index;
+    int handle;
+};
+
+// Element of the array passed to Native_UpdateTransforms, a blittable struct on the script side
+struct ParticleSystemTransformUpdate
+{
+	Matrix4x4f worldMatrix;
+	int handle;
 };
 
 int Internal_CreateParticleSystem(ScriptingObject* initState)
@@ -65,9 +130,10 @@ void Internal_ParticleSystem_Update(ScriptingObject* updateData)
 {
 	ParticleSystemUpdateData* gUpdateData = (ParticleSystemUpdateData*)GetLogicObjectMemoryLayout(updateData);
 
-    if (gUpdateData->index < gParticleSystemManager->particleSystems.size())
+    ParticleSystem* system = GetParticleSystem(gUpdateData->handle);
+    if (system != nullptr)
     {
-        gParticleSystemManager->particleSystems[gUpdateData->index]->SetWorldMatrix(gUpdateData->worldMatrix);
+        system->SetWorldMatrix(gUpdateData->worldMatrix);
     }
 }
 
@@ -87,13 +153,192 @@ static const void* s_ParticleSystem_IcallFuncs[] =
 
 extern "C"
 {
-    EXPORT_API void Native_SetActive(int index, bool isActive)
+    EXPORT_API void Native_SetActive(int handle, bool isActive)
+    {
+        ParticleSystem* system = GetParticleSystem(handle);
+        if (system != nullptr)
+        {
+            system->SetActive(isActive);
+        }
+    }
+
+    // Same as Internal_ParticleSystem_Update for all systems at once, so a frame costs one transition
+    // instead of one per system. The array is pinned by the caller for the duration of the call only.
+    EXPORT_API void Native_UpdateTransforms(const ParticleSystemTransformUpdate* updates, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            ParticleSystem* system = GetParticleSystem(updates[i].handle);
+            if (system != nullptr)
+            {
+                system->SetWorldMatrix(updates[i].worldMatrix);
+            }
+        }
+    }
+
+    // The system is deleted at the start of the next update, the handle is rejected from now on
+    EXPORT_API void Native_DestroyParticleSystem(int handle)
+    {
+        ParticleSystem::DestroyParticleSystem(handle);
+    }
+
+    EXPORT_API void Native_SetCurveBaking(int sampleCount, float maxError)
+    {
+        ParticleSystemModule::SetCurveBaking(sampleCount, maxError);
+    }
+
+    EXPORT_API void Native_SetGradientBaking(bool enabled)
+    {
+        ParticleSystemModule::SetGradientBaking(enabled);
+    }
+
+    // Returns false and keeps the previous mesh if indexCount isn't a multiple of 3 or an index is >= vertexCount
+    EXPORT_API bool Native_SetEmitterMesh(int meshId, const ParticleSystemEmitterMeshVertex* vertices, int vertexCount, const UInt16* indices, int indexCount)
+    {
+        if (vertexCount < 0 || indexCount < 0)
+            return false;
+
+        // The cached mesh may be sampled by particle jobs
+        ParticleSystem::SyncJobs();
+        return ParticleSystemEmitterMesh::Get(meshId).Build(vertices, vertexCount, indices, indexCount);
+    }
+
+    // Per frame update for skinned or otherwise animated emitter meshes, only the triangles using the given vertices are updated
+    EXPORT_API void Native_UpdateEmitterMeshVertices(int meshId, const Vector3f* positions, const Vector3f* normals, int firstVertex, int vertexCount)
+    {
+        ParticleSystemEmitterMesh* mesh = ParticleSystemEmitterMesh::Find(meshId);
+        if (mesh != NULL && firstVertex >= 0 && vertexCount > 0)
+        {
+            ParticleSystem::SyncJobs();
+            mesh->UpdateVertices(positions, normals, firstVertex, vertexCount);
+        }
+    }
+
+    EXPORT_API bool Native_SetSubEmitter(int parentHandle, int subEmitterHandle, int type)
+    {
+        ParticleSystem* parent = GetParticleSystem(parentHandle);
+        ParticleSystem* subEmitter = GetParticleSystem(subEmitterHandle);
+        if (parent == nullptr || subEmitter == nullptr)
+            return false;
+
+        ParticleSystem::SyncJobs();
+        return parent->AddSubEmitter(subEmitter, (ParticleSystemSubType)type);
+    }
+
+    EXPORT_API void Native_ClearSubEmitters(int parentHandle)
+    {
+        ParticleSystem* parent = GetParticleSystem(parentHandle);
+        if (parent != nullptr)
+        {
+            ParticleSystem::SyncJobs();
+            parent->ClearSubEmitters();
+        }
+    }
+
+    EXPORT_API void Native_RemoveEmitterMesh(int meshId)
+    {
+        ParticleSystem::SyncJobs();
+        ParticleSystemEmitterMesh::Remove(meshId);
+    }
+
+    EXPORT_API void Native_SetShapeMesh(int handle, int meshId, int distribution)
+    {
+        ParticleSystem* system = GetParticleSystem(handle);
+        if (system != nullptr)
+        {
+            // Emit jobs may be sampling the current mesh
+            ParticleSystem::SyncJobs();
+            // The shape module is disabled by default, emitting from a mesh implies it
+            ShapeModule* shapeModule = system->GetShapeModule();
+            shapeModule->SetEnabled(true);
+            shapeModule->SetShapeType(ShapeModule::kMesh);
+            shapeModule->SetMesh(meshId, (MeshDistributionMode)clamp<int>(distribution, kDistributionVertex, kDistributionTriangle));
+        }
+    }
+
+    // Adds the field or replaces the one with the same id, the spatial index is rebuilt at the start of the next update
+    EXPORT_API void Native_SetForceField(int fieldId, const ForceField* field)
+    {
+        if (field == nullptr)
+            return;
+
+        ParticleSystem::SyncJobs();
+        ParticleSystemForceFields::Get().Set(fieldId, *field);
+    }
+
+    EXPORT_API void Native_RemoveForceField(int fieldId)
+    {
+        ParticleSystem::SyncJobs();
+        ParticleSystemForceFields::Get().Remove(fieldId);
+    }
+
+    // Should be around the typical field radius, fields covering many cells are tested by every system instead
+    EXPORT_API void Native_SetForceFieldCellSize(float cellSize)
+    {
+        ParticleSystem::SyncJobs();
+        ParticleSystemForceFields::Get().SetCellSize(cellSize);
+    }
+
+    EXPORT_API void Native_SetExternalForces(int handle, bool enabled, float multiplier)
+    {
+        ParticleSystem* system = GetParticleSystem(handle);
+        if (system != nullptr)
+        {
+            ParticleSystem::SyncJobs();
+            ExternalForcesModule* externalForcesModule = system->GetExternalForcesModule();
+            externalForcesModule->SetEnabled(enabled);
+            externalForcesModule->SetMultiplier(multiplier);
+        }
+    }
+
+    // A NULL scrollSpeed doesn't scroll the noise
+    EXPORT_API void Native_SetNoise(int handle, bool enabled, float frequency, const Vector3f* scrollSpeed, int octaveCount, float octaveScale)
     {
-        if (index < gParticleSystemManager->particleSystems.size())
+        ParticleSystem* system = GetParticleSystem(handle);
+        if (system != nullptr)
         {
-            gParticleSystemManager->particleSystems[index]->SetActive(isActive);
+            ParticleSystem::SyncJobs();
+
+            // The volume is generated the first time it's needed unless one was loaded
+            ParticleSystemNoiseVolume& volume = ParticleSystemNoiseVolume::Get();
+            if (enabled && volume.IsEmpty())
+                volume.Generate(ParticleSystemNoiseVolume::kDefaultResolution, 0);
+
+            NoiseModule* noiseModule = system->GetNoiseModule();
+            noiseModule->SetEnabled(enabled);
+            noiseModule->SetParameters(frequency, scrollSpeed != nullptr ? *scrollSpeed : Vector3f::zero, octaveCount, octaveScale);
         }
     }
+
+    // curve: 0 strength, 1 octave multiplier. Keys are over the normalized particle lifetime, scalar alone if keyCount is 0.
+    EXPORT_API void Native_SetNoiseCurve(int handle, int curve, const KeyframeTplFloat* keys, int keyCount, float scalar)
+    {
+        ParticleSystem* system = GetParticleSystem(handle);
+        if (system != nullptr)
+        {
+            ParticleSystem::SyncJobs();
+            NoiseModule* noiseModule = system->GetNoiseModule();
+            MinMaxCurve& minMaxCurve = curve == 0 ? noiseModule->GetStrengthCurve() : noiseModule->GetOctaveMultiplierCurve();
+            ParticleSystemModule::InitCurveFromKeys(minMaxCurve, keys, keyCount, scalar);
+        }
+    }
+
+    EXPORT_API void Native_GenerateNoiseVolume(int resolution, int seed)
+    {
+        ParticleSystem::SyncJobs();
+        ParticleSystemNoiseVolume::Get().Generate(resolution, UInt32(seed));
+    }
+
+    EXPORT_API bool Native_LoadNoiseVolume(const char* path)
+    {
+        ParticleSystem::SyncJobs();
+        return ParticleSystemNoiseVolume::Get().Load(path);
+    }
+
+    EXPORT_API bool Native_SaveNoiseVolume(const char* path)
+    {
+        return ParticleSystemNoiseVolume::Get().Save(path);
+    }
 }
 
 static void RegisterParticleSystemBindings()
@@ -123,49 +368,140 @@ static void ApplyStartDelay(float& delayT, float& accumulatedDt)
 	}
 }
 
+// Can be called from any thread, the system is updated from the next BeginUpdateAll on.
+// Returns the system's handle, 0 if there are too many systems.
 int ParticleSystem::CreateParticleSystrem(ParticleSystemInitState* initState)
 {
-	ParticleSystem* ps = new ParticleSystem(initState);
-	gParticleSystemManager->particleSystems.push_back(ps);
-    return gParticleSystemManager->particleSystems.size() - 1;
+	ParticleSystem* ps = new ParticleSystem(AcquireParticleSystemInitState(initState));
+	const int index = gParticleSystemManager->systems.Create(ps);
+	if (index < 0)
+	{
+		delete ps;
+		return 0;
+	}
+
+	ps->m_SlotIndex = index;
+	if (ps->m_InitState->playOnAwake)
+		ps->Play(false);
+	return ParticleSystemSlotMap::HandleToInt(gParticleSystemManager->systems.GetHandle(index));
+}
+
+// Can be called from any thread, the system is deleted by the next ApplyPendingChanges
+void ParticleSystem::DestroyParticleSystem(int handle)
+{
+	// Only the handle's generation is checked, the system itself may already be deleted by the main thread
+	if (GetParticleSystem(handle) != nullptr)
+		QueuePendingChange(ParticleSystemSlotMap::HandleFromInt(handle).index, kPendingDestroy);
+}
+
+// Main thread only, at the start of the frame's update
+void ParticleSystem::ApplyPendingChanges()
+{
+	ConcurrentNode* node = gParticleSystemManager->pendingChanges->PopAll();
+	if (node == nullptr)
+		return;
+
+	// Update jobs iterate the systems
+	SyncJobs();
+
+	ParticleSystemSlotMap& systems = gParticleSystemManager->systems;
+	while (node != nullptr)
+	{
+		ConcurrentNode* next = node->Next();
+		ParticleSystemSlotMap::Slot& slot = *static_cast<ParticleSystemSlotMap::Slot*>(node->data[0]);
+
+		// Changes queued from here on put the slot back into pendingChanges for the next call
+		const int flags = AtomicExchange(&slot.pendingFlags, 0);
+		ParticleSystem* system = slot.system;
+		if (system != nullptr)
+		{
+			if (flags & kPendingDestroy)
+			{
+				system->RemoveFromEmitters();
+
+				// Parents keep pointers to their sub-emitters, those are rare enough to look for the parents
+				if (system->m_SubEmitterQueue != nullptr)
+				{
+					for (int i = 0; i < systems.GetSlotCount(); ++i)
+					{
+						ParticleSystem* parent = systems.Get(i);
+						if (parent != nullptr && parent->m_SubEmitters != nullptr)
+							parent->m_SubEmitters->Remove(system);
+					}
+				}
+
+				// Its own sub-emitters go back to normal updating unless another parent still uses them
+				system->ClearSubEmitters();
+
+				systems.Release(slot.index);
+				delete system;
+			}
+			else if (flags & kPendingAdd)
+			{
+				system->AddToEmitters();
+			}
+			else if (flags & kPendingRemove)
+			{
+				system->RemoveFromEmitters();
+			}
+		}
+		node = next;
+	}
 }
 
 void ParticleSystem::Init()
 {
 	gParticleSystemManager = new ParticleSystemManager();
+	ParticleSystemForceFields::Create();
+	ParticleSystemNoiseVolume::Create();
 	RegisterParticleSystemBindings();
 }
 
 void ParticleSystem::ShutDown()
 {
-	for (int i = 0; i < gParticleSystemManager->particleSystems.size(); ++i)
-	{
-		if (gParticleSystemManager->particleSystems[i] != nullptr)
-			delete gParticleSystemManager->particleSystems[i];
+	SyncJobs();
+	gParticleSystemManager->pendingChanges->PopAll();
+	gParticleSystemManager->activeEmitters.clear();
 
-		gParticleSystemManager->particleSystems[i] = nullptr;
+	ParticleSystemSlotMap& systems = gParticleSystemManager->systems;
+	for (int i = 0; i < systems.GetSlotCount(); ++i)
+	{
+		ParticleSystem* system = systems.Get(i);
+		if (system != nullptr)
+		{
+			systems.Release(i);
+			delete system;
+		}
 	}
 
-	gParticleSystemManager->particleSystems.clear();
-	gParticleSystemManager->activeEmitters.clear();
+	delete gParticleSystemManager;
+	gParticleSystemManager = nullptr;
+	ParticleSystemEmitterMesh::RemoveAll();
+	ParticleSystemForceFields::Destroy();
+	ParticleSystemNoiseVolume::Destroy();
 }
 
 void ParticleSystem::BeginUpdateAll()
 {
+	// Deactivated systems go out with the rest of the changes made since the last update
+	for (size_t i = 0; i < gParticleSystemManager->activeEmitters.size(); ++i)
+	{
+		ParticleSystem& system = *gParticleSystemManager->activeEmitters[i];
+		if (!system.IsActive())
+			system.RemoveFromManager();
+	}
+	ApplyPendingChanges();
+
 	float deltaTime = GetDeltaTime();
 	if (deltaTime == 0.0f)
 		return;
 
+	// Once per frame, the update jobs only read the grid
+	ParticleSystemForceFields::Get().Rebuild();
+
 	for (size_t i = 0; i < gParticleSystemManager->activeEmitters.size(); ++i)
 	{
 		ParticleSystem& system = *gParticleSystemManager->activeEmitters[i];
-
-		if (!system.IsActive())
-		{
-			system.RemoveFromManager();
-			continue;
-		}
-
 		Update0(system, *system.m_InitState, *system.m_State, deltaTime, false);
 	}
 
@@ -174,29 +510,46 @@ void ParticleSystem::BeginUpdateAll()
 #if ENABLE_MULTITHREADED_PARTICLES
 	int activeCount = gParticleSystemManager->activeEmitters.size();
 
+	// The job queue can still read the array after this function returns, keep it for a few frames instead of on the stack
 	Job* jobs;
-	int jobsCount = 0;
-	ALLOC_TEMP(jobs, Job, activeCount);
+	ALLOC_FRAME(jobs, Job, activeCount);
 
+	// Sub-emitters start particles from their parents' spawn events, so they go to the back of the list and
+	// run in a second stage that depends on the first one instead of waiting for a sync on the main thread
+	int jobsCount = 0;
+	int subEmitterJobsCount = 0;
 	for (int i = 0; i < activeCount; ++i)
 	{
 		ParticleSystem& system = *gParticleSystemManager->activeEmitters[i];
 		system.GetThreadScratchPad().deltaTime = deltaTime;
-		jobs[jobsCount++] = Job(ParticleSystem::UpdateFunction, &system);
+		if (system.m_State->GetIsSubEmitter())
+			jobs[activeCount - ++subEmitterJobsCount] = Job(ParticleSystem::UpdateFunction, &system);
+		else
+			jobs[jobsCount++] = Job(ParticleSystem::UpdateFunction, &system);
 	}
+	Job* subEmitterJobs = jobs + jobsCount;
 
 	// sort jobs with most particles to the front of the list, to try and avoid some worker threads going idle a long time before others, unless we have lots of systems, in which case don't waste time doing the sort
 	static const int kMaxJobsToSort = 64;
 
 	if (jobsCount <= kMaxJobsToSort)
 		std::sort(jobs, jobs + jobsCount, ParticleSystem::CompareJobs);
+	if (subEmitterJobsCount <= kMaxJobsToSort)
+		std::sort(subEmitterJobs, subEmitterJobs + subEmitterJobsCount, ParticleSystem::CompareJobs);
 
 	ScheduleDifferentJobsConcurrent(gParticleSystemManager->jobGroup, jobs, jobsCount);
+	if (subEmitterJobsCount != 0)
+		ScheduleDifferentJobsConcurrentDepends(gParticleSystemManager->subEmitterJobGroup, subEmitterJobs, subEmitterJobsCount, gParticleSystemManager->jobGroup);
 #else
-	for (size_t i = 0; i < gParticleSystemManager->activeEmitters.size(); ++i)
+	// Parents first, so the sub-emitters see this frame's spawn events
+	for (int pass = 0; pass < 2; ++pass)
 	{
-		ParticleSystem& system = *gParticleSystemManager->activeEmitters[i];
-		system.Update1(system, system.GetParticles(), deltaTime, false, false);
+		for (size_t i = 0; i < gParticleSystemManager->activeEmitters.size(); ++i)
+		{
+			ParticleSystem& system = *gParticleSystemManager->activeEmitters[i];
+			if (system.m_State->GetIsSubEmitter() == (pass == 1))
+				system.Update1(system, system.GetParticles(), deltaTime, false, false);
+		}
 	}
 #endif
 
@@ -206,39 +559,43 @@ void ParticleSystem::EndUpdateAll()
 {
 	SyncJobs();
 
-	// Remove emitters that are finished (no longer emitting)
-	for (size_t i = 0; i < gParticleSystemManager->activeEmitters.size();)
+	// Remove emitters that are finished (no longer emitting), they are taken out at the start of the next update
+	for (size_t i = 0; i < gParticleSystemManager->activeEmitters.size(); ++i)
 	{
 		ParticleSystem& system = *gParticleSystemManager->activeEmitters[i];
 		ParticleSystemState& state = *system.m_State;
 		const size_t particleCount = system.GetParticleCount();
-		if ((particleCount == 0) && state.playing && state.stopEmitting)
+		// Sub-emitters stay in the manager, their parents can send spawn events at any time
+		if ((particleCount == 0) && state.playing && state.stopEmitting && !state.GetIsSubEmitter())
 		{
 			// collision subemitters may not have needRestart==true when being restarted
 			// from a paused state
 			//Assert (state.needRestart);
 			state.playing = false;
 			system.RemoveFromManager();
-			continue;
 		}
-
-		i++;
 	}
 }
 
-ParticleSystem::ParticleSystem(ParticleSystemInitState* initState)
-	: m_Renderer(nullptr)
+ParticleSystem::ParticleSystem(const ParticleSystemInitState* initState)
+	: m_SlotIndex(-1)
+	, m_Renderer(nullptr)
 	, m_EmittersIndex(-1)
 	, m_InitState(initState)
+	, m_Kernels(nullptr)
+	, m_KernelIndex(-1)
+	, m_SubEmitters(nullptr)
+	, m_SubEmitterQueue(nullptr)
 {
-	m_InitState = new ParticleSystemInitState();
-	m_InitState->InitFromMono(initState);
 	m_Renderer = new ParticleSystemRenderer();
 	m_State = new ParticleSystemState();
 
 	m_ShapeModule = new ShapeModule();
     m_ShapeModule->Init(m_InitState);
 
+	m_ExternalForcesModule = new ExternalForcesModule();
+	m_NoiseModule = new NoiseModule();
+
 	m_SizeModule = new SizeModule();
     m_SizeModule->Init(m_InitState);
 
@@ -257,25 +614,33 @@ ParticleSystem::ParticleSystem(ParticleSystemInitState* initState)
     m_InitialModule->Init(m_InitState);
 
 	m_Particles = new ParticleSystemParticles();
-
-	if (m_InitState->playOnAwake)
-		Play(false);
+	SelectKernels();
 }
 
 ParticleSystem::~ParticleSystem()
 {
-	auto it = std::find(gParticleSystemManager->activeEmitters.begin(), gParticleSystemManager->activeEmitters.end(), this);
-	gParticleSystemManager->activeEmitters.erase(it);
-
 	if (m_Renderer != nullptr)
 		delete m_Renderer;
 
-	if (m_InitState != nullptr)
-		delete m_InitState;
+	ReleaseParticleSystemInitState(m_InitState);
 
 	if (m_State != nullptr)
 		delete m_State;
 
+	delete m_SubEmitters;
+	delete m_SubEmitterQueue;
+
+	delete m_InitialModule;
+	delete m_ShapeModule;
+	delete m_EmissionModule;
+	delete m_ExternalForcesModule;
+	delete m_NoiseModule;
+	delete m_RotationModule;
+	delete m_ColorModule;
+	delete m_SizeModule;
+	delete m_UVModule;
+	delete m_Particles;
+
 	m_Renderer = nullptr;
 	m_InitState = nullptr;
 	m_State = nullptr;
@@ -289,10 +654,11 @@ void ParticleSystem::Prepare()
 		(*it)->PrepareForRender();
 }
 
-void ParticleSystem::Prepare(int index)
+void ParticleSystem::Prepare(int handle)
 {
-    if (index < gParticleSystemManager->particleSystems.size())
-        gParticleSystemManager->particleSystems[index]->PrepareForRender();
+    ParticleSystem* system = GetParticleSystem(handle);
+    if (system != nullptr)
+        system->PrepareForRender();
 }
 
 void ParticleSystem::Render()
@@ -303,10 +669,11 @@ void ParticleSystem::Render()
 		(*it)->m_Renderer->RenderMultiple(**it);
 }
 
-void ParticleSystem::Render(int index)
+void ParticleSystem::Render(int handle)
 {
-    if (index < gParticleSystemManager->particleSystems.size())
-        gParticleSystemManager->particleSystems[index]->m_Renderer->RenderMultiple(*gParticleSystemManager->particleSystems[index]);
+    ParticleSystem* system = GetParticleSystem(handle);
+    if (system != nullptr)
+        system->m_Renderer->RenderMultiple(*system);
 }
 
 void ParticleSystem::Update(ParticleSystem& system, float deltaTime, bool fixedTimeStep, bool useProcedural, int rayBudget)
@@ -321,6 +688,7 @@ void ParticleSystem::SyncJobs(bool syncRenderJobs)
 	if (gParticleSystemManager->needSync)
 	{
 #if ENABLE_MULTITHREADED_PARTICLES
+		SyncFence(gParticleSystemManager->subEmitterJobGroup);
 		SyncFence(gParticleSystemManager->jobGroup);
 #endif
 
@@ -396,6 +764,9 @@ void ParticleSystem::Update0(ParticleSystem& system, const ParticleSystemInitSta
 
     if (system.m_RotationModule->GetEnabled())
         system.SetUsesRotationalSpeed();
+
+	system.SelectKernels();
+	system.m_ColorModule->UpdateGradientCache();
 }
 
 void ParticleSystem::Update1(ParticleSystem& system, ParticleSystemParticles& ps, float dt, bool fixedTimeStep, bool useProcedural, int rayBudget)
@@ -418,6 +789,12 @@ void ParticleSystem::Update1(ParticleSystem& system, ParticleSystemParticles& ps
 
 		if (useProcedural)
 			UpdateProcedural(system, initState, state, ps);
+		else if (state.GetIsSubEmitter())
+			StartSubEmitterParticles(system, initState, state, ps);
+
+		// Hand this update's birth and death events to the sub-emitters
+		if (system.m_SubEmitters != NULL)
+			system.m_SubEmitters->Flush(initState.useLocalSpace, state.localToWorld);
 	}
 }
 
@@ -453,17 +830,22 @@ void ParticleSystem::Update1Incremental(ParticleSystem& system, const ParticleSy
 		const bool timePassedDuration = t >= initState.lengthInSec;
 		const float frameOffset = float(numTimeStepsTotal - 1 - numTimeSteps);
 
-		if (!initState.looping && timePassedDuration)
+		// Sub-emitters have no duration of their own, they emit whenever their parents tell them to
+		if (!initState.looping && timePassedDuration && !state.GetIsSubEmitter())
 			system.Stop();
 
 		if (!useProcedural)
+		{
 			UpdateModulesIncremental(system, initState, state, ps, fromIndex, dt);
+			if (system.m_SubEmitters != NULL && system.m_SubEmitters->GetBirthCount() != 0)
+				system.m_SubEmitters->RecordBirths(ps, fromIndex, dt);
+		}
 		else
 			for (size_t i = 0; i < state.emitReplay.size(); i++)
 				state.emitReplay[i].aliveTime += dt;
 
 		// Emission
-		bool emit = !state.stopEmitting;
+		bool emit = !state.stopEmitting && !state.GetIsSubEmitter();
 
 		if (emit)
 		{
@@ -476,12 +858,6 @@ void ParticleSystem::Update1Incremental(ParticleSystem& system, const ParticleSy
 		}
 
 		state.accumulatedDt -= dt;
-
-		// todo
-		// Workaround for external forces being dependent on AABB (need to update it before the next time step)
-		//if (!useProcedural && (state.accumulatedDt >= dt) && system.m_ExternalForcesModule->GetEnabled())
-		//	UpdateBounds(system, ps, state);
-
 		numTimeSteps++;
 	}
 }
@@ -514,7 +890,7 @@ void ParticleSystem::UpdateProcedural(ParticleSystem& system, const ParticleSyst
 		for (size_t q = previousParticleCount; q < particleCount; q++)
 		{
 			const float normalizedT = emit.t / initState.lengthInSec;
-			ps.velocity[q] *= Evaluate(system.m_InitialModule->GetSpeedCurve(), normalizedT, GenerateRandom(ps.randomSeed[q] + kParticleSystemStartSpeedCurveId));
+			ps.velocity[q] *= Evaluate(system.m_InitialModule->GetSpeedCurve(), normalizedT, GenerateRandom(ps.randomSeed[q], kParticleSystemStartSpeedCurveId));
 			Vector3f velocity = ps.velocity[q];
 			float frameOffset = (particleIndex + emit.emissionOffset) * emit.emissionGap * float(particleIndex < emit.numContinuous);
 			float aliveTime = emit.aliveTime + frameOffset;
@@ -538,43 +914,197 @@ void ParticleSystem::UpdateProcedural(ParticleSystem& system, const ParticleSyst
 		system.m_RotationModule->UpdateProcedural(state, ps);
 }
 
-void ParticleSystem::UpdateModulesPreSimulationIncremental(const ParticleSystem& system, const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, const size_t toIndex, float dt)
+void ParticleSystem::UpdateModulesIncremental(const ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, float dt)
 {
-	const size_t count = ps.array_size();
-	system.m_InitialModule->Update(initState, state, ps, fromIndex, toIndex, dt);
-	if (system.m_RotationModule->GetEnabled())
-		system.m_RotationModule->Update(initState, state, ps, fromIndex, toIndex);
+	// Forces change the velocity the simulation pass integrates. The module takes the particle bounds
+	// for the field lookup at every step, so they don't have to be kept up to date between steps.
+	if (system.m_ExternalForcesModule->GetEnabled())
+		system.m_ExternalForcesModule->Update(initState, state, ps, fromIndex, dt);
+	if (system.m_NoiseModule->GetEnabled())
+		system.m_NoiseModule->Update(ps, fromIndex, dt);
+
+	// InitialModule::Update and RotationModule::Update are fused into the simulation pass, see SimulateParticlesTpl
+	SimulateParticles(system, initState, state, ps, fromIndex, dt);
+	//UpdateModulesPostSimulationIncremental(system, roState, state, particles, fromIndex, dt);
 }
 
-void ParticleSystem::UpdateModulesIncremental(const ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, float dt)
+// Does the work of InitialModule::Update, RotationModule::Update and the integration in one pass over the particles.
+// Particles are processed in tiles so every stream is read and written once per step while the tile is still in cache.
+// Dead particles are integrated as well and only removed afterwards by CompactDeadParticles, which leaves the same
+// particles in the same order as killing them before integration.
+template<bool usesRotationalSpeed, bool hasRotationCurve>
+static bool SimulateParticlesTpl(const MinMaxCurve* rotationCurve, ParticleSystemParticles& ps, const size_t fromIndex, float dt)
 {
-	UpdateModulesPreSimulationIncremental(system, initState, state, ps, fromIndex, ps.array_size(), dt);
-	SimulateParticles(initState, state, ps, fromIndex, dt);
-	//UpdateModulesPostSimulationIncremental(system, roState, state, particles, fromIndex, dt);
+	float time[kParticleSystemCurveBatchSize];
+	float rotationalSpeed[kParticleSystemCurveBatchSize];
+	if (usesRotationalSpeed && !hasRotationCurve)
+		std::fill(rotationalSpeed, rotationalSpeed + kParticleSystemCurveBatchSize, 0.0f);
+
+	bool anyDead = false;
+	const size_t particleCount = ps.array_size();
+	for (size_t from = fromIndex; from < particleCount; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, particleCount - from);
+
+		if (usesRotationalSpeed && hasRotationCurve)
+		{
+			NormalizedTimeBatch(ps, from, count, time);
+			EvaluateBatch(*rotationCurve, time, &ps.randomSeed[from], rotationalSpeed, count, kParticleSystemRotationCurveId);
+		}
+
+		float* lifetime = &ps.lifetime[from];
+		Vector3f* position = &ps.position[from];
+		const Vector3f* velocity = &ps.velocity[from];
+		Vector3f* animatedVelocity = &ps.animatedVelocity[from];
+		for (size_t i = 0; i < count; ++i)
+		{
+			lifetime[i] -= dt;
+			anyDead |= (lifetime[i] < 0.0f);
+
+			// animatedVelocity is reset by the initial module and no module in this pass adds to it
+			animatedVelocity[i] = Vector3f::zero;
+			position[i] += velocity[i] * dt;
+		}
+
+		if (usesRotationalSpeed)
+		{
+			float* rotation = &ps.rotation[from];
+			float* psRotationalSpeed = &ps.rotationalSpeed[from];
+			for (size_t i = 0; i < count; ++i)
+			{
+				psRotationalSpeed[i] = rotationalSpeed[i];
+				rotation[i] += rotationalSpeed[i] * dt;
+			}
+		}
+	}
+	return anyDead;
+}
+
+// Advances the freshly emitted particles [fromIndex, end) by their sub frame offset, doing the work of InitialModule::Update
+// and RotationModule::Update for the whole range. Same tiling and deferred kills as SimulateParticlesTpl.
+template<bool usesRotationalSpeed, bool hasRotationCurve>
+static bool StartSubFrameTpl(const MinMaxCurve* rotationCurve, const ParticleSystemEmissionState& emissionState, const Vector3f& initialVelocity
+	, ParticleSystemParticles& ps, size_t fromIndex, float dt, size_t numContinuous, float frameOffset)
+{
+	float subFrameOffset[kParticleSystemCurveBatchSize];
+	float time[kParticleSystemCurveBatchSize];
+	float rotationalSpeed[kParticleSystemCurveBatchSize];
+	if (usesRotationalSpeed && !hasRotationCurve)
+		std::fill(rotationalSpeed, rotationalSpeed + kParticleSystemCurveBatchSize, 0.0f);
+
+	bool anyDead = false;
+	const size_t particleCount = ps.array_size();
+	for (size_t from = fromIndex; from < particleCount; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, particleCount - from);
+
+		// subFrameOffset allows particles to be spawned at increasing times, thus spacing particles within a single frame.
+		// For example if you spawn particles with high velocity you will get a continous streaming instead of a clump of particles.
+		const size_t firstParticleIndex = from - fromIndex;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const size_t particleIndex = firstParticleIndex + i;
+			const float offset = (particleIndex < numContinuous) ? (float(particleIndex) + emissionState.m_ToEmitAccumulator) * emissionState.m_ParticleSpacing : 0.0f;
+			subFrameOffset[i] = clamp01(offset);
+		}
+
+		// Update from curves and apply forces etc.
+		if (usesRotationalSpeed && hasRotationCurve)
+		{
+			NormalizedTimeBatch(ps, from, count, time);
+			EvaluateBatch(*rotationCurve, time, &ps.randomSeed[from], rotationalSpeed, count, kParticleSystemRotationCurveId);
+		}
+
+		// Position change due to where the emitter was at time of emission, then position and
+		// energy change due to how much the particle has travelled since time of emission
+		float* lifetime = &ps.lifetime[from];
+		Vector3f* position = &ps.position[from];
+		const Vector3f* velocity = &ps.velocity[from];
+		Vector3f* animatedVelocity = &ps.animatedVelocity[from];
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float subFrameDt = subFrameOffset[i] * dt;
+			lifetime[i] -= subFrameDt;
+			anyDead |= (lifetime[i] < 0.0f);
+
+			animatedVelocity[i] = Vector3f::zero;
+			position[i] -= initialVelocity * (frameOffset + subFrameOffset[i]) * dt;
+			position[i] += velocity[i] * subFrameDt;
+		}
+
+		if (usesRotationalSpeed)
+		{
+			float* rotation = &ps.rotation[from];
+			float* psRotationalSpeed = &ps.rotationalSpeed[from];
+			for (size_t i = 0; i < count; ++i)
+			{
+				psRotationalSpeed[i] = rotationalSpeed[i];
+				rotation[i] += rotationalSpeed[i] * subFrameOffset[i] * dt;
+			}
+		}
+	}
+	return anyDead;
 }
 
-void ParticleSystem::SimulateParticles(const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, float dt)
+// Removes particles with negative lifetime from [fromIndex, end) in a single pass
+static void CompactDeadParticles(const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, ParticleSystemSubEmitters* subEmitters)
 {
+	if (subEmitters != NULL && !subEmitters->HasDeathEmitters())
+		subEmitters = NULL;
+
 	size_t particleCount = ps.array_size();
 	for (size_t q = fromIndex; q < particleCount;)
 	{
-		ps.lifetime[q] -= dt;
-
-		if (ps.lifetime[q] < 0)
+		if (ps.lifetime[q] < 0.0f)
 		{
+			if (subEmitters != NULL)
+				subEmitters->RecordDeath(ps, q);
 			KillParticle(initState, state, ps, q, particleCount);
 			continue;
 		}
 		++q;
 	}
 	ps.array_resize(particleCount);
+}
+
+struct ParticleSystemKernels
+{
+	bool (*simulate)(const MinMaxCurve* rotationCurve, ParticleSystemParticles& ps, const size_t fromIndex, float dt);
+	bool (*startSubFrame)(const MinMaxCurve* rotationCurve, const ParticleSystemEmissionState& emissionState, const Vector3f& initialVelocity
+		, ParticleSystemParticles& ps, size_t fromIndex, float dt, size_t numContinuous, float frameOffset);
+};
+
+#define PARTICLE_SYSTEM_KERNELS(usesRotationalSpeed, hasRotationCurve) { &SimulateParticlesTpl<usesRotationalSpeed, hasRotationCurve>, &StartSubFrameTpl<usesRotationalSpeed, hasRotationCurve> }
+
+// Indexed by ParticleSystem::SelectKernels
+static const ParticleSystemKernels s_Kernels[] =
+{
+	PARTICLE_SYSTEM_KERNELS(false, false),
+	PARTICLE_SYSTEM_KERNELS(true, false),
+	PARTICLE_SYSTEM_KERNELS(true, true),
+};
+
+#undef PARTICLE_SYSTEM_KERNELS
+
+void ParticleSystem::SelectKernels()
+{
+	// The curve evaluation mode is resolved once per tile by EvaluateBatch, so it doesn't need its own kernels
+	int index = 0;
+	if (m_Particles->usesRotationalSpeed)
+		index = m_RotationModule->GetEnabled() ? 2 : 1;
 
-	for (size_t q = fromIndex; q < particleCount; ++q)
-		ps.position[q] += (ps.velocity[q] + ps.animatedVelocity[q]) * dt;
+	if (index != m_KernelIndex)
+	{
+		m_KernelIndex = index;
+		m_Kernels = &s_Kernels[index];
+	}
+}
 
-	if (ps.usesRotationalSpeed)
-		for (size_t q = fromIndex; q < particleCount; ++q)
-			ps.rotation[q] += ps.rotationalSpeed[q] * dt;
+void ParticleSystem::SimulateParticles(const ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, float dt)
+{
+	const MinMaxCurve* rotationCurve = system.m_RotationModule->GetEnabled() ? &system.m_RotationModule->GetCurve() : NULL;
+	if (system.m_Kernels->simulate(rotationCurve, ps, fromIndex, dt))
+		CompactDeadParticles(initState, state, ps, fromIndex, system.m_SubEmitters);
 }
 
 void ParticleSystem::UpdateModulesNonIncremental(const ParticleSystem& system, const ParticleSystemParticles& ps, ParticleSystemParticlesTempData& psTemp, size_t fromIndex, size_t toIndex)
@@ -615,46 +1145,25 @@ void ParticleSystem::StartModules(ParticleSystem& system, const ParticleSystemIn
 
 	const float normalizedT = t / initState.lengthInSec;
 
-	size_t count = ps.array_size();
+	const size_t count = ps.array_size();
 	const Vector3f velocityOffset = system.m_InitialModule->GetInheritVelocity() * initialVelocity;
-	for (size_t q = fromIndex; q < count; q++)
+	float time[kParticleSystemCurveBatchSize];
+	float speed[kParticleSystemCurveBatchSize];
+	std::fill(time, time + kParticleSystemCurveBatchSize, normalizedT);
+	for (size_t from = fromIndex; from < count; from += kParticleSystemCurveBatchSize)
 	{
-		const float randomValue = GenerateRandom(ps.randomSeed[q] + kParticleSystemStartSpeedCurveId);
-		ps.velocity[q] *= Evaluate(system.m_InitialModule->GetSpeedCurve(), normalizedT, randomValue);
-		ps.velocity[q] += velocityOffset;
-	}
-
-	for (size_t q = fromIndex; q < count;) // array size changes
-	{
-		// subFrameOffset allows particles to be spawned at increasing times, thus spacing particles within a single frame.
-		// For example if you spawn particles with high velocity you will get a continous streaming instead of a clump of particles.
-		const int particleIndex = q - fromIndex;
-		float subFrameOffset = (particleIndex < (int)numContinuous) ? (float(particleIndex) + emissionState.m_ToEmitAccumulator) * emissionState.m_ParticleSpacing : 0.0f;
-		subFrameOffset = clamp01(subFrameOffset);
-
-		// Update from curves and apply forces etc.
-		UpdateModulesPreSimulationIncremental(system, initState, state, ps, q, q + 1, subFrameOffset * dt);
-
-		// Position change due to where the emitter was at time of emission
-		ps.position[q] -= initialVelocity * (frameOffset + subFrameOffset) * dt;
-
-		// Position, rotation and energy change due to how much the particle has travelled since time of emission
-		// @TODO: Call Simulate instead?
-		ps.lifetime[q] -= subFrameOffset * dt;
-		if ((ps.lifetime[q] < 0.0f) && (count > 0))
+		const size_t batchCount = std::min<size_t>(kParticleSystemCurveBatchSize, count - from);
+		EvaluateBatch(system.m_InitialModule->GetSpeedCurve(), time, &ps.randomSeed[from], speed, batchCount, kParticleSystemStartSpeedCurveId);
+		for (size_t i = 0; i < batchCount; ++i)
 		{
-			KillParticle(initState, state, ps, q, count);
-			continue;
+			ps.velocity[from + i] *= speed[i];
+			ps.velocity[from + i] += velocityOffset;
 		}
-
-		ps.position[q] += (ps.velocity[q] + ps.animatedVelocity[q]) * subFrameOffset * dt;
-
-		if (ps.usesRotationalSpeed)
-			ps.rotation[q] += ps.rotationalSpeed[q] * subFrameOffset * dt;
-
-		++q;
 	}
-	ps.array_resize(count);
+
+	const MinMaxCurve* rotationCurve = system.m_RotationModule->GetEnabled() ? &system.m_RotationModule->GetCurve() : NULL;
+	if (system.m_Kernels->startSubFrame(rotationCurve, emissionState, initialVelocity, ps, fromIndex, dt, numContinuous, frameOffset))
+		CompactDeadParticles(initState, state, ps, fromIndex, system.m_SubEmitters);
 }
 
 void ParticleSystem::StartParticles(ParticleSystem& system, ParticleSystemParticles& ps, const float prevT, const float t, const float dt, const size_t numContinuous, size_t amountOfParticlesToEmit, float frameOffset)
@@ -669,6 +1178,33 @@ void ParticleSystem::StartParticles(ParticleSystem& system, ParticleSystemPartic
 	StartModules(system, initState, state, state.emissionState, state.emitterVelocity, localToWorld, ps, fromIndex, dt, t, numContinuous, frameOffset);
 }
 
+void ParticleSystem::StartSubEmitterParticles(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps)
+{
+	dynamic_array<ParticleSystemSubEmitterEvent> events(kMemTempAlloc);
+	system.m_SubEmitterQueue->PopAll(events);
+
+	// Each event starts its particles at the parent particle, the shape module still applies around that point
+	Matrix4x4f matrix = !initState.useLocalSpace ? state.localToWorld : Matrix4x4f::identity;
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		const ParticleSystemSubEmitterEvent& event = events[i];
+		const size_t fromIndex = system.AddNewParticles(ps, event.particleCount);
+		if (fromIndex == ps.array_size())
+			break;
+
+		Vector3f position = event.position;
+		Vector3f velocity = event.velocity;
+		if (initState.useLocalSpace)
+		{
+			position = state.WorldToLocal.MultiplyPoint3(position);
+			velocity = state.WorldToLocal.MultiplyVector3(velocity);
+		}
+		matrix.SetPosition(position);
+
+		StartModules(system, initState, state, state.emissionState, velocity, matrix, ps, fromIndex, 0.0f, state.t, 0, 0.0f);
+	}
+}
+
 void ParticleSystem::StartParticlesProcedural(ParticleSystem& system, ParticleSystemParticles& ps, const float prevT, const float t, const float dt, const size_t numContinuous, size_t amountOfParticlesToEmit, float frameOffset)
 {
 	ParticleSystemState& state = *system.m_State;
@@ -691,6 +1227,9 @@ void ParticleSystem::StartParticlesProcedural(ParticleSystem& system, ParticleSy
 bool ParticleSystem::CheckSupportsProcedural(const ParticleSystem& system)
 {
 	// todo
+	// Force fields and noise depend on where the particles are, which procedural mode can't replay
+	if (system.m_ExternalForcesModule->GetEnabled() || system.m_NoiseModule->GetEnabled())
+		return false;
 	return true;
 }
 
@@ -816,6 +1355,7 @@ ParticleSystemParticles& ParticleSystem::GetParticles()
 
 void ParticleSystem::PrepareForRender()
 {
+	m_ColorModule->UpdateGradientCache();
 	m_Renderer->PrepareForRender(*this);
 }
 
@@ -883,6 +1423,17 @@ void ParticleSystem::Simulate(float deltaTime, bool restart, bool fixedTimeStep)
 }
 
 void ParticleSystem::AddToManager()
+{
+	QueuePendingChange(m_SlotIndex, kPendingAdd);
+}
+
+void ParticleSystem::RemoveFromManager()
+{
+	QueuePendingChange(m_SlotIndex, kPendingRemove);
+}
+
+// Main thread only, see ApplyPendingChanges
+void ParticleSystem::AddToEmitters()
 {
 	if (m_EmittersIndex >= 0)
 		return;
@@ -892,7 +1443,96 @@ void ParticleSystem::AddToManager()
 	m_EmittersIndex = index;
 }
 
-void ParticleSystem::RemoveFromManager()
+bool ParticleSystem::AddSubEmitter(ParticleSystem* emitter, ParticleSystemSubType type)
+{
+	if (emitter == nullptr || emitter == this)
+		return false;
+
+	const ParticleSystemEmissionData& emissionData = emitter->m_EmissionModule->GetEmissionDataRef();
+	const float rate = std::max<float>(0.0f, Evaluate(emissionData.rate, 0.0f));
+	UInt32 burstCount = 0;
+	for (int i = 0; i < emissionData.burstCount; ++i)
+		burstCount += emissionData.burstParticleCount[i];
+	// Without bursts a death or collision event emits one second worth of the rate
+	if (burstCount == 0)
+		burstCount = std::max<UInt32>(1, UInt32(rate));
+
+	if (m_SubEmitters == nullptr)
+		m_SubEmitters = new ParticleSystemSubEmitters();
+	if (!m_SubEmitters->Add(emitter, type, rate, burstCount))
+		return false;
+
+	// Birth events accumulate the fractional particles per parent particle
+	ParticleSystemParticles& ps = *m_Particles;
+	const int accumulatorCount = m_SubEmitters->GetBirthCount();
+	for (int acc = ps.numEmitAccumulators; acc < accumulatorCount; ++acc)
+		ps.emitAccumulator[acc].resize_initialized(ps.array_size(), 0.0f);
+	ps.numEmitAccumulators = accumulatorCount;
+
+	if (emitter->m_SubEmitterQueue == nullptr)
+		emitter->m_SubEmitterQueue = new ParticleSystemSubEmitterQueue();
+	emitter->m_State->SetIsSubEmitter(true);
+	emitter->Play(false);
+	return true;
+}
+
+static bool IsSubEmitterOfAnySystem(const ParticleSystem* emitter)
+{
+	ParticleSystemSlotMap& systems = gParticleSystemManager->systems;
+	for (int i = 0; i < systems.GetSlotCount(); ++i)
+	{
+		const ParticleSystem* system = systems.Get(i);
+		if (system != nullptr && system->GetSubEmitters() != nullptr && system->GetSubEmitters()->Contains(emitter))
+			return true;
+	}
+	return false;
+}
+
+// Main thread only, jobs must be synced
+void ParticleSystem::ClearSubEmitters()
+{
+	if (m_SubEmitters == nullptr)
+		return;
+
+	ParticleSystem* children[kParticleSystemMaxSubTotal];
+	int childCount = 0;
+	for (int i = 0; i < m_SubEmitters->GetCount(); ++i)
+	{
+		ParticleSystem* child = m_SubEmitters->GetEmitter(i);
+		if (child != nullptr && std::find(children, children + childCount, child) == children + childCount)
+			children[childCount++] = child;
+	}
+
+	m_SubEmitters->Clear();
+
+	ParticleSystemParticles& ps = *m_Particles;
+	for (int acc = 0; acc < ps.numEmitAccumulators; ++acc)
+		ps.emitAccumulator[acc].clear();
+	ps.numEmitAccumulators = 0;
+
+	for (int i = 0; i < childCount; ++i)
+	{
+		if (!IsSubEmitterOfAnySystem(children[i]))
+			children[i]->DetachFromParents();
+	}
+}
+
+// Undoes AddSubEmitter on the child once it has no parent left. A sub-emitter never emits on its own and is never
+// removed from the manager, so it is stopped and goes out like any other system when its particles are gone.
+void ParticleSystem::DetachFromParents()
+{
+	delete m_SubEmitterQueue;
+	m_SubEmitterQueue = nullptr;
+	m_State->SetIsSubEmitter(false);
+
+	Stop();
+	// Without particles Stop ended playback right away, EndUpdateAll only removes systems that are playing
+	if (!m_State->playing)
+		RemoveFromManager();
+}
+
+// Main thread only, see ApplyPendingChanges
+void ParticleSystem::RemoveFromEmitters()
 {
 	if (m_EmittersIndex < 0)
 		return;
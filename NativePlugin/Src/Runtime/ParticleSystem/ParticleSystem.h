@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ParticleSystemModule.h"
+#include "ParticleSystemCommon.h"
 
 class ParticleSystemRenderer;
 struct ParticleSystemParticles;
@@ -12,9 +13,14 @@ class ColorModule;
 class SizeModule;
 class UVModule;
 class ShapeModule;
+class ExternalForcesModule;
+class NoiseModule;
 class InitialModule;
 class EmissionModule;
 struct Job;
+struct ParticleSystemKernels;
+class ParticleSystemSubEmitters;
+class ParticleSystemSubEmitterQueue;
 
 struct ParticleSystemThreadScratchPad
 {
@@ -39,21 +45,24 @@ public:
 	// allocate N particles at a time
 	static const size_t kMemAllocGranularity = 64;
 
+	// Systems are referred to by handles, see ParticleSystemSlotMap
 	static int CreateParticleSystrem(ParticleSystemInitState* initState);
+	static void DestroyParticleSystem(int handle);
 	static void Init();
 	static void ShutDown();
 	static void BeginUpdateAll();
 	static void EndUpdateAll();
 	static void Prepare();
-	static void Prepare(int index);
+	static void Prepare(int handle);
 	static void Render();
-	static void Render(int index);
+	static void Render(int handle);
 	static void Update(ParticleSystem& system, float deltaTime, bool fixedTimeStep, bool useProcedural, int rayBudget = 0);
 	static void SyncJobs(bool syncRenderJobs = true);
 	static void UpdateFunction(ParticleSystem* system);
 	static bool CompareJobs(const Job& left, const Job& right);
 
-	ParticleSystem(ParticleSystemInitState* initState);
+	// initState is shared with other systems, see AcquireParticleSystemInitState
+	ParticleSystem(const ParticleSystemInitState* initState);
 	~ParticleSystem();
 
 	void Play(bool autoPrewarm = true);
@@ -68,6 +77,7 @@ public:
 	void SetUsesAxisOfRotation();
 	void Simulate(float deltaTime, bool restart, bool fixedTimeStep);	// Fastforwards the particle system by simulating particles over given period of time, then pauses it.
 
+	// Can be called from any thread, the change is applied at the start of the next BeginUpdateAll
 	void AddToManager();
     void RemoveFromManager();
 
@@ -77,8 +87,23 @@ public:
     void SetWorldMatrix(const Matrix4x4f& worldMatrix) { m_WorldMatrix = worldMatrix; }
 	ParticleSystemThreadScratchPad& GetThreadScratchPad() { return m_ThreadScratchpad; }
     ParticleSystemRenderer* GetRenderer() { return m_Renderer; }
+    ShapeModule* GetShapeModule() { return m_ShapeModule; }
+    ExternalForcesModule* GetExternalForcesModule() { return m_ExternalForcesModule; }
+    NoiseModule* GetNoiseModule() { return m_NoiseModule; }
+
+	// Sub-emitters are configured through their emission module: the rate is used for birth events,
+	// the bursts for death and collision events. Must not be called while particle jobs are running.
+	bool AddSubEmitter(ParticleSystem* emitter, ParticleSystemSubType type);
+	// Sub-emitters no other parent uses anymore are stopped and updated like any other system again
+	void ClearSubEmitters();
+	ParticleSystemSubEmitterQueue* GetSubEmitterQueue() { return m_SubEmitterQueue; }
+	const ParticleSystemSubEmitters* GetSubEmitters() const { return m_SubEmitters; }
 
 private:
+	static void ApplyPendingChanges();
+	void AddToEmitters();
+	void RemoveFromEmitters();
+	void DetachFromParents();
 	void ResetSeeds();
 	static size_t EmitFromModules(const ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemEmissionState& emissionState, size_t& numContinuous, const Vector3f velocity, float fromT, float toT, float dt);
 	static void Update0(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, float dt, bool fixedTimeStep);
@@ -86,15 +111,16 @@ private:
 	static void Update2(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, bool fixedTimeStep);
 	static void Update1Incremental(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, float dt, bool useProcedural);
 	static void UpdateProcedural(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps);
-	static void UpdateModulesPreSimulationIncremental(const ParticleSystem& system, const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, const size_t toIndex, float dt);
 	static void UpdateModulesIncremental(const ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, size_t fromIndex, float dt);
 	static void UpdateModulesNonIncremental(const ParticleSystem& system, const ParticleSystemParticles& ps, ParticleSystemParticlesTempData& psTemp, size_t fromIndex, size_t toIndex);
-	static void SimulateParticles(const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, float dt);
+	static void SimulateParticles(const ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, float dt);
 	static void StartModules(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, const ParticleSystemEmissionState& emissionState, Vector3f initialVelocity, const Matrix4x4f& matrix, ParticleSystemParticles& ps, size_t fromIndex, float dt, float t, size_t numContinuous, float frameOffset);
 	static void StartParticles(ParticleSystem& system, ParticleSystemParticles& ps, const float prevT, const float t, const float dt, const size_t numContinuous, size_t amountOfParticlesToEmit, float frameOffset);
+	static void StartSubEmitterParticles(ParticleSystem& system, const ParticleSystemInitState& initState, ParticleSystemState& state, ParticleSystemParticles& ps);
 	static void StartParticlesProcedural(ParticleSystem& system, ParticleSystemParticles& ps, const float prevT, const float t, const float dt, const size_t numContinuous, size_t amountOfParticlesToEmit, float frameOffset);
 	static bool CheckSupportsProcedural(const ParticleSystem& system);
 
+	void SelectKernels();
 	void Cull();
 	size_t AddNewParticles(ParticleSystemParticles& particles, size_t newParticles) const;
 	size_t LimitParticleCount(size_t requestSize) const;
@@ -103,19 +129,26 @@ private:
     void SetUsesRotationalSpeed();
 
 private:
+    int m_SlotIndex;
     int m_EmittersIndex;
 	ParticleSystemRenderer* m_Renderer;
 	ParticleSystemParticles* m_Particles;
-	ParticleSystemInitState* m_InitState;
+	const ParticleSystemInitState* m_InitState;
 	ParticleSystemState* m_State;
 	Transform* m_Transform;
 	InitialModule* m_InitialModule;
 	ShapeModule* m_ShapeModule;
 	EmissionModule* m_EmissionModule;
+	ExternalForcesModule* m_ExternalForcesModule;
+	NoiseModule* m_NoiseModule;
 	RotationModule*	m_RotationModule; // @TODO: Requires outputs angular velocity and thus requires integration (Inconsistent with other modules in this group)
 	ColorModule* m_ColorModule;
 	SizeModule*	m_SizeModule;
 	UVModule* m_UVModule;
+	const ParticleSystemKernels* m_Kernels; // Update loops specialized for the enabled modules, see SelectKernels
+	int m_KernelIndex;
+	ParticleSystemSubEmitters* m_SubEmitters; // Sub-emitters this system spawns particles in, NULL if none
+	ParticleSystemSubEmitterQueue* m_SubEmitterQueue; // Spawn events from the parents, NULL unless this is a sub-emitter
 	bool m_IsActive = true;
     Matrix4x4f m_WorldMatrix;
 	ParticleSystemThreadScratchPad	m_ThreadScratchpad;
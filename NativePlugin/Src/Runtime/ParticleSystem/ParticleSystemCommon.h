@@ -35,6 +35,8 @@ enum ParticleSystemRandomnessIds
 	kParticleSystemSizeBySpeedCurveId = 0xf3857f6f,
 	kParticleSystemVelocityCurveId = 0xe0fbd834,
 	kParticleSystemUVCurveId = 0x13740583,
+	kParticleSystemNoiseStrengthCurveId = 0x4bfa1d97,
+	kParticleSystemNoiseOctaveCurveId = 0x2d8e0c65,
 
 	// Gradient
 	kParticleSystemColorGradientId = 0x591bc05c,
@@ -43,6 +45,9 @@ enum ParticleSystemRandomnessIds
 	// Misc
 	kParticleSystemMeshSelectionId = 0xbc524e5f,
 	kParticleSystemUVRowSelectionId = 0xaf502044,
+	kParticleSystemStartParametersId = 0x2d9cf1a7,
+	kParticleSystemStartRandomSeedId = 0x7b1e6c05,
+	kParticleSystemShapeId = 0x3c6ef372, // ShapeModule uses kParticleSystemShapeId + n for its n-th random value per particle
 };
 
 #endif // PARTICLESYSTEMCOMMON_H
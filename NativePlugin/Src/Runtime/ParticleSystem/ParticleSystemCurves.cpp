@@ -3,6 +3,11 @@
 #include "Math/AnimationCurve.h"
 #include "Math/Vector2.h"
 #include "Math/Polynomials.h"
+#include "ParticleSystemUtils.h"
+
+#if UNITY_SUPPORTS_SSE
+#include <xmmintrin.h>
+#endif
 
 // Calculates the min max range of an animation curve analytically
 static void CalculateCurveRangesValue(Vector2f& minMaxValue, const AnimationCurve& curve)
@@ -131,11 +136,27 @@ MinMaxCurve::MinMaxCurve ()
 :	scalar (1.0f)
 ,	minMaxState (kMMCScalar)
 ,	isOptimizedCurve(false)
+,	isBakedCurve(false)
 {
 	SetPolynomialCurveToValue (editorCurves.max, polyCurves.max, 1.0f);
 	SetPolynomialCurveToValue (editorCurves.min, polyCurves.min, 0.0f);
 }
 
+bool MinMaxCurve::Bake (int sampleCount, float maxError)
+{
+	isBakedCurve = false;
+	if (isOptimizedCurve || (minMaxState != kMMCCurve && minMaxState != kMMCTwoCurves))
+		return false;
+
+	if (!bakedCurves.max.Bake (editorCurves.max, scalar, sampleCount, maxError))
+		return false;
+	if (minMaxState == kMMCTwoCurves && !bakedCurves.min.Bake (editorCurves.min, scalar, sampleCount, maxError))
+		return false;
+
+	isBakedCurve = true;
+	return true;
+}
+
 Vector2f MinMaxCurve::FindMinMax() const
 {
 	Vector2f result = Vector2f(std::numeric_limits<float>::infinity (), -std::numeric_limits<float>::infinity ());
@@ -178,3 +199,157 @@ Vector2f MinMaxCurve::FindMinMaxDoubleIntegrated() const
 		return doubleIntegrated.FindMinMaxDoubleIntegrated();
 	}
 }
+
+bool BakedCurve::Bake (const AnimationCurve& curve, float scalar, int requestedSampleCount, float maxError)
+{
+	if (curve.GetKeyCount () == 0)
+		return false;
+
+	Vector2f range = Vector2f(std::numeric_limits<float>::infinity (), -std::numeric_limits<float>::infinity ());
+	CalculateCurveRangesValue (range, curve);
+	const float tolerance = maxError * Abs (scalar) * std::max (range.y - range.x, 0.0001f);
+
+	// Doubling a count that isn't a power of two would overshoot, the last try is clamped to kMaxSampleCount
+	for (int count = clamp<int> (requestedSampleCount, kMinSampleCount, kMaxSampleCount);; count = std::min<int> (count * 2, kMaxSampleCount))
+	{
+		sampleCount = count;
+		samples.resize_uninitialized (count + 1);
+		const float step = 1.0f / float(count);
+		for (int i = 0; i <= count; ++i)
+		{
+			samples[i] = curve.Evaluate (float(i) * step) * scalar;
+		}
+
+		// Compare against the original curve inside every segment, where the linear interpolation is furthest off
+		bool withinTolerance = true;
+		for (int i = 0; i < count && withinTolerance; ++i)
+		{
+			for (int j = 1; j < 4; ++j)
+			{
+				const float t = (float(i) + float(j) * 0.25f) * step;
+				if (!(Abs (Evaluate (t) - curve.Evaluate (t) * scalar) <= tolerance))
+				{
+					withinTolerance = false;
+					break;
+				}
+			}
+		}
+
+		if (withinTolerance)
+			return true;
+
+		if (count == kMaxSampleCount)
+			break;
+	}
+
+	sampleCount = 0;
+	samples.clear ();
+	return false;
+}
+
+// Evaluates both polynomial segments with Horner's scheme and selects the result per element,
+// which gives the same values as OptimizedPolynomialCurve::Evaluate without a branch per particle.
+static void EvaluateOptimizedBatch (const OptimizedPolynomialCurve& curve, const float* t, float* out, size_t n)
+{
+	const float* coeff0 = curve.segments[0].coeff;
+	const float* coeff1 = curve.segments[1].coeff;
+	const float timeValue = curve.timeValue;
+
+	size_t i = 0;
+#if UNITY_SUPPORTS_SSE
+	const __m128 a0 = _mm_set1_ps(coeff0[0]), b0 = _mm_set1_ps(coeff0[1]), c0 = _mm_set1_ps(coeff0[2]), d0 = _mm_set1_ps(coeff0[3]);
+	const __m128 a1 = _mm_set1_ps(coeff1[0]), b1 = _mm_set1_ps(coeff1[1]), c1 = _mm_set1_ps(coeff1[2]), d1 = _mm_set1_ps(coeff1[3]);
+	const __m128 split = _mm_set1_ps(timeValue);
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m128 time0 = _mm_loadu_ps(t + i);
+		const __m128 time1 = _mm_sub_ps(time0, split);
+		const __m128 res0 = _mm_add_ps(_mm_mul_ps(time0, _mm_add_ps(_mm_mul_ps(time0, _mm_add_ps(_mm_mul_ps(time0, a0), b0)), c0)), d0);
+		const __m128 res1 = _mm_add_ps(_mm_mul_ps(time1, _mm_add_ps(_mm_mul_ps(time1, _mm_add_ps(_mm_mul_ps(time1, a1), b1)), c1)), d1);
+		const __m128 mask = _mm_cmpgt_ps(time0, split);
+		_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(mask, res1), _mm_andnot_ps(mask, res0)));
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		const float res0 = Polynomial::EvalSegment(t[i], coeff0);
+		const float res1 = Polynomial::EvalSegment(t[i] - timeValue, coeff1);
+		out[i] = (t[i] > timeValue) ? res1 : res0;
+	}
+}
+
+static void GenerateRandomFactors (const UInt32* seeds, UInt32 randomId, float* out, size_t n)
+{
+	if (seeds)
+		GenerateRandomBatch(seeds, randomId, out, n);
+	else
+		std::fill(out, out + n, 1.0f);
+}
+
+// Handles the modes that don't need a random value, returns false if the curve needs one
+static bool EvaluateBatchWithoutRandom (const MinMaxCurve& curve, const float* t, float* out, size_t n)
+{
+	if (curve.minMaxState == kMMCScalar)
+	{
+		std::fill(out, out + n, curve.GetScalar());
+		return true;
+	}
+
+	if (curve.isOptimizedCurve && !curve.UsesMinMax())
+	{
+		EvaluateOptimizedBatch(curve.polyCurves.max, t, out, n);
+		return true;
+	}
+	return false;
+}
+
+// count must not exceed kParticleSystemCurveBatchSize
+static void EvaluateBatchChunk (const MinMaxCurve& curve, const float* t, const float* factor, float* out, size_t count)
+{
+	if (curve.minMaxState == kMMCTwoConstants)
+	{
+		const float v0 = curve.editorCurves.min.GetKey(0).value * curve.GetScalar();
+		const float v1 = curve.editorCurves.max.GetKey(0).value * curve.GetScalar();
+		for (size_t i = 0; i < count; ++i)
+			out[i] = Lerp(v0, v1, factor[i]);
+	}
+	else if (curve.isOptimizedCurve)
+	{
+		float minValue[kParticleSystemCurveBatchSize];
+		EvaluateOptimizedBatch(curve.polyCurves.min, t, minValue, count);
+		EvaluateOptimizedBatch(curve.polyCurves.max, t, out, count);
+		for (size_t i = 0; i < count; ++i)
+			out[i] = Lerp(minValue[i], out[i], factor[i]);
+	}
+	else
+	{
+		for (size_t i = 0; i < count; ++i)
+			out[i] = EvaluateSlow(curve, t[i], factor[i]);
+	}
+}
+
+void EvaluateBatch (const MinMaxCurve& curve, const float* t, const UInt32* seeds, float* out, size_t n, UInt32 randomId)
+{
+	if (EvaluateBatchWithoutRandom(curve, t, out, n))
+		return;
+
+	float factor[kParticleSystemCurveBatchSize];
+	for (size_t from = 0; from < n; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, n - from);
+		GenerateRandomFactors(seeds ? seeds + from : NULL, randomId, factor, count);
+		EvaluateBatchChunk(curve, t + from, factor, out + from, count);
+	}
+}
+
+void EvaluateBatch (const MinMaxCurve& curve, const float* t, const float* randomValue, float* out, size_t n)
+{
+	if (EvaluateBatchWithoutRandom(curve, t, out, n))
+		return;
+
+	for (size_t from = 0; from < n; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, n - from);
+		EvaluateBatchChunk(curve, t + from, randomValue + from, out + from, count);
+	}
+}
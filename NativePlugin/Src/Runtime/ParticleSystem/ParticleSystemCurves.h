@@ -15,6 +15,7 @@ struct MinMaxCurve;
 // Random between 2 curves:					9.5  ms
 // Non-optimized curve:						10.0 ms
 // Random between 2 non-optimized curves:	12.0 ms
+// Reproduce with ParticleSystemCurvesPerformanceTests (element counts from 10k to 1M).
 
 enum ParticleSystemCurveEvalMode
 {
@@ -90,6 +91,37 @@ struct MinMaxAnimationCurves
 	AnimationCurve min;
 };
 
+// Uniformly sampled approximation of an AnimationCurve over t = [0, 1] with the scalar baked in.
+// Used for curves that have too many keys for OptimizedPolynomialCurve, so they evaluate with a lookup and a lerp
+// instead of the keyframe search in AnimationCurve::Evaluate. t outside [0, 1] is clamped.
+struct BakedCurve
+{
+	enum { kMinSampleCount = 64, kMaxSampleCount = 256 };
+
+	BakedCurve () : sampleCount (0) {}
+
+	// Samples the curve with sampleCount segments, doubling the count up to kMaxSampleCount until the
+	// interpolated result stays within maxError of the original, relative to the curve's value range.
+	// Returns false if the error bound could not be met, in which case the curve must not be used.
+	bool Bake (const AnimationCurve& curve, float scalar, int sampleCount, float maxError);
+
+	inline float Evaluate (float t) const
+	{
+		const float sampleT = clamp01 (t) * float(sampleCount);
+		const int index = std::min<int> (int(sampleT), sampleCount - 1);
+		return Lerp (samples[index], samples[index + 1], sampleT - float(index));
+	}
+
+	dynamic_array<float> samples;	// sampleCount + 1 values
+	int sampleCount;
+};
+
+struct MinMaxBakedCurves
+{
+	BakedCurve max;
+	BakedCurve min;
+};
+
 bool BuildCurves (MinMaxOptimizedPolyCurves& polyCurves, const MinMaxAnimationCurves& editorCurves, float scalar, short minMaxState);
 void BuildCurves (MinMaxPolyCurves& polyCurves, const MinMaxAnimationCurves& editorCurves, float scalar, short minMaxState);
 bool CurvesSupportProcedural (const MinMaxAnimationCurves& editorCurves, short minMaxState);
@@ -103,15 +135,22 @@ private:
 public:
 	short minMaxState;	// see enum MinMaxCurveState
 	bool isOptimizedCurve;
+	bool isBakedCurve;
 	
 	MinMaxAnimationCurves editorCurves;
+	MinMaxBakedCurves bakedCurves;	// Only valid if isBakedCurve
 	
 	MinMaxCurve ();
 
 	inline float GetScalar() const { return scalar; }
-	inline void SetScalar(float value) { scalar = value; isOptimizedCurve = BuildCurves(polyCurves, editorCurves, scalar, minMaxState); }
+	inline void SetScalar(float value) { scalar = value; isOptimizedCurve = BuildCurves(polyCurves, editorCurves, scalar, minMaxState); isBakedCurve = false; }
+
+	// Opt-in: bakes curves that couldn't be optimized into lookup tables, see BakedCurve::Bake.
+	// Has to be called again after the keys or the scalar change.
+	bool Bake (int sampleCount, float maxError);
 	
 	bool IsOptimized () const { return isOptimizedCurve; }
+	bool IsBaked () const { return isBakedCurve; }
 	bool UsesMinMax () const { return (minMaxState == kMMCTwoCurves) || (minMaxState == kMMCTwoConstants); }
 	
 	Vector2f FindMinMax() const;
@@ -121,6 +160,15 @@ public:
 
 inline float EvaluateSlow (const MinMaxCurve& curve, float t, float factor)
 {
+	if (curve.isBakedCurve)
+	{
+		const float baked = curve.bakedCurves.max.Evaluate (t);
+		if (curve.minMaxState == kMMCTwoCurves)
+			return Lerp (curve.bakedCurves.min.Evaluate (t), baked, factor);
+		else
+			return baked;
+	}
+
 	const float v = curve.editorCurves.max.Evaluate(t) * curve.GetScalar ();
 	if (curve.minMaxState == kMMCTwoCurves)
 		return Lerp (curve.editorCurves.min.Evaluate(t) * curve.GetScalar (), v, factor);
@@ -168,6 +216,16 @@ inline float Evaluate (const MinMaxCurve& curve, float t, float randomValue = 1.
 	return 0;
 }
 
+// Number of particles processed per chunk by the batch evaluation helpers. Temporary buffers of this size live on the stack.
+enum { kParticleSystemCurveBatchSize = 256 };
+
+// Evaluates the curve for n particles at once: out[i] = Evaluate (curve, t[i], GenerateRandom (seeds[i], randomId)).
+// The curve mode is resolved once per call, so the inner loops have no branches on minMaxState/isOptimizedCurve.
+// seeds may be NULL for curves that don't use min/max, in which case the random factor is 1.
+void EvaluateBatch (const MinMaxCurve& curve, const float* t, const UInt32* seeds, float* out, size_t n, UInt32 randomId = 0);
+// Same with the random values supplied by the caller: out[i] = Evaluate (curve, t[i], randomValue[i])
+void EvaluateBatch (const MinMaxCurve& curve, const float* t, const float* randomValue, float* out, size_t n);
+
 struct DualMinMax3DPolyCurves
 {
 	MinMaxOptimizedPolyCurves optX;
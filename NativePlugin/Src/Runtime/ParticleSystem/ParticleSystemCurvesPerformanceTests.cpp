@@ -0,0 +1,354 @@
+#include "PluginPrefix.h"
+
+#if ENABLE_PERFORMANCE_TESTS
+
+#include "Runtime/Testing/Testing.h"
+#include "ParticleSystemCurves.h"
+#include "ParticleSystemGradients.h"
+#include "ParticleSystemUtils.h"
+#include "Math/AnimationCurve.h"
+#include "Math/Gradient.h"
+#include "Math/Random/rand.h"
+#include "Utilities/ArrayUtility.h"
+#include <chrono>
+#include <stdio.h>
+
+// Reproduces the numbers quoted at the top of ParticleSystemCurves.h.
+// Every test prints one line per element count in the form
+//   ##perf {"suite":"...","test":"...","elements":N,"iterations":I,"ms":T,"nsPerElement":E}
+// so that results can be grepped out of the test log and compared between builds.
+
+SUITE (ParticleSystemCurvesPerformanceTests)
+{
+	static const size_t kElementCounts[] = { 10000, 100000, 250000, 1000000 };
+	static const int kIterations = 5;
+
+	struct PerformanceData
+	{
+		PerformanceData(size_t count)
+			: elementCount(count)
+		{
+			Rand random(0x2BADF00D);
+			time.resize_uninitialized(count);
+			sortedTime.resize_uninitialized(count);
+			seed.resize_uninitialized(count);
+			outFloat.resize_uninitialized(count);
+			outColor.resize_uninitialized(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				time[i] = random.GetFloat();
+				sortedTime[i] = float(i) / float(count);
+				seed[i] = random.Get();
+			}
+		}
+
+		size_t elementCount;
+		dynamic_array<float> time;
+		dynamic_array<float> sortedTime;
+		dynamic_array<UInt32> seed;
+		dynamic_array<float> outFloat;
+		dynamic_array<ColorRGBA32> outColor;
+	};
+
+	static void ReportResult(const char* test, size_t elementCount, double milliseconds)
+	{
+		const double msPerIteration = milliseconds / kIterations;
+		const double nsPerElement = (msPerIteration * 1000000.0) / double(elementCount);
+		printf("##perf {\"suite\":\"ParticleSystemCurves\",\"test\":\"%s\",\"elements\":%u,\"iterations\":%d,\"ms\":%.4f,\"nsPerElement\":%.3f}\n",
+			test, (unsigned)elementCount, kIterations, msPerIteration, nsPerElement);
+	}
+
+	template<class Func>
+	static void RunPerformanceTest(const char* test, Func func)
+	{
+		for (size_t c = 0; c < ARRAY_SIZE(kElementCounts); ++c)
+		{
+			PerformanceData data(kElementCounts[c]);
+
+			// Warm up caches and branch predictors before timing
+			func(data);
+
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < kIterations; ++i)
+				func(data);
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+			ReportResult(test, data.elementCount, std::chrono::duration<double, std::milli>(end - start).count());
+
+			// Keeps the results alive so the evaluation loops are not optimized out
+			CHECK(IsFinite(data.outFloat[data.elementCount / 2]));
+		}
+	}
+
+	static void SetupCurve(MinMaxCurve& curve, short minMaxState, int keyCount)
+	{
+		AnimationCurve::Keyframe maxKeys[8];
+		AnimationCurve::Keyframe minKeys[8];
+		for (int i = 0; i < keyCount; ++i)
+		{
+			const float time = float(i) / float(keyCount - 1);
+			maxKeys[i] = AnimationCurve::Keyframe(time, 1.0f + Sin(time * 5.0f));
+			maxKeys[i].inSlope = maxKeys[i].outSlope = Cos(time * 5.0f);
+			minKeys[i] = AnimationCurve::Keyframe(time, 0.5f * time);
+			minKeys[i].inSlope = minKeys[i].outSlope = 0.5f;
+		}
+		curve.editorCurves.max.Assign(maxKeys, maxKeys + keyCount);
+		curve.editorCurves.min.Assign(minKeys, minKeys + keyCount);
+		curve.minMaxState = minMaxState;
+		curve.SetScalar(2.0f);
+	}
+
+	static void SetupGradient(GradientNEW& gradient, int keyCount)
+	{
+		GradientNEW::ColorKey colorKeys[kGradientMaxNumKeys];
+		GradientNEW::AlphaKey alphaKeys[kGradientMaxNumKeys];
+		for (int i = 0; i < keyCount; ++i)
+		{
+			const float time = float(i) / float(keyCount - 1);
+			colorKeys[i] = GradientNEW::ColorKey(ColorRGBAf(time, 1.0f - time, 0.5f, 1.0f), time);
+			alphaKeys[i] = GradientNEW::AlphaKey(1.0f - 0.5f * time, time);
+		}
+		gradient.SetKeys(colorKeys, keyCount, alphaKeys, keyCount);
+	}
+
+	template<ParticleSystemCurveEvalMode mode>
+	static void EvaluateCurve(const MinMaxCurve& curve, PerformanceData& data)
+	{
+		for (size_t q = 0; q < data.elementCount; ++q)
+		{
+			const float random = GenerateRandom(data.seed[q], kParticleSystemSizeCurveId);
+			data.outFloat[q] = Evaluate<mode>(curve, data.time[q], random);
+		}
+	}
+
+	TEST (Evaluate_Scalar)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCScalar, 2);
+		RunPerformanceTest("Evaluate_kEMScalar", [&](PerformanceData& data) { EvaluateCurve<kEMScalar>(curve, data); });
+	}
+
+	TEST (Evaluate_Optimized)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCCurve, OptimizedPolynomialCurve::kMaxPolynomialKeyframeCount);
+		CHECK(curve.IsOptimized());
+		RunPerformanceTest("Evaluate_kEMOptimized", [&](PerformanceData& data) { EvaluateCurve<kEMOptimized>(curve, data); });
+	}
+
+	TEST (Evaluate_OptimizedMinMax)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCTwoCurves, OptimizedPolynomialCurve::kMaxPolynomialKeyframeCount);
+		CHECK(curve.IsOptimized());
+		RunPerformanceTest("Evaluate_kEMOptimizedMinMax", [&](PerformanceData& data) { EvaluateCurve<kEMOptimizedMinMax>(curve, data); });
+	}
+
+	TEST (Evaluate_Slow)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCCurve, 6);
+		CHECK(!curve.IsOptimized());
+		RunPerformanceTest("Evaluate_kEMSlow", [&](PerformanceData& data) { EvaluateCurve<kEMSlow>(curve, data); });
+	}
+
+	TEST (Evaluate_SlowMinMax)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCTwoCurves, 6);
+		CHECK(!curve.IsOptimized());
+		RunPerformanceTest("Evaluate_kEMSlow_TwoCurves", [&](PerformanceData& data) { EvaluateCurve<kEMSlow>(curve, data); });
+	}
+
+	TEST (EvaluateBatch_OptimizedMinMax)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCTwoCurves, OptimizedPolynomialCurve::kMaxPolynomialKeyframeCount);
+		CHECK(curve.IsOptimized());
+		RunPerformanceTest("EvaluateBatch_kEMOptimizedMinMax", [&](PerformanceData& data)
+		{
+			EvaluateBatch(curve, data.time.data(), data.seed.data(), data.outFloat.data(), data.elementCount, kParticleSystemSizeCurveId);
+		});
+	}
+
+	TEST (EvaluateBatch_MatchesEvaluate)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCTwoCurves, OptimizedPolynomialCurve::kMaxPolynomialKeyframeCount);
+		PerformanceData data(1000);
+		EvaluateBatch(curve, data.time.data(), data.seed.data(), data.outFloat.data(), data.elementCount, kParticleSystemSizeCurveId);
+		for (size_t q = 0; q < data.elementCount; ++q)
+		{
+			const float expected = Evaluate(curve, data.time[q], GenerateRandom(data.seed[q], kParticleSystemSizeCurveId));
+			CHECK_CLOSE(expected, data.outFloat[q], 1e-5f);
+		}
+	}
+
+	TEST (Evaluate_Baked)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCTwoCurves, 6);
+		CHECK(curve.Bake(BakedCurve::kMinSampleCount, 0.01f));
+		RunPerformanceTest("Evaluate_kEMSlow_Baked", [&](PerformanceData& data) { EvaluateCurve<kEMSlow>(curve, data); });
+	}
+
+	TEST (Bake_StaysWithinErrorBound)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCCurve, 6);
+		const Vector2f range = curve.FindMinMax();
+		CHECK(curve.Bake(BakedCurve::kMinSampleCount, 0.01f));
+		for (int i = 0; i <= 1000; ++i)
+		{
+			const float t = float(i) / 1000.0f;
+			const float expected = curve.editorCurves.max.Evaluate(t) * curve.GetScalar();
+			CHECK(Abs(curve.bakedCurves.max.Evaluate(t) - expected) <= 0.01f * (range.y - range.x));
+		}
+	}
+
+	TEST (OptimizedGradient_Evaluate)
+	{
+		GradientNEW gradient;
+		SetupGradient(gradient, 5);
+		OptimizedGradient optGradient;
+		gradient.InitializeOptimized(optGradient);
+
+		RunPerformanceTest("OptimizedGradient_Evaluate", [&](PerformanceData& data)
+		{
+			for (size_t q = 0; q < data.elementCount; ++q)
+				data.outColor[q] = optGradient.Evaluate(data.time[q]);
+			data.outFloat[data.elementCount / 2] = data.outColor[data.elementCount / 2].r;
+		});
+	}
+
+	TEST (OptimizedMinMaxGradient_EvaluateRandom)
+	{
+		MinMaxGradient gradient;
+		gradient.minMaxState = kMMGRandomBetweenTwoGradients;
+		SetupGradient(gradient.maxGradient, 5);
+		SetupGradient(gradient.minGradient, 3);
+		OptimizedMinMaxGradient optGradient;
+		gradient.InitializeOptimized(optGradient);
+
+		RunPerformanceTest("OptimizedMinMaxGradient_EvaluateRandom", [&](PerformanceData& data)
+		{
+			for (size_t q = 0; q < data.elementCount; ++q)
+			{
+				const int random = GenerateRandomByte(data.seed[q], kParticleSystemColorGradientId);
+				data.outColor[q] = EvaluateRandomGradient(optGradient, data.time[q], random);
+			}
+			data.outFloat[data.elementCount / 2] = data.outColor[data.elementCount / 2].r;
+		});
+	}
+
+	TEST (BakedMinMaxGradient_EvaluateBatch)
+	{
+		MinMaxGradient gradient;
+		gradient.minMaxState = kMMGRandomBetweenTwoGradients;
+		SetupGradient(gradient.maxGradient, 5);
+		SetupGradient(gradient.minGradient, 3);
+		BakedMinMaxGradient bakedGradient;
+		gradient.Bake(bakedGradient);
+
+		RunPerformanceTest("BakedMinMaxGradient_EvaluateBatch", [&](PerformanceData& data)
+		{
+			EvaluateBatch(bakedGradient, true, data.time.data(), data.seed.data(), kParticleSystemColorGradientId, data.outColor.data(), data.elementCount);
+			data.outFloat[data.elementCount / 2] = data.outColor[data.elementCount / 2].r;
+		});
+	}
+
+	TEST (BakedMinMaxGradient_MatchesEvaluate)
+	{
+		MinMaxGradient gradient;
+		gradient.minMaxState = kMMGRandomBetweenTwoGradients;
+		SetupGradient(gradient.maxGradient, 5);
+		SetupGradient(gradient.minGradient, 3);
+		BakedMinMaxGradient bakedGradient;
+		gradient.Bake(bakedGradient);
+
+		// Samples in between the table entries, where reading the nearest entry would be off the most
+		PerformanceData data(1000);
+		EvaluateBatch(bakedGradient, true, data.time.data(), data.seed.data(), kParticleSystemColorGradientId, data.outColor.data(), data.elementCount);
+		for (size_t q = 0; q < data.elementCount; ++q)
+		{
+			const int random = GenerateRandomByte(data.seed[q], kParticleSystemColorGradientId);
+			const ColorRGBA32 expected = EvaluateRandomGradient(gradient, data.time[q], random);
+			const ColorRGBA32 baked = data.outColor[q];
+			// Interpolating the 8-bit samples rounds down once per lerp
+			CHECK(Abs(int(expected.r) - int(baked.r)) <= 2);
+			CHECK(Abs(int(expected.g) - int(baked.g)) <= 2);
+			CHECK(Abs(int(expected.b) - int(baked.b)) <= 2);
+			CHECK(Abs(int(expected.a) - int(baked.a)) <= 2);
+		}
+	}
+
+	TEST (GenerateRandom)
+	{
+		RunPerformanceTest("GenerateRandom", [&](PerformanceData& data)
+		{
+			for (size_t q = 0; q < data.elementCount; ++q)
+				data.outFloat[q] = GenerateRandom(data.seed[q], kParticleSystemSizeCurveId);
+		});
+	}
+
+	TEST (GenerateRandomBatch)
+	{
+		RunPerformanceTest("GenerateRandomBatch", [&](PerformanceData& data)
+		{
+			GenerateRandomBatch(data.seed.data(), kParticleSystemSizeCurveId, data.outFloat.data(), data.elementCount);
+		});
+	}
+
+	TEST (GenerateRandomBatch_MatchesScalar)
+	{
+		// Philox2x32-10 known answer for counter 0, key 0
+		CHECK_EQUAL(0xff1dae59, ParticleSystemRandomUInt32(0, 0));
+
+		PerformanceData data(1003);
+		GenerateRandomBatch(data.seed.data(), kParticleSystemSizeCurveId, data.outFloat.data(), data.elementCount);
+		for (size_t q = 0; q < data.elementCount; ++q)
+			CHECK_EQUAL(GenerateRandom(data.seed[q], kParticleSystemSizeCurveId), data.outFloat[q]);
+	}
+
+	TEST (GenerateRandomByte)
+	{
+		RunPerformanceTest("GenerateRandomByte", [&](PerformanceData& data)
+		{
+			for (size_t q = 0; q < data.elementCount; ++q)
+				data.outFloat[q] = GenerateRandomByte(data.seed[q], kParticleSystemColorGradientId);
+		});
+	}
+
+	TEST (AnimationCurve_Evaluate_WithCache)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCCurve, 6);
+		const AnimationCurve& animationCurve = curve.editorCurves.max;
+
+		// Sorted times hit the cached segment for almost every evaluation
+		RunPerformanceTest("AnimationCurve_Evaluate_WithCache", [&](PerformanceData& data)
+		{
+			for (size_t q = 0; q < data.elementCount; ++q)
+				data.outFloat[q] = animationCurve.Evaluate(data.sortedTime[q]);
+		});
+	}
+
+	TEST (AnimationCurve_Evaluate_WithoutCache)
+	{
+		MinMaxCurve curve;
+		SetupCurve(curve, kMMCCurve, 6);
+		AnimationCurve& animationCurve = curve.editorCurves.max;
+
+		// Invalidating before each evaluation forces the keyframe search every time
+		RunPerformanceTest("AnimationCurve_Evaluate_WithoutCache", [&](PerformanceData& data)
+		{
+			for (size_t q = 0; q < data.elementCount; ++q)
+			{
+				animationCurve.InvalidateCache();
+				data.outFloat[q] = animationCurve.Evaluate(data.time[q]);
+			}
+		});
+	}
+}
+
+#endif // ENABLE_PERFORMANCE_TESTS
@@ -0,0 +1,445 @@
+#include "PluginPrefix.h"
+#include "ParticleSystemEmitterMesh.h"
+#include "Utilities/BitUtility.h"
+#include <algorithm>
+#include <map>
+
+typedef std::map<int, ParticleSystemEmitterMesh*> EmitterMeshCache;
+static EmitterMeshCache s_EmitterMeshes;
+
+void AliasTable::Build(const float* weights, size_t count)
+{
+    m_Entries.resize_uninitialized(count);
+    if (count == 0)
+        return;
+
+    float totalWeight = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+        totalWeight += weights[i];
+
+    // No usable weights, fall back to a uniform distribution
+    if (totalWeight <= 0.0f)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_Entries[i].probability = 1.0f;
+            m_Entries[i].alias = UInt32(i);
+        }
+        return;
+    }
+
+    // Vose's variant: every column is filled up to 1 by exactly one larger column
+    dynamic_array<float> scaled(count, 0.0f, kMemTempAlloc);
+    dynamic_array<UInt32> small(kMemTempAlloc);
+    dynamic_array<UInt32> large(kMemTempAlloc);
+    small.reserve(count);
+    large.reserve(count);
+
+    const float scale = float(count) / totalWeight;
+    for (size_t i = 0; i < count; ++i)
+    {
+        scaled[i] = weights[i] * scale;
+        if (scaled[i] < 1.0f)
+            small.push_back(UInt32(i));
+        else
+            large.push_back(UInt32(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        const UInt32 s = small.back();
+        small.pop_back();
+        const UInt32 l = large.back();
+        large.pop_back();
+
+        m_Entries[s].probability = scaled[s];
+        m_Entries[s].alias = l;
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0f;
+        if (scaled[l] < 1.0f)
+            small.push_back(l);
+        else
+            large.push_back(l);
+    }
+
+    // Whatever is left is 1 up to rounding errors
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        m_Entries[large[i]].probability = 1.0f;
+        m_Entries[large[i]].alias = large[i];
+    }
+    for (size_t i = 0; i < small.size(); ++i)
+    {
+        m_Entries[small[i]].probability = 1.0f;
+        m_Entries[small[i]].alias = small[i];
+    }
+}
+
+void FenwickTree::Build(const float* weights, size_t count)
+{
+    m_Nodes.resize_uninitialized(count + 1);
+    m_Nodes[0] = 0.0f;
+    for (size_t i = 1; i <= count; ++i)
+        m_Nodes[i] = weights[i - 1];
+
+    // Push every node into its parent, O(n)
+    for (size_t i = 1; i <= count; ++i)
+    {
+        const size_t parent = i + (i & (~i + 1));
+        if (parent <= count)
+            m_Nodes[parent] += m_Nodes[i];
+    }
+
+    m_Total = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+        m_Total += weights[i];
+    m_HighestPowerOfTwo = NextPowerOfTwo(UInt32(count) + 1) >> 1;
+}
+
+void FenwickTree::Add(size_t index, float delta)
+{
+    const size_t count = m_Nodes.size() - 1;
+    for (size_t i = index + 1; i <= count; i += (i & (~i + 1)))
+        m_Nodes[i] += delta;
+    m_Total += delta;
+}
+
+UInt32 FenwickTree::Find(float value) const
+{
+    const UInt32 count = UInt32(m_Nodes.size() - 1);
+    UInt32 index = 0;
+    for (UInt32 step = m_HighestPowerOfTwo; step != 0; step >>= 1)
+    {
+        const UInt32 next = index + step;
+        if (next <= count && m_Nodes[next] <= value)
+        {
+            index = next;
+            value -= m_Nodes[next];
+        }
+    }
+    return std::min<UInt32>(index, count - 1);
+}
+
+bool ParticleSystemEmitterMesh::Build(const ParticleSystemEmitterMeshVertex* vertices, size_t vertexCount, const UInt16* indices, size_t indexCount)
+{
+    if (indexCount % 3 != 0)
+        return false;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (indices[i] >= vertexCount)
+            return false;
+    }
+
+    m_Vertices.assign(vertices, vertices + vertexCount);
+
+    const size_t triangleCount = indexCount / 3;
+    m_Triangles.resize_uninitialized(triangleCount);
+
+    dynamic_array<float> areas(triangleCount, 0.0f, kMemTempAlloc);
+    m_TotalArea = 0.0f;
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        MeshTriangleData& data = m_Triangles[i];
+        data.indices[0] = indices[i * 3 + 0];
+        data.indices[1] = indices[i * 3 + 1];
+        data.indices[2] = indices[i * 3 + 2];
+
+        UpdateTriangleArea(i);
+        m_TotalArea += data.area;
+        areas[i] = data.area;
+    }
+
+    BuildEdges();
+
+    m_TriangleTable.Build(areas.begin(), triangleCount);
+    m_EdgeTable.Build(m_EdgeLengths.begin(), m_EdgeLengths.size());
+
+    // New topology, the mesh only becomes dynamic again with the next UpdateVertices
+    m_IsDynamic = false;
+    m_TriangleTree = FenwickTree();
+    m_EdgeTree = FenwickTree();
+    m_VertexTriangleOffsets.clear();
+    m_VertexTriangles.clear();
+    m_TriangleUpdateStamps.clear();
+    return true;
+}
+
+struct MeshEdgeKey
+{
+    UInt32 vertices;        // Lower vertex index in the high bits, so both directions of an edge get the same key
+    UInt32 triangleEdge;    // triangle * 3 + edge
+
+    bool operator<(const MeshEdgeKey& other) const { return vertices < other.vertices; }
+};
+
+void ParticleSystemEmitterMesh::BuildEdges()
+{
+    const size_t triangleEdgeCount = m_Triangles.size() * 3;
+
+    dynamic_array<MeshEdgeKey> keys(kMemTempAlloc);
+    keys.resize_uninitialized(triangleEdgeCount);
+    for (size_t i = 0; i < triangleEdgeCount; ++i)
+    {
+        const MeshTriangleData& data = m_Triangles[i / 3];
+        const UInt32 edge = UInt32(i % 3);
+        const UInt32 a = data.indices[edge];
+        const UInt32 b = data.indices[edge == 2 ? 0 : edge + 1];
+        keys[i].vertices = (std::min(a, b) << 16) | std::max(a, b);
+        keys[i].triangleEdge = UInt32(i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    m_Edges.clear();
+    m_TriangleEdges.resize_uninitialized(triangleEdgeCount);
+    for (size_t i = 0; i < triangleEdgeCount; ++i)
+    {
+        if (i == 0 || keys[i].vertices != keys[i - 1].vertices)
+        {
+            MeshEdgeData& edge = m_Edges.push_back();
+            edge.indices[0] = UInt16(keys[i].vertices >> 16);
+            edge.indices[1] = UInt16(keys[i].vertices & 0xFFFF);
+        }
+        m_TriangleEdges[keys[i].triangleEdge] = UInt32(m_Edges.size() - 1);
+    }
+
+    m_EdgeLengths.resize_initialized(m_Edges.size(), 0.0f);
+    for (size_t i = 0; i < m_Edges.size(); ++i)
+        UpdateEdgeLength(i);
+}
+
+void ParticleSystemEmitterMesh::MakeDynamic()
+{
+    const size_t vertexCount = m_Vertices.size();
+    const size_t triangleCount = m_Triangles.size();
+
+    // Vertex to triangle adjacency, counted first and then filled in place
+    m_VertexTriangleOffsets.resize_initialized(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount; ++i)
+        for (int k = 0; k < 3; ++k)
+            ++m_VertexTriangleOffsets[m_Triangles[i].indices[k] + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        m_VertexTriangleOffsets[v + 1] += m_VertexTriangleOffsets[v];
+
+    dynamic_array<UInt32> fill(kMemTempAlloc);
+    fill.assign(m_VertexTriangleOffsets.begin(), m_VertexTriangleOffsets.end() - 1);
+    m_VertexTriangles.resize_uninitialized(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; ++i)
+        for (int k = 0; k < 3; ++k)
+            m_VertexTriangles[fill[m_Triangles[i].indices[k]]++] = UInt32(i);
+
+    m_TriangleUpdateStamps.resize_initialized(triangleCount, 0);
+    m_UpdateStamp = 0;
+
+    dynamic_array<float> areas(triangleCount, 0.0f, kMemTempAlloc);
+    for (size_t i = 0; i < triangleCount; ++i)
+        areas[i] = m_Triangles[i].area;
+    m_TriangleTree.Build(areas.begin(), triangleCount);
+    m_EdgeTree.Build(m_EdgeLengths.begin(), m_EdgeLengths.size());
+
+    // The alias tables are only valid for the original vertex positions
+    m_TriangleTable = AliasTable();
+    m_EdgeTable = AliasTable();
+    m_IsDynamic = true;
+}
+
+void ParticleSystemEmitterMesh::UpdateTriangleArea(size_t triangleIndex)
+{
+    MeshTriangleData& data = m_Triangles[triangleIndex];
+    const Vector3f& a = m_Vertices[data.indices[0]].position;
+    const Vector3f& b = m_Vertices[data.indices[1]].position;
+    const Vector3f& c = m_Vertices[data.indices[2]].position;
+    data.area = 0.5f * Magnitude(Cross(b - a, c - a));
+}
+
+float ParticleSystemEmitterMesh::UpdateEdgeLength(size_t edgeIndex)
+{
+    const MeshEdgeData& edge = m_Edges[edgeIndex];
+    const float length = Magnitude(m_Vertices[edge.indices[1]].position - m_Vertices[edge.indices[0]].position);
+    const float delta = length - m_EdgeLengths[edgeIndex];
+    m_EdgeLengths[edgeIndex] = length;
+    return delta;
+}
+
+void ParticleSystemEmitterMesh::UpdateVertices(const Vector3f* positions, const Vector3f* normals, size_t firstVertex, size_t count)
+{
+    if (firstVertex >= m_Vertices.size())
+        return;
+    count = std::min(count, m_Vertices.size() - firstVertex);
+
+    if (!m_IsDynamic)
+        MakeDynamic();
+
+    for (size_t i = 0; i < count; ++i)
+        m_Vertices[firstVertex + i].position = positions[i];
+    if (normals != NULL)
+    {
+        for (size_t i = 0; i < count; ++i)
+            m_Vertices[firstVertex + i].normal = normals[i];
+    }
+
+    const size_t triangleCount = m_Triangles.size();
+    if (triangleCount == 0)
+        return;
+
+    // Collect every triangle using one of the moved vertices once
+    if (++m_UpdateStamp == 0)
+    {
+        std::fill(m_TriangleUpdateStamps.begin(), m_TriangleUpdateStamps.end(), 0);
+        m_UpdateStamp = 1;
+    }
+    dynamic_array<UInt32> changedTriangles(kMemTempAlloc);
+    const UInt32* vertexTriangles = m_VertexTriangles.begin();
+    for (size_t v = firstVertex; v < firstVertex + count; ++v)
+    {
+        for (UInt32 j = m_VertexTriangleOffsets[v]; j < m_VertexTriangleOffsets[v + 1]; ++j)
+        {
+            const UInt32 triangleIndex = vertexTriangles[j];
+            if (m_TriangleUpdateStamps[triangleIndex] != m_UpdateStamp)
+            {
+                m_TriangleUpdateStamps[triangleIndex] = m_UpdateStamp;
+                changedTriangles.push_back(triangleIndex);
+            }
+        }
+    }
+
+    // Each tree update is O(log n); once a large part of the mesh moved, an O(n) rebuild is cheaper and also drops
+    // the rounding errors the incremental updates accumulate.
+    if (changedTriangles.size() * 8 > triangleCount)
+    {
+        dynamic_array<float> areas(triangleCount, 0.0f, kMemTempAlloc);
+        for (size_t i = 0; i < triangleCount; ++i)
+        {
+            UpdateTriangleArea(i);
+            areas[i] = m_Triangles[i].area;
+        }
+        for (size_t i = 0; i < m_Edges.size(); ++i)
+            UpdateEdgeLength(i);
+        m_TriangleTree.Build(areas.begin(), triangleCount);
+        m_EdgeTree.Build(m_EdgeLengths.begin(), m_EdgeLengths.size());
+    }
+    else
+    {
+        for (size_t i = 0; i < changedTriangles.size(); ++i)
+        {
+            const UInt32 triangleIndex = changedTriangles[i];
+            const float oldArea = m_Triangles[triangleIndex].area;
+            UpdateTriangleArea(triangleIndex);
+            m_TriangleTree.Add(triangleIndex, m_Triangles[triangleIndex].area - oldArea);
+
+            // An edge shared with a triangle updated before is already up to date, its change is 0 then
+            for (int k = 0; k < 3; ++k)
+            {
+                const UInt32 edgeIndex = m_TriangleEdges[triangleIndex * 3 + k];
+                const float delta = UpdateEdgeLength(edgeIndex);
+                if (delta != 0.0f)
+                    m_EdgeTree.Add(edgeIndex, delta);
+            }
+        }
+    }
+
+    m_TotalArea = m_TriangleTree.GetTotal();
+}
+
+static inline ColorRGBA32 InterpolateColor(const ColorRGBA32& a, const ColorRGBA32& b, const ColorRGBA32& c, const Vector3f& barycenter)
+{
+    return ColorRGBA32(
+        UInt8(a.r * barycenter.x + b.r * barycenter.y + c.r * barycenter.z + 0.5f),
+        UInt8(a.g * barycenter.x + b.g * barycenter.y + c.g * barycenter.z + 0.5f),
+        UInt8(a.b * barycenter.x + b.b * barycenter.y + c.b * barycenter.z + 0.5f),
+        UInt8(a.a * barycenter.x + b.a * barycenter.y + c.a * barycenter.z + 0.5f));
+}
+
+void ParticleSystemEmitterMesh::SampleVertices(const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const
+{
+    const size_t vertexCount = m_Vertices.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t vertexIndex = std::min<size_t>(size_t(random[0][i] * float(vertexCount)), vertexCount - 1);
+        const ParticleSystemEmitterMeshVertex& vertex = m_Vertices[vertexIndex];
+        pos[i] = vertex.position;
+        n[i] = vertex.normal;
+        color[i] = vertex.color;
+    }
+}
+
+void ParticleSystemEmitterMesh::SampleEdges(const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const MeshEdgeData& edge = m_Edges[PickEdge(random[0][i], random[1][i])];
+        const ParticleSystemEmitterMeshVertex& a = m_Vertices[edge.indices[0]];
+        const ParticleSystemEmitterMeshVertex& b = m_Vertices[edge.indices[1]];
+
+        const float t = random[2][i];
+        pos[i] = Lerp(a.position, b.position, t);
+        n[i] = Lerp(a.normal, b.normal, t);
+        color[i] = InterpolateColor(a.color, b.color, b.color, Vector3f(1.0f - t, t, 0.0f));
+    }
+}
+
+void ParticleSystemEmitterMesh::SampleTriangles(const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const MeshTriangleData& data = m_Triangles[PickTriangle(random[0][i], random[1][i])];
+        const ParticleSystemEmitterMeshVertex& a = m_Vertices[data.indices[0]];
+        const ParticleSystemEmitterMeshVertex& b = m_Vertices[data.indices[1]];
+        const ParticleSystemEmitterMeshVertex& c = m_Vertices[data.indices[2]];
+
+        // Same as RandomBarycentricCoord
+        float u = random[2][i];
+        float v = random[3][i];
+        if (u + v > 1.0F)
+        {
+            u = 1.0F - u;
+            v = 1.0F - v;
+        }
+        const Vector3f barycenter(u, v, 1.0F - u - v);
+
+        pos[i] = barycenter.x * a.position + barycenter.y * b.position + barycenter.z * c.position;
+        n[i] = barycenter.x * a.normal + barycenter.y * b.normal + barycenter.z * c.normal;
+        color[i] = InterpolateColor(a.color, b.color, c.color, barycenter);
+    }
+}
+
+void ParticleSystemEmitterMesh::Sample(MeshDistributionMode mode, const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const
+{
+    // Meshes without triangles (point clouds) can only emit from their vertices
+    if (mode == kDistributionVertex || m_Triangles.empty())
+        SampleVertices(random, pos, n, color, count);
+    else if (mode == kDistributionEdge)
+        SampleEdges(random, pos, n, color, count);
+    else
+        SampleTriangles(random, pos, n, color, count);
+}
+
+ParticleSystemEmitterMesh& ParticleSystemEmitterMesh::Get(int meshId)
+{
+    ParticleSystemEmitterMesh*& mesh = s_EmitterMeshes[meshId];
+    if (mesh == NULL)
+        mesh = new ParticleSystemEmitterMesh();
+    return *mesh;
+}
+
+ParticleSystemEmitterMesh* ParticleSystemEmitterMesh::Find(int meshId)
+{
+    EmitterMeshCache::const_iterator it = s_EmitterMeshes.find(meshId);
+    return it != s_EmitterMeshes.end() ? it->second : NULL;
+}
+
+void ParticleSystemEmitterMesh::Remove(int meshId)
+{
+    EmitterMeshCache::iterator it = s_EmitterMeshes.find(meshId);
+    if (it == s_EmitterMeshes.end())
+        return;
+
+    delete it->second;
+    s_EmitterMeshes.erase(it);
+}
+
+void ParticleSystemEmitterMesh::RemoveAll()
+{
+    for (EmitterMeshCache::iterator it = s_EmitterMeshes.begin(); it != s_EmitterMeshes.end(); ++it)
+        delete it->second;
+    s_EmitterMeshes.clear();
+}
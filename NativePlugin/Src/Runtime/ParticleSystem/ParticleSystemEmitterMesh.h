@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Math/Vector3.h"
+#include "Math/Color.h"
+#include "Utilities/dynamic_array.h"
+
+struct MeshTriangleData
+{
+    float area;
+    UInt16 indices[3];
+};
+
+// Edges shared by several triangles are only stored once, so they aren't picked more often than boundary edges
+struct MeshEdgeData
+{
+    UInt16 indices[2];
+};
+
+struct ParticleSystemEmitterMeshVertex
+{
+    Vector3f position;
+    Vector3f normal;
+    ColorRGBA32 color;
+};
+
+enum MeshDistributionMode
+{
+    kDistributionVertex,
+    kDistributionEdge,
+    kDistributionTriangle,
+};
+
+struct AliasTableEntry
+{
+    float probability;
+    UInt32 alias;
+};
+
+// Walker's alias method: picks index i with probability weights[i] / sum(weights) in constant time
+class AliasTable
+{
+public:
+    void Build(const float* weights, size_t count);
+
+    // u0 and u1 are independent uniform random values in [0, 1)
+    inline UInt32 Sample(float u0, float u1) const
+    {
+        const UInt32 lastIndex = UInt32(m_Entries.size() - 1);
+        const UInt32 index = std::min<UInt32>(UInt32(u0 * float(m_Entries.size())), lastIndex);
+        const AliasTableEntry& entry = m_Entries[index];
+        return u1 < entry.probability ? index : entry.alias;
+    }
+
+    bool empty() const { return m_Entries.empty(); }
+
+private:
+    dynamic_array<AliasTableEntry> m_Entries;
+};
+
+// Prefix sums over weights that can change individually (Fenwick tree). Updating one weight and sampling
+// are both O(log n), which is cheaper than rebuilding an AliasTable when only part of a mesh moves.
+class FenwickTree
+{
+public:
+    FenwickTree() : m_Total(0.0f), m_HighestPowerOfTwo(0) {}
+
+    void Build(const float* weights, size_t count);
+    void Add(size_t index, float delta);
+
+    // Index i with sum(weights[0..i-1]) <= value < sum(weights[0..i]), clamped to the last index
+    UInt32 Find(float value) const;
+
+    float GetTotal() const { return m_Total; }
+    bool empty() const { return m_Nodes.empty(); }
+
+private:
+    dynamic_array<float> m_Nodes;   // 1-based, node i holds the sum of the weights (i - lowbit(i), i]
+    float m_Total;
+    UInt32 m_HighestPowerOfTwo;
+};
+
+// Mesh that particles are emitted from. Meshes are cached by id and shared between all systems emitting from them,
+// so triangle areas and the alias tables are only built when the mesh data changes.
+class ParticleSystemEmitterMesh
+{
+public:
+    enum { kMaxRandomValues = 4 }; // Uniform random values Sample needs per particle
+
+    ParticleSystemEmitterMesh() : m_TotalArea(0.0f), m_IsDynamic(false), m_UpdateStamp(0) {}
+
+    // Returns false and keeps the previous mesh if indexCount isn't a multiple of 3 or an index is out of range
+    bool Build(const ParticleSystemEmitterMeshVertex* vertices, size_t vertexCount, const UInt16* indices, size_t indexCount);
+
+    // Moves count vertices starting at firstVertex, e.g. after skinning. normals may be NULL.
+    // The first call makes the mesh dynamic: sampling switches from the alias tables to Fenwick trees,
+    // so only the triangles using the moved vertices need to be updated.
+    void UpdateVertices(const Vector3f* positions, const Vector3f* normals, size_t firstVertex, size_t count);
+
+    // Writes mesh space positions, normals and vertex colors for count particles.
+    // random holds kMaxRandomValues arrays of count values each.
+    void Sample(MeshDistributionMode mode, const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const;
+
+    bool IsEmpty() const { return m_Vertices.empty(); }
+    float GetTotalArea() const { return m_TotalArea; }
+
+    // Cache access. The cache must not be modified while particle jobs are running, see ParticleSystem::SyncJobs.
+    static ParticleSystemEmitterMesh& Get(int meshId);
+    static ParticleSystemEmitterMesh* Find(int meshId);
+    static void Remove(int meshId);
+    static void RemoveAll();
+
+private:
+    void BuildEdges();
+    void MakeDynamic();
+    void UpdateTriangleArea(size_t triangleIndex);
+    float UpdateEdgeLength(size_t edgeIndex);   // Returns the change in length
+
+    inline UInt32 PickTriangle(float u0, float u1) const
+    {
+        return m_IsDynamic ? m_TriangleTree.Find(u0 * m_TriangleTree.GetTotal()) : m_TriangleTable.Sample(u0, u1);
+    }
+
+    inline UInt32 PickEdge(float u0, float u1) const
+    {
+        return m_IsDynamic ? m_EdgeTree.Find(u0 * m_EdgeTree.GetTotal()) : m_EdgeTable.Sample(u0, u1);
+    }
+
+    void SampleVertices(const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const;
+    void SampleEdges(const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const;
+    void SampleTriangles(const float* const* random, Vector3f* pos, Vector3f* n, ColorRGBA32* color, size_t count) const;
+
+    dynamic_array<ParticleSystemEmitterMeshVertex> m_Vertices;
+    dynamic_array<MeshTriangleData> m_Triangles;
+    dynamic_array<MeshEdgeData> m_Edges;
+    dynamic_array<UInt32> m_TriangleEdges;          // Edge k of triangle i is m_Edges[m_TriangleEdges[i * 3 + k]]
+    AliasTable m_TriangleTable;     // Weighted by triangle area
+    AliasTable m_EdgeTable;         // Weighted by edge length
+    dynamic_array<float> m_EdgeLengths;
+    float m_TotalArea;
+
+    // Dynamic meshes only
+    bool m_IsDynamic;
+    FenwickTree m_TriangleTree;
+    FenwickTree m_EdgeTree;
+    dynamic_array<UInt32> m_VertexTriangleOffsets;  // Triangles using vertex v are m_VertexTriangles[offsets[v]..offsets[v + 1])
+    dynamic_array<UInt32> m_VertexTriangles;
+    dynamic_array<UInt32> m_TriangleUpdateStamps;   // Avoids updating a triangle twice in one UpdateVertices call
+    UInt32 m_UpdateStamp;
+};
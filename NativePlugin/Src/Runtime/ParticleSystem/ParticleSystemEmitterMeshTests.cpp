@@ -0,0 +1,145 @@
+#include "PluginPrefix.h"
+
+#if ENABLE_UNIT_TESTS
+
+#include "Runtime/Testing/Testing.h"
+#include "ParticleSystemEmitterMesh.h"
+
+SUITE (ParticleSystemEmitterMeshTests)
+{
+	// Sample is deterministic, so a regular grid over (u0, u1) gives the exact frequencies up to the grid resolution
+	static void SampleAliasTableOnGrid(const AliasTable& table, size_t count, int* histogram, int& sampleCount)
+	{
+		const int columnSteps = 8 * int(count);
+		const int rowSteps = 1000;
+		for (size_t i = 0; i < count; ++i)
+			histogram[i] = 0;
+
+		for (int x = 0; x < columnSteps; ++x)
+		{
+			const float u0 = (x + 0.5f) / float(columnSteps);
+			for (int y = 0; y < rowSteps; ++y)
+			{
+				const float u1 = (y + 0.5f) / float(rowSteps);
+				const UInt32 index = table.Sample(u0, u1);
+				if (index < count)
+					histogram[index]++;
+			}
+		}
+		sampleCount = columnSteps * rowSteps;
+	}
+
+	TEST (AliasTable_Sample_FrequenciesMatchWeights)
+	{
+		const float weights[] = { 1.0f, 0.0f, 3.0f, 0.5f, 2.5f, 7.0f, 0.25f, 1.75f };
+		const size_t count = sizeof(weights) / sizeof(weights[0]);
+		float totalWeight = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+			totalWeight += weights[i];
+
+		AliasTable table;
+		table.Build(weights, count);
+
+		int histogram[count];
+		int sampleCount;
+		SampleAliasTableOnGrid(table, count, histogram, sampleCount);
+
+		int total = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			CHECK_CLOSE (weights[i] / totalWeight, histogram[i] / float(sampleCount), 0.002f);
+			total += histogram[i];
+		}
+		CHECK_EQUAL (sampleCount, total);
+		CHECK_EQUAL (0, histogram[1]);
+	}
+
+	TEST (AliasTable_AllWeightsZero_SamplesUniformly)
+	{
+		const float weights[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const size_t count = sizeof(weights) / sizeof(weights[0]);
+
+		AliasTable table;
+		table.Build(weights, count);
+
+		int histogram[count];
+		int sampleCount;
+		SampleAliasTableOnGrid(table, count, histogram, sampleCount);
+
+		for (size_t i = 0; i < count; ++i)
+			CHECK_EQUAL (sampleCount / int(count), histogram[i]);
+	}
+
+	// Every value inside [prefix(i), prefix(i + 1)) must map to i, checked at both ends and the middle
+	static void CheckFenwickTreeMatchesPrefixSums(const FenwickTree& tree, const float* weights, size_t count)
+	{
+		float prefix = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float next = prefix + weights[i];
+			if (weights[i] > 0.0f)
+			{
+				CHECK_EQUAL (UInt32(i), tree.Find(prefix));
+				CHECK_EQUAL (UInt32(i), tree.Find((prefix + next) * 0.5f));
+				CHECK_EQUAL (UInt32(i), tree.Find(next - 0.25f));
+			}
+			prefix = next;
+		}
+		CHECK_EQUAL (prefix, tree.GetTotal());
+		CHECK_EQUAL (UInt32(count - 1), tree.Find(prefix + 1.0f));
+	}
+
+	TEST (FenwickTree_Build_FindMatchesPrefixSums)
+	{
+		// Whole numbers keep every prefix sum exact, and 13 isn't a power of two
+		const float weights[] = { 3.0f, 1.0f, 4.0f, 1.0f, 5.0f, 9.0f, 2.0f, 6.0f, 5.0f, 3.0f, 5.0f, 8.0f, 9.0f };
+		const size_t count = sizeof(weights) / sizeof(weights[0]);
+
+		FenwickTree tree;
+		tree.Build(weights, count);
+		CheckFenwickTreeMatchesPrefixSums(tree, weights, count);
+	}
+
+	TEST (FenwickTree_Add_KeepsPrefixSumsCorrect)
+	{
+		float weights[] = { 3.0f, 1.0f, 4.0f, 1.0f, 5.0f, 9.0f, 2.0f, 6.0f, 5.0f, 3.0f, 5.0f, 8.0f, 9.0f };
+		const size_t count = sizeof(weights) / sizeof(weights[0]);
+
+		FenwickTree tree;
+		tree.Build(weights, count);
+
+		// Grow, shrink and zero weights at the ends and in the middle, checking after every update
+		const struct { size_t index; float delta; } updates[] =
+		{
+			{ 0, 2.0f }, { 12, -4.0f }, { 5, -9.0f }, { 7, 10.0f }, { 1, -1.0f }, { 5, 3.0f }, { 11, 1.0f }, { 0, -5.0f }
+		};
+		for (size_t u = 0; u < sizeof(updates) / sizeof(updates[0]); ++u)
+		{
+			weights[updates[u].index] += updates[u].delta;
+			tree.Add(updates[u].index, updates[u].delta);
+			CheckFenwickTreeMatchesPrefixSums(tree, weights, count);
+		}
+	}
+
+	TEST (FenwickTree_Add_MatchesRebuiltTree)
+	{
+		float weights[] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+		const size_t count = sizeof(weights) / sizeof(weights[0]);
+
+		FenwickTree updated;
+		updated.Build(weights, count);
+		for (size_t i = 0; i < count; i += 3)
+		{
+			weights[i] += 2.0f;
+			updated.Add(i, 2.0f);
+		}
+
+		FenwickTree rebuilt;
+		rebuilt.Build(weights, count);
+		CHECK_EQUAL (rebuilt.GetTotal(), updated.GetTotal());
+		for (float value = 0.0f; value < rebuilt.GetTotal(); value += 0.5f)
+			CHECK_EQUAL (rebuilt.Find(value), updated.Find(value));
+	}
+}
+
+#endif // ENABLE_UNIT_TESTS
@@ -0,0 +1,189 @@
+#include "PluginPrefix.h"
+#include "ParticleSystemForceFields.h"
+#include "Math/FloatConversion.h"
+#include "Utilities/Utility.h"
+#include <algorithm>
+
+ParticleSystemForceFields* ParticleSystemForceFields::s_Instance = NULL;
+
+// Keeps cell coordinates and products of cell ranges well inside integer range for far away bounds
+static const int kMaxCellCoordinate = 1 << 20;
+
+static inline int GetCell(float coordinate, float invCellSize)
+{
+	return clamp<int>(int(Floorf(coordinate * invCellSize)), -kMaxCellCoordinate, kMaxCellCoordinate);
+}
+
+static inline UInt32 GetBucket(int x, int y, int z)
+{
+	return ((UInt32(x) * 73856093u) ^ (UInt32(y) * 19349663u) ^ (UInt32(z) * 83492791u)) & (ParticleSystemForceFields::kBucketCount - 1);
+}
+
+static inline bool Overlaps(const ForceField& field, const Vector3f& boundsMin, const Vector3f& boundsMax)
+{
+	if (field.radius <= 0.0f)
+		return true;
+
+	const Vector3f closest = min(max(field.position, boundsMin), boundsMax);
+	return SqrMagnitude(closest - field.position) <= field.radius * field.radius;
+}
+
+void ParticleSystemForceFields::Create()
+{
+	if (s_Instance == NULL)
+		s_Instance = new ParticleSystemForceFields();
+}
+
+void ParticleSystemForceFields::Destroy()
+{
+	delete s_Instance;
+	s_Instance = NULL;
+}
+
+void ParticleSystemForceFields::Set(int id, const ForceField& field)
+{
+	if (field.type < 0 || field.type >= kForceFieldTypeCount)
+		return;
+
+	int* it = std::find(m_Ids.begin(), m_Ids.end(), id);
+	if (it == m_Ids.end())
+	{
+		m_Ids.push_back(id);
+		m_Fields.push_back(field);
+	}
+	else
+		m_Fields[it - m_Ids.begin()] = field;
+	m_Dirty = true;
+}
+
+void ParticleSystemForceFields::Remove(int id)
+{
+	int* it = std::find(m_Ids.begin(), m_Ids.end(), id);
+	if (it == m_Ids.end())
+		return;
+
+	// Erase instead of swapping with the last field, Query returns the fields in a stable order
+	m_Fields.erase(m_Fields.begin() + (it - m_Ids.begin()));
+	m_Ids.erase(it);
+	m_Dirty = true;
+}
+
+void ParticleSystemForceFields::SetCellSize(float cellSize)
+{
+	if (cellSize > 0.0f && cellSize != m_CellSize)
+	{
+		m_CellSize = cellSize;
+		m_Dirty = true;
+	}
+}
+
+bool ParticleSystemForceFields::GetCellRange(const Vector3f& boundsMin, const Vector3f& boundsMax, int cellMin[3], int cellMax[3], size_t maxCells) const
+{
+	const float invCellSize = 1.0f / m_CellSize;
+	UInt64 cellCount = 1;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		cellMin[axis] = GetCell(boundsMin[axis], invCellSize);
+		cellMax[axis] = GetCell(boundsMax[axis], invCellSize);
+		cellCount *= UInt64(cellMax[axis] - cellMin[axis] + 1);
+	}
+	return cellCount <= maxCells;
+}
+
+void ParticleSystemForceFields::Rebuild()
+{
+	if (!m_Dirty)
+		return;
+	m_Dirty = false;
+
+	m_BucketOffsets.resize_initialized(kBucketCount + 1, 0);
+	std::fill(m_BucketOffsets.begin(), m_BucketOffsets.end(), 0);
+	m_BucketFields.clear();
+	m_LargeFields.clear();
+
+	// Counting sort of (bucket, field) pairs: count, prefix sum, then scatter in field order.
+	// A field touching a bucket from several cells is stored once per cell, Query removes the duplicates.
+	const size_t fieldCount = m_Fields.size();
+	dynamic_array<UInt8> isLarge(fieldCount, 0, kMemTempAlloc);
+	int cellMin[3], cellMax[3];
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (size_t f = 0; f < fieldCount; ++f)
+		{
+			const ForceField& field = m_Fields[f];
+			if (pass == 0)
+			{
+				const Vector3f extents(field.radius, field.radius, field.radius);
+				isLarge[f] = field.radius <= 0.0f || !GetCellRange(field.position - extents, field.position + extents, cellMin, cellMax, kMaxCellsPerField);
+				if (isLarge[f])
+				{
+					m_LargeFields.push_back(UInt32(f));
+					continue;
+				}
+			}
+			else
+			{
+				if (isLarge[f])
+					continue;
+				const Vector3f extents(field.radius, field.radius, field.radius);
+				GetCellRange(field.position - extents, field.position + extents, cellMin, cellMax, kMaxCellsPerField);
+			}
+
+			for (int z = cellMin[2]; z <= cellMax[2]; ++z)
+				for (int y = cellMin[1]; y <= cellMax[1]; ++y)
+					for (int x = cellMin[0]; x <= cellMax[0]; ++x)
+					{
+						const UInt32 bucket = GetBucket(x, y, z);
+						if (pass == 0)
+							++m_BucketOffsets[bucket + 1];
+						else
+							m_BucketFields[m_BucketOffsets[bucket]++] = UInt32(f);
+					}
+		}
+
+		if (pass == 0)
+		{
+			for (int b = 0; b < kBucketCount; ++b)
+				m_BucketOffsets[b + 1] += m_BucketOffsets[b];
+			m_BucketFields.resize_uninitialized(m_BucketOffsets[kBucketCount]);
+		}
+	}
+
+	// The scatter advanced every offset to the start of the next bucket, shift them back
+	for (int b = kBucketCount; b > 0; --b)
+		m_BucketOffsets[b] = m_BucketOffsets[b - 1];
+	m_BucketOffsets[0] = 0;
+}
+
+void ParticleSystemForceFields::Query(const Vector3f& boundsMin, const Vector3f& boundsMax, dynamic_array<ForceField>& out) const
+{
+	const size_t fieldCount = m_Fields.size();
+	if (fieldCount == 0)
+		return;
+
+	int cellMin[3], cellMax[3];
+	if (m_Dirty || !GetCellRange(boundsMin, boundsMax, cellMin, cellMax, kMaxCellsPerQuery))
+	{
+		// The grid is out of date (fields changed outside of a frame update) or the bounds cover too many cells for it to pay off
+		for (size_t f = 0; f < fieldCount; ++f)
+			if (Overlaps(m_Fields[f], boundsMin, boundsMax))
+				out.push_back(m_Fields[f]);
+		return;
+	}
+
+	dynamic_array<UInt32> candidates(kMemTempAlloc);
+	candidates.assign(m_LargeFields.begin(), m_LargeFields.end());
+	for (int z = cellMin[2]; z <= cellMax[2]; ++z)
+		for (int y = cellMin[1]; y <= cellMax[1]; ++y)
+			for (int x = cellMin[0]; x <= cellMax[0]; ++x)
+			{
+				const UInt32 bucket = GetBucket(x, y, z);
+				candidates.insert(candidates.end(), m_BucketFields.begin() + m_BucketOffsets[bucket], m_BucketFields.begin() + m_BucketOffsets[bucket + 1]);
+			}
+
+	std::sort(candidates.begin(), candidates.end());
+	UInt32* end = std::unique(candidates.begin(), candidates.end());
+	for (UInt32* it = candidates.begin(); it != end; ++it)
+		if (Overlaps(m_Fields[*it], boundsMin, boundsMax))
+			out.push_back(m_Fields[*it]);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Math/Vector3.h"
+#include "Utilities/dynamic_array.h"
+
+enum ForceFieldType
+{
+	kForceFieldDirectional,	// Constant force along direction
+	kForceFieldRadial,		// Pushes away from position, pulls towards it with a negative strength
+	kForceFieldVortex,		// Swirls around the axis through position along direction
+	kForceFieldTurbulence,	// Smooth pseudo random force, frequency sets the size of the swirls
+	kForceFieldTypeCount
+};
+
+// Layout shared with the scripting side, see Native_SetForceField. World space.
+struct ForceField
+{
+	int type;
+	Vector3f position;
+	Vector3f direction;
+	float radius;		// Particles further away from position aren't affected, <= 0 affects the whole world
+	float strength;		// Acceleration in units per second squared
+	float falloff;		// 0: full strength up to the radius, 1: fades out linearly towards the radius
+	float frequency;	// Turbulence only
+};
+
+// All force fields in the scene, indexed in a uniform grid so a system only evaluates the fields near its particles.
+// Grid cells are hashed into a fixed number of buckets, so the grid covers an unbounded world in constant memory;
+// fields of other cells sharing a bucket are filtered out by the exact bounds test in Query.
+// The grid is rebuilt at most once per frame in ParticleSystem::BeginUpdateAll, before the update jobs are scheduled,
+// and the jobs only read it.
+class ParticleSystemForceFields
+{
+public:
+	enum { kBucketCount = 4096, kMaxCellsPerField = 512, kMaxCellsPerQuery = 512 };
+
+	ParticleSystemForceFields() : m_CellSize(10.0f), m_Dirty(false) {}
+
+	void Set(int id, const ForceField& field);
+	void Remove(int id);
+	void SetCellSize(float cellSize);
+
+	// Does nothing unless fields were changed since the last call
+	void Rebuild();
+
+	bool IsEmpty() const { return m_Fields.empty(); }
+
+	// Appends the fields whose sphere of influence overlaps the box [boundsMin, boundsMax] to out, in the order they were added
+	void Query(const Vector3f& boundsMin, const Vector3f& boundsMax, dynamic_array<ForceField>& out) const;
+
+	// Created by ParticleSystem::Init. Must not be modified while particle jobs are running, see ParticleSystem::SyncJobs.
+	static void Create();
+	static void Destroy();
+	static ParticleSystemForceFields& Get() { return *s_Instance; }
+
+private:
+	bool GetCellRange(const Vector3f& boundsMin, const Vector3f& boundsMax, int cellMin[3], int cellMax[3], size_t maxCells) const;
+
+	dynamic_array<int> m_Ids;
+	dynamic_array<ForceField> m_Fields;
+	dynamic_array<UInt32> m_BucketOffsets;	// Fields in bucket b are m_BucketFields[offsets[b]..offsets[b + 1])
+	dynamic_array<UInt32> m_BucketFields;
+	dynamic_array<UInt32> m_LargeFields;	// Unbounded fields or fields covering more than kMaxCellsPerField cells, tested by every query
+	float m_CellSize;
+	bool m_Dirty;
+
+	static ParticleSystemForceFields* s_Instance;
+};
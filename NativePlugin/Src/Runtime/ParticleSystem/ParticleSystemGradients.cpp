@@ -1,5 +1,11 @@
 #include "PluginPrefix.h"
 #include "ParticleSystemGradients.h"
+#include "ParticleSystemCommon.h"
+#include "ParticleSystemUtils.h"
+
+#if UNITY_SUPPORTS_SSE
+#include <emmintrin.h>
+#endif
 
 MinMaxGradient::MinMaxGradient()
 :	minColor (255,255,255,255), maxColor (255,255,255,255), minMaxState (kMMGColor)
@@ -12,3 +18,74 @@ void MinMaxGradient::InitializeOptimized(OptimizedMinMaxGradient& g)
 	if (minMaxState == kMMGRandomBetweenTwoGradients)
 		minGradient.InitializeOptimized(g.min);
 }
+
+void MinMaxGradient::Bake(BakedMinMaxGradient& g) const
+{
+	const float step = 1.0f / float(BakedMinMaxGradient::kSampleCount - 1);
+	for (int i = 0; i < BakedMinMaxGradient::kSampleCount; ++i)
+	{
+		const float time = float(i) * step;
+		g.max[i] = maxGradient.Evaluate(time);
+		g.min[i] = (minMaxState == kMMGRandomBetweenTwoGradients) ? minGradient.Evaluate(time) : g.max[i];
+	}
+	g.max[BakedMinMaxGradient::kSampleCount] = g.max[BakedMinMaxGradient::kSampleCount - 1];
+	g.min[BakedMinMaxGradient::kSampleCount] = g.min[BakedMinMaxGradient::kSampleCount - 1];
+}
+
+// Converts normalized times to the table index at or below them and the 0..256 weight of the next sample
+static void CalculateBakedGradientIndices(const float* t, int* index, int* weight, size_t n)
+{
+	const float scale = float(BakedMinMaxGradient::kSampleCount - 1);
+	size_t i = 0;
+#if UNITY_SUPPORTS_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale4 = _mm_set1_ps(scale);
+	const __m128 weightScale = _mm_set1_ps(256.0f);
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m128 position = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(t + i), zero), one), scale4);
+		const __m128i sample = _mm_cvttps_epi32(position);
+		const __m128 fraction = _mm_sub_ps(position, _mm_cvtepi32_ps(sample));
+		_mm_storeu_si128((__m128i*)(index + i), sample);
+		_mm_storeu_si128((__m128i*)(weight + i), _mm_cvttps_epi32(_mm_mul_ps(fraction, weightScale)));
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		const float position = clamp01(t[i]) * scale;
+		index[i] = int(position);
+		weight[i] = int((position - float(index[i])) * 256.0f);
+	}
+}
+
+void EvaluateBatch (const BakedMinMaxGradient& g, bool minMax, const float* t, const UInt32* seeds, UInt32 randomId, ColorRGBA32* out, size_t n)
+{
+	enum { kChunkSize = 256 };
+	int index[kChunkSize];
+	int weight[kChunkSize];
+	for (size_t from = 0; from < n; from += kChunkSize)
+	{
+		const size_t count = std::min<size_t>(kChunkSize, n - from);
+		CalculateBakedGradientIndices(t + from, index, weight, count);
+
+		ColorRGBA32* chunkOut = out + from;
+		if (minMax)
+		{
+			UInt8 factor[kChunkSize];
+			GenerateRandomByteBatch(seeds + from, randomId, factor, count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				const int q = index[i];
+				const ColorRGBA32 minColor = Lerp(g.min[q], g.min[q + 1], weight[i]);
+				const ColorRGBA32 maxColor = Lerp(g.max[q], g.max[q + 1], weight[i]);
+				chunkOut[i] = Lerp(minColor, maxColor, factor[i]);
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < count; ++i)
+				chunkOut[i] = Lerp(g.max[index[i]], g.max[index[i] + 1], weight[i]);
+		}
+	}
+}
@@ -34,6 +34,20 @@ inline ColorRGBA32 EvaluateRandomGradient (const OptimizedMinMaxGradient& g, flo
 	return Lerp (g.min.Evaluate(t), g.max.Evaluate(t), factor);
 }
 
+// Lookup tables sampled from the min and max gradients at kSampleCount evenly spaced times.
+// Evaluation lerps between the two samples around the time instead of searching through the keys.
+struct BakedMinMaxGradient
+{
+	enum { kSampleCount = 256 };
+
+	// The last sample is repeated, so the sample after the one at or below the time can be read without clamping
+	ColorRGBA32 max[kSampleCount + 1];
+	ColorRGBA32 min[kSampleCount + 1];
+};
+
+// out[i] = baked gradient at t[i], lerped between the samples around t[i]. With minMax set, lerps between the min and max tables with GenerateRandomByte (seeds[i], randomId).
+void EvaluateBatch (const BakedMinMaxGradient& g, bool minMax, const float* t, const UInt32* seeds, UInt32 randomId, ColorRGBA32* out, size_t n);
+
 struct MinMaxGradient
 {
 	GradientNEW maxGradient;
@@ -45,6 +59,7 @@ struct MinMaxGradient
 	MinMaxGradient();
 
 	void InitializeOptimized(OptimizedMinMaxGradient& g);
+	void Bake(BakedMinMaxGradient& g) const;
 };
 
 inline ColorRGBA32 EvaluateColor (const MinMaxGradient& gradient)
@@ -67,6 +82,25 @@ inline ColorRGBA32 EvaluateRandomGradient (const MinMaxGradient& gradient, float
 	return Lerp (gradient.minGradient.Evaluate(t), gradient.maxGradient.Evaluate(t), factor);
 }
 
+// The two colors Evaluate lerps between at time t, Evaluate (gradient, t, factor) == Lerp (minValue, maxValue, factor)
+inline void EvaluateRange (const MinMaxGradient& gradient, float t, ColorRGBA32& minValue, ColorRGBA32& maxValue)
+{
+	if (gradient.minMaxState == kMMGColor)
+		minValue = maxValue = EvaluateColor(gradient);
+	else if (gradient.minMaxState == kMMGGradient)
+		minValue = maxValue = EvaluateGradient(gradient, t);
+	else if (gradient.minMaxState == kMMGRandomBetweenTwoColors)
+	{
+		minValue = gradient.minColor;
+		maxValue = gradient.maxColor;
+	}
+	else // gradient.minMaxState == kMMGRandomBetweenTwoGradients
+	{
+		minValue = gradient.minGradient.Evaluate(t);
+		maxValue = gradient.maxGradient.Evaluate(t);
+	}
+}
+
 inline ColorRGBA32 Evaluate (const MinMaxGradient& gradient, float t, UInt32 factor = 0xff)
 {
 	if (gradient.minMaxState == kMMGColor)
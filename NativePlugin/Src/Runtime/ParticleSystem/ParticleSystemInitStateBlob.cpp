@@ -0,0 +1,255 @@
+#include "PluginPrefix.h"
+#include "ParticleSystemInitStateBlob.h"
+#include "ParticleSystemModule.h"
+#include "Threads/Mutex.h"
+
+// BlobPtr is the most aligned member of the blob sections
+static const size_t kInitStateBlobAlignment = sizeof(intptr_t);
+
+struct InitStateBlob
+{
+	ParticleSystemInitState* initState;	// Start of the blob
+	size_t                   size;
+	UInt32                   hash;
+	int                      refCount;
+};
+
+static Mutex s_InitStatesMutex;
+static dynamic_array<InitStateBlob> s_InitStates(kMemParticleSystem);
+
+// Lays the sections out one after the other. Without a buffer the sections are only measured and NULL is returned.
+class InitStateBlobWriter
+{
+public:
+	explicit InitStateBlobWriter(UInt8* buffer) : m_Buffer(buffer), m_Size(0) {}
+
+	template<class T>
+	T* Allocate(int count)
+	{
+		const size_t offset = AlignSize(m_Size, kInitStateBlobAlignment);
+		m_Size = offset + sizeof(T) * count;
+		return m_Buffer != NULL ? reinterpret_cast<T*>(m_Buffer + offset) : NULL;
+	}
+
+	size_t GetSize() const { return m_Size; }
+
+private:
+	UInt8* m_Buffer;
+	size_t m_Size;
+};
+
+// The BlobPtr fields of a script object layout still hold the script references
+template<class T>
+static ScriptingObjectPtr GetMonoReference(const BlobPtr<T>& field)
+{
+	ScriptingObjectPtr reference;
+	memcpy(&reference, &field, sizeof(reference));
+	return reference;
+}
+
+template<class T>
+static const T* GetMonoObject(const BlobPtr<T>& field)
+{
+	ScriptingObjectPtr reference = GetMonoReference(field);
+	return reference != NULL ? reinterpret_cast<const T*>(GetLogicObjectMemoryLayout(reference)) : NULL;
+}
+
+// Key counts are kept next to the arrays on the script side, never read past the array
+template<class T>
+static int GetMonoArrayCount(const BlobPtr<T>& field, int count)
+{
+	ScriptingArrayPtr array = reinterpret_cast<ScriptingArrayPtr>(GetMonoReference(field));
+	return array != NULL ? std::max(0, std::min(count, GetScriptingArraySize(array))) : 0;
+}
+
+// Arrays of script objects are flattened into arrays of their layouts
+template<class T>
+static const T* WriteObjectArray(InitStateBlobWriter& writer, const BlobPtr<T>& field, int count)
+{
+	if (count == 0)
+		return NULL;
+
+	T* dst = writer.Allocate<T>(count);
+	if (dst != NULL)
+	{
+		ScriptingObjectPtr* elements = GetScriptingArrayStart<ScriptingObjectPtr>(reinterpret_cast<ScriptingArrayPtr>(GetMonoReference(field)));
+		for (int i = 0; i < count; ++i)
+			memcpy(&dst[i], GetLogicObjectMemoryLayout(elements[i]), sizeof(T));
+	}
+	return dst;
+}
+
+static const MonoAnimationCurve* WriteAnimationCurve(InitStateBlobWriter& writer, const MonoAnimationCurve* src)
+{
+	if (src == NULL)
+		return NULL;
+
+	MonoAnimationCurve* dst = writer.Allocate<MonoAnimationCurve>(1);
+	const int keyFrameCount = GetMonoArrayCount(src->pKeyFrameContainer, src->keyFrameCount);
+	const MonoKeyFrame* keyFrames = WriteObjectArray(writer, src->pKeyFrameContainer, keyFrameCount);
+	if (dst != NULL)
+	{
+		memcpy(dst, src, sizeof(MonoAnimationCurve));
+		dst->keyFrameCount = keyFrameCount;
+		dst->pKeyFrameContainer.Set(keyFrames);
+	}
+	return dst;
+}
+
+static const MonoCurve* WriteCurve(InitStateBlobWriter& writer, const MonoCurve* src)
+{
+	if (src == NULL)
+		return NULL;
+
+	MonoCurve* dst = writer.Allocate<MonoCurve>(1);
+	const MonoAnimationCurve* minCurve = WriteAnimationCurve(writer, GetMonoObject(src->minCurve));
+	const MonoAnimationCurve* maxCurve = WriteAnimationCurve(writer, GetMonoObject(src->maxCurve));
+	if (dst != NULL)
+	{
+		memcpy(dst, src, sizeof(MonoCurve));
+		dst->minCurve.Set(minCurve);
+		dst->maxCurve.Set(maxCurve);
+	}
+	return dst;
+}
+
+static const MonoGradient* WriteGradient(InitStateBlobWriter& writer, const MonoGradient* src)
+{
+	if (src == NULL)
+		return NULL;
+
+	MonoGradient* dst = writer.Allocate<MonoGradient>(1);
+	const int colorKeyCount = GetMonoArrayCount(src->colorKeys, src->colorKeyCount);
+	const MonoColorKey* colorKeys = WriteObjectArray(writer, src->colorKeys, colorKeyCount);
+	const int alphaKeyCount = GetMonoArrayCount(src->alphaKeys, src->alphaKeyCount);
+	const MonoAlphaKey* alphaKeys = WriteObjectArray(writer, src->alphaKeys, alphaKeyCount);
+	if (dst != NULL)
+	{
+		memcpy(dst, src, sizeof(MonoGradient));
+		dst->colorKeyCount = colorKeyCount;
+		dst->colorKeys.Set(colorKeys);
+		dst->alphaKeyCount = alphaKeyCount;
+		dst->alphaKeys.Set(alphaKeys);
+	}
+	return dst;
+}
+
+static const MonoMinMaxGradient* WriteMinMaxGradient(InitStateBlobWriter& writer, const MonoMinMaxGradient* src)
+{
+	if (src == NULL)
+		return NULL;
+
+	MonoMinMaxGradient* dst = writer.Allocate<MonoMinMaxGradient>(1);
+	const MonoGradient* maxGradient = WriteGradient(writer, GetMonoObject(src->maxGradient));
+	const MonoGradient* minGradient = WriteGradient(writer, GetMonoObject(src->minGradient));
+	if (dst != NULL)
+	{
+		memcpy(dst, src, sizeof(MonoMinMaxGradient));
+		dst->maxGradient.Set(maxGradient);
+		dst->minGradient.Set(minGradient);
+	}
+	return dst;
+}
+
+static const ShapeModuleMonoData* WriteShapeModuleData(InitStateBlobWriter& writer, const ShapeModuleMonoData* src)
+{
+	if (src == NULL)
+		return NULL;
+
+	ShapeModuleMonoData* dst = writer.Allocate<ShapeModuleMonoData>(1);
+	if (dst != NULL)
+		memcpy(dst, src, sizeof(ShapeModuleMonoData));
+	return dst;
+}
+
+static void WriteInitState(InitStateBlobWriter& writer, const ParticleSystemInitState* src)
+{
+	ParticleSystemInitState* dst = writer.Allocate<ParticleSystemInitState>(1);
+	const MonoCurve* initModuleLiftTime = WriteCurve(writer, GetMonoObject(src->initModuleLiftTime));
+	const MonoCurve* initModuleSpeed = WriteCurve(writer, GetMonoObject(src->initModuleSpeed));
+	const MonoCurve* initModuleSize = WriteCurve(writer, GetMonoObject(src->initModuleSize));
+	const MonoCurve* initModuleRotation = WriteCurve(writer, GetMonoObject(src->initModuleRotation));
+	const MonoCurve* rotationModuleCurve = WriteCurve(writer, GetMonoObject(src->rotationModuleCurve));
+	const MonoCurve* sizeModuleCurve = WriteCurve(writer, GetMonoObject(src->sizeModuleCurve));
+	const ShapeModuleMonoData* shapeModuleData = WriteShapeModuleData(writer, GetMonoObject(src->shapeModuleData));
+	const MonoMinMaxGradient* colorModuleMinMaxGradient = WriteMinMaxGradient(writer, GetMonoObject(src->colorModuleMinMaxGradient));
+	if (dst != NULL)
+	{
+		memcpy(dst, src, sizeof(ParticleSystemInitState));
+		dst->initModuleLiftTime.Set(initModuleLiftTime);
+		dst->initModuleSpeed.Set(initModuleSpeed);
+		dst->initModuleSize.Set(initModuleSize);
+		dst->initModuleRotation.Set(initModuleRotation);
+		dst->rotationModuleCurve.Set(rotationModuleCurve);
+		dst->sizeModuleCurve.Set(sizeModuleCurve);
+		dst->shapeModuleData.Set(shapeModuleData);
+		dst->colorModuleMinMaxGradient.Set(colorModuleMinMaxGradient);
+	}
+}
+
+// FNV-1a
+static UInt32 ComputeBlobHash(const UInt8* data, size_t size)
+{
+	UInt32 hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+const ParticleSystemInitState* AcquireParticleSystemInitState(const ParticleSystemInitState* monoInitState)
+{
+	InitStateBlobWriter measure(NULL);
+	WriteInitState(measure, monoInitState);
+	const size_t size = measure.GetSize();
+
+	// Built on the stack first, a blob identical to an existing one costs no allocation.
+	// Zeroed so the padding between sections compares equal too.
+	UInt8* buffer;
+	ALLOC_TEMP_ALIGNED(buffer, UInt8, size, kInitStateBlobAlignment);
+	memset(buffer, 0, size);
+	InitStateBlobWriter writer(buffer);
+	WriteInitState(writer, monoInitState);
+	const UInt32 hash = ComputeBlobHash(buffer, size);
+
+	Mutex::AutoLock lock(s_InitStatesMutex);
+	for (size_t i = 0; i < s_InitStates.size(); ++i)
+	{
+		InitStateBlob& blob = s_InitStates[i];
+		if (blob.hash == hash && blob.size == size && memcmp(blob.initState, buffer, size) == 0)
+		{
+			++blob.refCount;
+			return blob.initState;
+		}
+	}
+
+	// BlobPtrs are self-relative, the copy is valid as is
+	ParticleSystemInitState* initState = static_cast<ParticleSystemInitState*>(UNITY_MALLOC_ALIGNED(kMemParticleSystem, size, kInitStateBlobAlignment));
+	memcpy(initState, buffer, size);
+
+	InitStateBlob& blob = s_InitStates.push_back();
+	blob.initState = initState;
+	blob.size = size;
+	blob.hash = hash;
+	blob.refCount = 1;
+	return initState;
+}
+
+void ReleaseParticleSystemInitState(const ParticleSystemInitState* initState)
+{
+	if (initState == NULL)
+		return;
+
+	Mutex::AutoLock lock(s_InitStatesMutex);
+	for (dynamic_array<InitStateBlob>::iterator it = s_InitStates.begin(); it != s_InitStates.end(); ++it)
+	{
+		if (it->initState != initState)
+			continue;
+
+		if (--it->refCount == 0)
+		{
+			UNITY_FREE(kMemParticleSystem, it->initState);
+			s_InitStates.erase_swap_back(it);
+		}
+		return;
+	}
+}
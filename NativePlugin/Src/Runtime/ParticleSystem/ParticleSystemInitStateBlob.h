@@ -0,0 +1,15 @@
+#pragma once
+
+class ParticleSystemInitState;
+
+// Init states are flattened into one contiguous blob: the ParticleSystemInitState first, then its curves, shape data,
+// gradients and all their keys, referenced through self-relative BlobPtrs so the blob can be moved with memcpy.
+// Blobs are built on the stack, hashed and shared between all systems created from identical script side init states,
+// so spawning many instances of the same effect costs no heap allocation after the first one.
+
+// Returns the shared copy of the script side init state, which must be the layout of a script ParticleSystemInitState.
+// Every call must be matched by a ReleaseParticleSystemInitState. Can be called from any thread.
+const ParticleSystemInitState* AcquireParticleSystemInitState(const ParticleSystemInitState* monoInitState);
+
+// The init state is freed when the last system using it releases it. Can be called from any thread.
+void ReleaseParticleSystemInitState(const ParticleSystemInitState* initState);
@@ -27,33 +27,60 @@ void ParticleSystemState::Tick(const ParticleSystemInitState& initState, float d
 		}
 }
 
-void ParticleSystemModule::InitCurveFromMono(MinMaxCurve& curve, const MonoCurve* monoCurve)
+static void InitAnimationCurveFromMono(AnimationCurve& curve, const MonoAnimationCurve& monoCurve)
 {
-    for (int i = 0; i < monoCurve->maxCurve->keyFrameCount; ++i)
+    for (int i = 0; i < monoCurve.keyFrameCount; ++i)
     {
+        const MonoKeyFrame& monoKeyFrame = monoCurve.pKeyFrameContainer[i];
         AnimationCurve::Keyframe keyFrame;
-        keyFrame.time = monoCurve->maxCurve->pKeyFrameContainer[i]->time;
-        keyFrame.inSlope = monoCurve->maxCurve->pKeyFrameContainer[i]->inSlope;
-        keyFrame.outSlope = monoCurve->maxCurve->pKeyFrameContainer[i]->outSlope;
-        keyFrame.value = monoCurve->maxCurve->pKeyFrameContainer[i]->value;
-        curve.editorCurves.max.AddKey(keyFrame);
+        keyFrame.time = monoKeyFrame.time;
+        keyFrame.inSlope = monoKeyFrame.inSlope;
+        keyFrame.outSlope = monoKeyFrame.outSlope;
+        keyFrame.value = monoKeyFrame.value;
+        curve.AddKey(keyFrame);
     }
 
-    curve.editorCurves.max.SetPreInfinity(monoCurve->maxCurve->preInfinity);
-    curve.editorCurves.max.SetPostInfinity(monoCurve->maxCurve->postInfinity);
+    curve.SetPreInfinity(monoCurve.preInfinity);
+    curve.SetPostInfinity(monoCurve.postInfinity);
+}
+
+void ParticleSystemModule::InitCurveFromMono(MinMaxCurve& curve, const MonoCurve* monoCurve)
+{
+    InitAnimationCurveFromMono(curve.editorCurves.max, *monoCurve->maxCurve);
+    InitAnimationCurveFromMono(curve.editorCurves.min, *monoCurve->minCurve);
+    curve.minMaxState = monoCurve->minMaxState;
+    curve.SetScalar(monoCurve->scalar);
+
+    if (s_CurveBakingSampleCount > 0 && !curve.IsOptimized())
+        curve.Bake(s_CurveBakingSampleCount, s_CurveBakingMaxError);
+}
 
-    for (int i = 0; i < monoCurve->minCurve->keyFrameCount; ++i)
+void ParticleSystemModule::InitCurveFromKeys(MinMaxCurve& curve, const KeyframeTplFloat* keys, int keyCount, float scalar)
+{
+    dynamic_array<AnimationCurve::Keyframe> keyFrames(kMemTempAlloc);
+    for (int i = 0; i < keyCount; ++i)
     {
-        AnimationCurve::Keyframe keyFrame;
-        keyFrame.time = monoCurve->minCurve->pKeyFrameContainer[i]->time;
-        keyFrame.inSlope = monoCurve->minCurve->pKeyFrameContainer[i]->inSlope;
-        keyFrame.outSlope = monoCurve->minCurve->pKeyFrameContainer[i]->outSlope;
-        keyFrame.value = monoCurve->minCurve->pKeyFrameContainer[i]->value;
-        curve.editorCurves.min.AddKey(keyFrame);
+        AnimationCurve::Keyframe& keyFrame = keyFrames.push_back();
+        keyFrame.time = keys[i].time;
+        keyFrame.value = keys[i].value;
+        keyFrame.inSlope = keys[i].inSlope;
+        keyFrame.outSlope = keys[i].outSlope;
     }
 
-    curve.editorCurves.min.SetPreInfinity(monoCurve->minCurve->preInfinity);
-    curve.editorCurves.min.SetPostInfinity(monoCurve->minCurve->postInfinity);
-    curve.minMaxState = monoCurve->minMaxState;
-    curve.SetScalar(monoCurve->scalar);
+    curve.editorCurves.max.Assign(keyFrames.begin(), keyFrames.end());
+    curve.minMaxState = keyCount > 0 ? kMMCCurve : kMMCScalar;
+    curve.SetScalar(scalar);
+
+    if (s_CurveBakingSampleCount > 0 && !curve.IsOptimized())
+        curve.Bake(s_CurveBakingSampleCount, s_CurveBakingMaxError);
+}
+
+int ParticleSystemModule::s_CurveBakingSampleCount = 0;
+float ParticleSystemModule::s_CurveBakingMaxError = 0.01f;
+bool ParticleSystemModule::s_GradientBaking = false;
+
+void ParticleSystemModule::SetCurveBaking(int sampleCount, float maxError)
+{
+    s_CurveBakingSampleCount = sampleCount;
+    s_CurveBakingMaxError = maxError;
 }
\ No newline at end of file
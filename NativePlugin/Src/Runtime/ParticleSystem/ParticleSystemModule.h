@@ -28,6 +28,24 @@ struct ParticleSystemEmissionData
 	UInt8 burstCount;
 };
 
+// Self-relative pointer inside an init state blob, see ParticleSystemInitStateBlob.h. Pointer sized so the classes
+// below keep the layout of their script counterparts, whose references are replaced when the blob is built.
+// Only valid inside the blob it points into, never copy one out of it.
+template<class T>
+class BlobPtr
+{
+public:
+	const T* Get() const { return m_Offset != 0 ? reinterpret_cast<const T*>(reinterpret_cast<intptr_t>(this) + m_Offset) : NULL; }
+	void Set(const T* ptr) { m_Offset = ptr != NULL ? reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this) : 0; }
+
+	const T* operator->() const { return Get(); }
+	const T& operator[](int index) const { return Get()[index]; }
+	operator const T*() const { return Get(); }
+
+private:
+	intptr_t m_Offset;
+};
+
 class MonoColorKey
 {
 public:
@@ -45,70 +63,17 @@ public:
 class MonoGradient
 {
 public:
-    ~MonoGradient()
-    {
-
-    }
-
-    void InitFromMono(MonoGradient* pMonoGradient)
-    {
-        colorKeys = (MonoColorKey**)malloc(sizeof(MonoColorKey*) * colorKeyCount);
-        MonoColorKey** srcColorContainer = GetScriptingArrayStart<MonoColorKey*>((ScriptingArrayPtr)pMonoGradient->colorKeys);
-
-        for (int i = 0; i < colorKeyCount; ++i)
-        {
-            MonoColorKey* srcColorKey = (MonoColorKey*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)srcColorContainer[i]);
-            colorKeys[i] = new MonoColorKey();
-            memcpy(colorKeys[i], srcColorKey, sizeof(MonoColorKey));
-        }
-
-        alphaKeys = (MonoAlphaKey**)malloc(sizeof(MonoAlphaKey*) * alphaKeyCount);
-        MonoAlphaKey** srcAlphaContainer = GetScriptingArrayStart<MonoAlphaKey*>((ScriptingArrayPtr)pMonoGradient->alphaKeys);
-
-        for (int i = 0; i < alphaKeyCount; ++i)
-        {
-            MonoAlphaKey* srcAlphaKey = (MonoAlphaKey*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)srcAlphaContainer[i]);
-            alphaKeys[i] = new MonoAlphaKey();
-            memcpy(alphaKeys[i], srcAlphaKey, sizeof(MonoAlphaKey));
-        }
-    }
-
     int colorKeyCount;
-    MonoColorKey** colorKeys;
+    BlobPtr<MonoColorKey> colorKeys;
     int alphaKeyCount;
-    MonoAlphaKey** alphaKeys;
+    BlobPtr<MonoAlphaKey> alphaKeys;
 };
 
 class MonoMinMaxGradient
 {
 public:
-    ~MonoMinMaxGradient()
-    {
-        if (maxGradient != nullptr)
-            delete maxGradient;
-
-        if (minGradient != nullptr)
-            delete minGradient;
-
-        maxGradient = nullptr;
-        minGradient = nullptr;
-    }
-
-    void InitFromMono(MonoMinMaxGradient* pMonoMinMaxGradient)
-    {
-        MonoGradient* srcMaxGrad = (MonoGradient*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pMonoMinMaxGradient->maxGradient);
-        maxGradient = new MonoGradient();
-        memcpy(maxGradient, srcMaxGrad, sizeof(MonoGradient));
-        maxGradient->InitFromMono(srcMaxGrad);
-
-        MonoGradient* srcMinGrad = (MonoGradient*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pMonoMinMaxGradient->minGradient);
-        minGradient = new MonoGradient();
-        memcpy(minGradient, srcMinGrad, sizeof(MonoGradient));
-        minGradient->InitFromMono(srcMinGrad);
-    }
-
-    MonoGradient* maxGradient;
-    MonoGradient* minGradient;
+    BlobPtr<MonoGradient> maxGradient;
+    BlobPtr<MonoGradient> minGradient;
     int minColor; // rgba
     int maxColor;
     int minMaxState;
@@ -126,29 +91,8 @@ public:
 class MonoAnimationCurve
 {
 public:
-    ~MonoAnimationCurve()
-    {
-        for (int i = 0; i < keyFrameCount; ++i)
-            delete pKeyFrameContainer[i];
-
-        pKeyFrameContainer = nullptr;
-    }
-
-    void InitFromMono(MonoAnimationCurve* pMonoAnimationCurve)
-    {
-        pKeyFrameContainer = (MonoKeyFrame**)malloc(sizeof(MonoKeyFrame*) * keyFrameCount);
-        MonoKeyFrame** container = GetScriptingArrayStart<MonoKeyFrame*>((ScriptingArrayPtr)pMonoAnimationCurve->pKeyFrameContainer);
-        for (int i = 0; i < keyFrameCount; ++i)
-        {
-            MonoKeyFrame* srcKeyFrame = (MonoKeyFrame*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)(container[i]));
-
-            pKeyFrameContainer[i] = new MonoKeyFrame();
-            memcpy(pKeyFrameContainer[i], srcKeyFrame, sizeof(MonoKeyFrame));
-        }
-    }
-
 	int keyFrameCount;
-	MonoKeyFrame** pKeyFrameContainer;
+	BlobPtr<MonoKeyFrame> pKeyFrameContainer;
 	int preInfinity;
 	int postInfinity;
 };
@@ -169,84 +113,19 @@ public:
 class MonoCurve
 {
 public:
-	MonoCurve()
-        : maxCurve(nullptr)
-        , minCurve(nullptr)
-	{
-	}
-
-    ~MonoCurve()
-    {
-        if (maxCurve != nullptr)
-            delete maxCurve;
-
-        if (minCurve != nullptr)
-            delete minCurve;
-
-        maxCurve = nullptr;
-        minCurve = nullptr;
-    }
-
-	void InitFromMono(MonoCurve* pMonoCurve)
-	{
-		MonoAnimationCurve* srcMinCurve = (MonoAnimationCurve*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pMonoCurve->minCurve);
-        minCurve = new MonoAnimationCurve();
-		memcpy(minCurve, srcMinCurve, sizeof(MonoAnimationCurve));
-        minCurve->InitFromMono(srcMinCurve);
-
-		MonoAnimationCurve* srcMaxCurve = (MonoAnimationCurve*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pMonoCurve->maxCurve);
-        maxCurve = new MonoAnimationCurve();
-		memcpy(maxCurve, srcMaxCurve, sizeof(MonoAnimationCurve));
-        maxCurve->InitFromMono(srcMaxCurve);
-	}
-
 	int minMaxState;
     float scalar;
-	MonoAnimationCurve* minCurve;
-	MonoAnimationCurve* maxCurve;
+	BlobPtr<MonoAnimationCurve> minCurve;
+	BlobPtr<MonoAnimationCurve> maxCurve;
 };
 
+// Immutable once built, shared by all systems created from identical script side init states.
+// See AcquireParticleSystemInitState.
 class ParticleSystemInitState
 {
 public:
 	ParticleSystemInitState();
 
-	void InitFromMono(ParticleSystemInitState* pInitState)
-	{
-		memcpy(this, pInitState, sizeof(ParticleSystemInitState));
-		InitCurveFromMono(this->initModuleLiftTime);
-        InitCurveFromMono(this->initModuleSpeed);
-        InitCurveFromMono(this->initModuleSize);
-        InitCurveFromMono(this->initModuleRotation);
-        InitCurveFromMono(this->sizeModuleCurve);
-        InitCurveFromMono(this->rotationModuleCurve);
-        InitShapeModuleData(this->shapeModuleData);
-        InitMinMaxGradient(this->colorModuleMinMaxGradient);
-	}
-
-    void InitCurveFromMono(MonoCurve* &pMonoCurve)
-    {
-        MonoCurve* src = (MonoCurve*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pMonoCurve);
-        pMonoCurve = new MonoCurve();
-        memcpy(pMonoCurve, src, sizeof(MonoCurve));
-        pMonoCurve->InitFromMono(src);
-    }
-
-    void InitShapeModuleData(ShapeModuleMonoData* &pData)
-    {
-        ShapeModuleMonoData* src = (ShapeModuleMonoData*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pData);
-        pData = new ShapeModuleMonoData();
-        memcpy(pData, src, sizeof(ShapeModuleMonoData));
-    }
-
-    void InitMinMaxGradient(MonoMinMaxGradient* &pMonoMinMaxGradient)
-    {
-        MonoMinMaxGradient* src = (MonoMinMaxGradient*)GetLogicObjectMemoryLayout((ScriptingObjectPtr)pMonoMinMaxGradient);
-        pMonoMinMaxGradient = new MonoMinMaxGradient();
-        memcpy(pMonoMinMaxGradient, src, sizeof(MonoMinMaxGradient));
-        pMonoMinMaxGradient->InitFromMono(src);
-    }
-
 	bool looping;
 	bool prewarm;
 	int randomSeed;
@@ -256,19 +135,19 @@ public:
 	float lengthInSec;
 	bool useLocalSpace;
 	int maxNumParticles;
-    MonoCurve* initModuleLiftTime;
-    MonoCurve* initModuleSpeed;
-    MonoCurve* initModuleSize;
-    MonoCurve* initModuleRotation;
+    BlobPtr<MonoCurve> initModuleLiftTime;
+    BlobPtr<MonoCurve> initModuleSpeed;
+    BlobPtr<MonoCurve> initModuleSize;
+    BlobPtr<MonoCurve> initModuleRotation;
 	bool rotationModuleEnable;
-    MonoCurve* rotationModuleCurve;
+    BlobPtr<MonoCurve> rotationModuleCurve;
 	float emissionRate;
 	bool sizeModuleEnable;
-	MonoCurve* sizeModuleCurve;
+	BlobPtr<MonoCurve> sizeModuleCurve;
     bool shapeModuleEnable;
-    ShapeModuleMonoData* shapeModuleData;
+    BlobPtr<ShapeModuleMonoData> shapeModuleData;
     bool colorModuleEnable;
-    MonoMinMaxGradient* colorModuleMinMaxGradient;
+    BlobPtr<MonoMinMaxGradient> colorModuleMinMaxGradient;
 };
 
 // @TODO: Find "pretty" place for shared structs and enums?
@@ -304,6 +183,7 @@ struct  ParticleSystemState
 	float delayT;
 
 	bool GetIsSubEmitter() const { return isSubEmitter; }
+	void SetIsSubEmitter(bool value) { isSubEmitter = value; }
 	void Tick(const ParticleSystemInitState& initState, float dt);
 private:
 	// When setting this we need to ensure some other things happen as well
@@ -338,7 +218,21 @@ public:
 	inline void SetEnabled(bool enabled) { m_Enabled = enabled; }
 
     static void InitCurveFromMono(MinMaxCurve& curve, const MonoCurve* monoCurve);
+    // Single curve from plain keys for modules set up through the native API, a constant scalar when keyCount is 0
+    static void InitCurveFromKeys(MinMaxCurve& curve, const KeyframeTplFloat* keys, int keyCount, float scalar);
+
+	// Curves that can't be optimized are baked into lookup tables in InitCurveFromMono when sampleCount > 0.
+	// Only affects particle systems created afterwards. Disabled by default.
+	static void SetCurveBaking(int sampleCount, float maxError);
+
+	// Gradients are baked into 256 entry lookup tables by modules that support it (ColorModule). Disabled by default.
+	static void SetGradientBaking(bool enabled) { s_GradientBaking = enabled; }
+	static bool GetGradientBaking() { return s_GradientBaking; }
 
 private:
+	static int s_CurveBakingSampleCount;
+	static float s_CurveBakingMaxError;
+	static bool s_GradientBaking;
+
 	bool m_Enabled;
 };
\ No newline at end of file
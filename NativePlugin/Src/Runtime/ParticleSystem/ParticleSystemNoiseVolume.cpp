@@ -0,0 +1,220 @@
+#include "PluginPrefix.h"
+#include "ParticleSystemNoiseVolume.h"
+#include "Math/FloatConversion.h"
+#include "Utilities/BitUtility.h"
+#include "Utilities/Utility.h"
+#include <stdio.h>
+#include <string.h>
+
+#if UNITY_SUPPORTS_SSE
+#include <xmmintrin.h>
+#endif
+
+ParticleSystemNoiseVolume* ParticleSystemNoiseVolume::s_Instance = NULL;
+
+static const char kNoiseVolumeFileTag[4] = { 'P', 'S', 'N', 'V' };
+
+static inline UInt32 HashLattice(int x, int y, int z, UInt32 seed)
+{
+	UInt32 h = seed ^ (UInt32(x) * 0x8da6b343u) ^ (UInt32(y) * 0xd8163841u) ^ (UInt32(z) * 0xcb1ab31fu);
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline float LatticeValue(int x, int y, int z, UInt32 seed)
+{
+	return float(HashLattice(x, y, z, seed) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// Value noise repeating every period lattice points, at texel (x, y, z) of a volume with resolution texels per period
+static float TileableValueNoise(int x, int y, int z, int resolution, int period, UInt32 seed)
+{
+	const float scale = float(period) / float(resolution);
+	const int texel[3] = { x, y, z };
+	int i0[3], i1[3];
+	float t[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float p = float(texel[axis]) * scale;
+		const float f = Floorf(p);
+		i0[axis] = int(f);
+		i1[axis] = (i0[axis] + 1) % period;
+		t[axis] = p - f;
+		t[axis] = t[axis] * t[axis] * (3.0f - 2.0f * t[axis]);
+	}
+
+	const float c00 = Lerp(LatticeValue(i0[0], i0[1], i0[2], seed), LatticeValue(i1[0], i0[1], i0[2], seed), t[0]);
+	const float c10 = Lerp(LatticeValue(i0[0], i1[1], i0[2], seed), LatticeValue(i1[0], i1[1], i0[2], seed), t[0]);
+	const float c01 = Lerp(LatticeValue(i0[0], i0[1], i1[2], seed), LatticeValue(i1[0], i0[1], i1[2], seed), t[0]);
+	const float c11 = Lerp(LatticeValue(i0[0], i1[1], i1[2], seed), LatticeValue(i1[0], i1[1], i1[2], seed), t[0]);
+	return Lerp(Lerp(c00, c10, t[1]), Lerp(c01, c11, t[1]), t[2]);
+}
+
+void ParticleSystemNoiseVolume::Create()
+{
+	if (s_Instance == NULL)
+		s_Instance = new ParticleSystemNoiseVolume();
+}
+
+void ParticleSystemNoiseVolume::Destroy()
+{
+	delete s_Instance;
+	s_Instance = NULL;
+}
+
+void ParticleSystemNoiseVolume::SetResolution(int resolution)
+{
+	m_Resolution = resolution;
+	m_ResolutionShift = 0;
+	while ((1 << m_ResolutionShift) < resolution)
+		++m_ResolutionShift;
+	m_Texels.resize_uninitialized(size_t(resolution) * resolution * resolution);
+}
+
+void ParticleSystemNoiseVolume::Generate(int resolution, UInt32 seed)
+{
+	SetResolution(NextPowerOfTwo(clamp<int>(resolution, kMinResolution, kMaxResolution)));
+
+	// Potential: three channels of two octaves of value noise
+	const int n = m_Resolution;
+	const int period = n / kTexelsPerFeature;
+	dynamic_array<float> potential(m_Texels.size() * 3, 0.0f, kMemTempAlloc);
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		float* out = &potential[channel * m_Texels.size()];
+		const UInt32 channelSeed = seed + UInt32(channel) * 0x9e3779b9u;
+		for (int z = 0; z < n; ++z)
+			for (int y = 0; y < n; ++y)
+				for (int x = 0; x < n; ++x)
+					out[GetTexelIndex(x, y, z)] = TileableValueNoise(x, y, z, n, period, channelSeed)
+						+ 0.5f * TileableValueNoise(x, y, z, n, period * 2, ~channelSeed);
+	}
+
+	// Curl by central differences, wrapping around the edges keeps the volume tileable
+	const float* px = &potential[0];
+	const float* py = &potential[m_Texels.size()];
+	const float* pz = &potential[m_Texels.size() * 2];
+	const int mask = n - 1;
+	float maxSqrLength = 0.0f;
+	for (int z = 0; z < n; ++z)
+		for (int y = 0; y < n; ++y)
+			for (int x = 0; x < n; ++x)
+			{
+				const UInt32 xm = GetTexelIndex((x - 1) & mask, y, z), xp = GetTexelIndex((x + 1) & mask, y, z);
+				const UInt32 ym = GetTexelIndex(x, (y - 1) & mask, z), yp = GetTexelIndex(x, (y + 1) & mask, z);
+				const UInt32 zm = GetTexelIndex(x, y, (z - 1) & mask), zp = GetTexelIndex(x, y, (z + 1) & mask);
+				const Vector3f curl(
+					(pz[yp] - pz[ym]) - (py[zp] - py[zm]),
+					(px[zp] - px[zm]) - (pz[xp] - pz[xm]),
+					(py[xp] - py[xm]) - (px[yp] - px[ym]));
+				m_Texels[GetTexelIndex(x, y, z)] = Vector4f(curl, 0.0f);
+				maxSqrLength = std::max(maxSqrLength, SqrMagnitude(curl));
+			}
+
+	const float scale = maxSqrLength > 0.0f ? 1.0f / Sqrt(maxSqrLength) : 0.0f;
+	for (size_t i = 0; i < m_Texels.size(); ++i)
+		m_Texels[i] = m_Texels[i] * scale;
+}
+
+bool ParticleSystemNoiseVolume::Load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	char tag[4];
+	UInt32 resolution = 0;
+	bool result = fread(tag, sizeof(tag), 1, file) == 1 && memcmp(tag, kNoiseVolumeFileTag, sizeof(tag)) == 0
+		&& fread(&resolution, sizeof(resolution), 1, file) == 1
+		&& resolution >= kMinResolution && resolution <= kMaxResolution && (resolution & (resolution - 1)) == 0;
+
+	if (result)
+	{
+		const size_t texelCount = size_t(resolution) * resolution * resolution;
+		dynamic_array<Vector3f> vectors(kMemTempAlloc);
+		vectors.resize_uninitialized(texelCount);
+		result = fread(vectors.begin(), sizeof(Vector3f), texelCount, file) == texelCount;
+		if (result)
+		{
+			SetResolution(int(resolution));
+			for (size_t i = 0; i < texelCount; ++i)
+				m_Texels[i] = Vector4f(vectors[i], 0.0f);
+		}
+	}
+
+	fclose(file);
+	return result;
+}
+
+bool ParticleSystemNoiseVolume::Save(const char* path) const
+{
+	if (IsEmpty())
+		return false;
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	const UInt32 resolution = UInt32(m_Resolution);
+	bool result = fwrite(kNoiseVolumeFileTag, sizeof(kNoiseVolumeFileTag), 1, file) == 1 && fwrite(&resolution, sizeof(resolution), 1, file) == 1;
+	for (size_t i = 0; i < m_Texels.size() && result; ++i)
+		result = fwrite(m_Texels[i].GetPtr(), sizeof(float), 3, file) == 3;
+
+	fclose(file);
+	return result;
+}
+
+#if UNITY_SUPPORTS_SSE
+static inline __m128 Lerp4(__m128 a, __m128 b, __m128 t)
+{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+#endif
+
+void ParticleSystemNoiseVolume::SampleBatch(const Vector3f* coords, Vector3f* out, size_t count) const
+{
+	const int mask = m_Resolution - 1;
+	const Vector4f* texels = m_Texels.begin();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vector3f& c = coords[i];
+		const float fx = Floorf(c.x);
+		const float fy = Floorf(c.y);
+		const float fz = Floorf(c.z);
+		const int x0 = int(fx) & mask, x1 = (x0 + 1) & mask;
+		const int y0 = int(fy) & mask, y1 = (y0 + 1) & mask;
+		const int z0 = int(fz) & mask, z1 = (z0 + 1) & mask;
+
+#if UNITY_SUPPORTS_SSE
+		// xyz of a texel in one register, the 8 corners are blended for all three components at once
+		const __m128 tx = _mm_set1_ps(c.x - fx);
+		const __m128 ty = _mm_set1_ps(c.y - fy);
+		const __m128 tz = _mm_set1_ps(c.z - fz);
+		const __m128 c00 = Lerp4(_mm_loadu_ps(texels[GetTexelIndex(x0, y0, z0)].GetPtr()), _mm_loadu_ps(texels[GetTexelIndex(x1, y0, z0)].GetPtr()), tx);
+		const __m128 c10 = Lerp4(_mm_loadu_ps(texels[GetTexelIndex(x0, y1, z0)].GetPtr()), _mm_loadu_ps(texels[GetTexelIndex(x1, y1, z0)].GetPtr()), tx);
+		const __m128 c01 = Lerp4(_mm_loadu_ps(texels[GetTexelIndex(x0, y0, z1)].GetPtr()), _mm_loadu_ps(texels[GetTexelIndex(x1, y0, z1)].GetPtr()), tx);
+		const __m128 c11 = Lerp4(_mm_loadu_ps(texels[GetTexelIndex(x0, y1, z1)].GetPtr()), _mm_loadu_ps(texels[GetTexelIndex(x1, y1, z1)].GetPtr()), tx);
+		const __m128 v = Lerp4(Lerp4(c00, c10, ty), Lerp4(c01, c11, ty), tz);
+		_mm_storel_pi((__m64*)&out[i].x, v);
+		_mm_store_ss(&out[i].z, _mm_movehl_ps(v, v));
+#else
+		const float tx = c.x - fx;
+		const float ty = c.y - fy;
+		const float tz = c.z - fz;
+		float result[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			const float c00 = Lerp(texels[GetTexelIndex(x0, y0, z0)][k], texels[GetTexelIndex(x1, y0, z0)][k], tx);
+			const float c10 = Lerp(texels[GetTexelIndex(x0, y1, z0)][k], texels[GetTexelIndex(x1, y1, z0)][k], tx);
+			const float c01 = Lerp(texels[GetTexelIndex(x0, y0, z1)][k], texels[GetTexelIndex(x1, y0, z1)][k], tx);
+			const float c11 = Lerp(texels[GetTexelIndex(x0, y1, z1)][k], texels[GetTexelIndex(x1, y1, z1)][k], tx);
+			result[k] = Lerp(Lerp(c00, c10, ty), Lerp(c01, c11, ty), tz);
+		}
+		out[i] = Vector3f(result[0], result[1], result[2]);
+#endif
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Math/Vector3.h"
+#include "Math/Vector4.h"
+#include "Utilities/dynamic_array.h"
+
+// Tileable 3D volume of curl noise vectors, shared by all noise modules. The curl of a noise potential is divergence free,
+// so particles following it swirl without clumping. Sampling is a trilinear lookup instead of evaluating noise per particle.
+// Texels are padded to 4 floats so a corner is one vector load.
+class ParticleSystemNoiseVolume
+{
+public:
+	enum
+	{
+		kDefaultResolution = 32,
+		kMinResolution = 8,
+		kMaxResolution = 128,
+		kTexelsPerFeature = 4,	// Texels between the lattice points of the noise potential
+	};
+
+	ParticleSystemNoiseVolume() : m_Resolution(0), m_ResolutionShift(0) {}
+
+	// resolution is rounded up to a power of two. The vectors are scaled to a maximum length of 1.
+	void Generate(int resolution, UInt32 seed);
+
+	// Raw volume as written by Save: "PSNV", UInt32 resolution, then resolution^3 texels of x, y, z floats
+	bool Load(const char* path);
+	bool Save(const char* path) const;
+
+	bool IsEmpty() const { return m_Texels.empty(); }
+	int GetResolution() const { return m_Resolution; }
+
+	// coords are in texels, the volume repeats every GetResolution() texels along each axis
+	void SampleBatch(const Vector3f* coords, Vector3f* out, size_t count) const;
+
+	// Created empty by ParticleSystem::Init, generated on first use. Must not be changed while particle jobs are running.
+	static void Create();
+	static void Destroy();
+	static ParticleSystemNoiseVolume& Get() { return *s_Instance; }
+
+private:
+	void SetResolution(int resolution);
+	inline UInt32 GetTexelIndex(int x, int y, int z) const { return (UInt32(z) << (2 * m_ResolutionShift)) | (UInt32(y) << m_ResolutionShift) | UInt32(x); }
+
+	dynamic_array<Vector4f> m_Texels;
+	int m_Resolution;
+	int m_ResolutionShift;
+
+	static ParticleSystemNoiseVolume* s_Instance;
+};
@@ -25,7 +25,23 @@ struct ParticleSystemParticles
 		, usesTriggerEvents(false)
 		, numEmitAccumulators(0)
 		, refCount(1)
-	{}
+	{
+		// Long lived and walked linearly every frame, large arrays of this label are backed by huge pages where available
+		position.set_memory_label(kMemParticleSystem);
+		velocity.set_memory_label(kMemParticleSystem);
+		animatedVelocity.set_memory_label(kMemParticleSystem);
+		initialVelocity.set_memory_label(kMemParticleSystem);
+		axisOfRotation.set_memory_label(kMemParticleSystem);
+		rotation.set_memory_label(kMemParticleSystem);
+		rotationalSpeed.set_memory_label(kMemParticleSystem);
+		size.set_memory_label(kMemParticleSystem);
+		color.set_memory_label(kMemParticleSystem);
+		randomSeed.set_memory_label(kMemParticleSystem);
+		lifetime.set_memory_label(kMemParticleSystem);
+		startLifetime.set_memory_label(kMemParticleSystem);
+		for (int acc = 0; acc < kParticleSystemMaxNumEmitAccumulators; acc++)
+			emitAccumulator[acc].set_memory_label(kMemParticleSystem);
+	}
 
 	ParticleSystemVector3Array position;
 	ParticleSystemVector3Array velocity;
@@ -74,4 +90,12 @@ struct ParticleSystemParticlesTempData
 inline float NormalizedTime(const ParticleSystemParticles& ps, size_t i)
 {
 	return (ps.startLifetime[i] - ps.lifetime[i]) / ps.startLifetime[i];
+}
+
+inline void NormalizedTimeBatch(const ParticleSystemParticles& ps, size_t fromIndex, size_t count, float* out)
+{
+	const float* lifetime = &ps.lifetime[fromIndex];
+	const float* startLifetime = &ps.startLifetime[fromIndex];
+	for (size_t i = 0; i < count; ++i)
+		out[i] = (startLifetime[i] - lifetime[i]) / startLifetime[i];
 }
\ No newline at end of file
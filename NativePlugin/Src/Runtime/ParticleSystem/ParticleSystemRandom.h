@@ -0,0 +1,57 @@
+#pragma once
+
+#if UNITY_SUPPORTS_SSE
+#include <emmintrin.h>
+#endif
+
+// Stateless counter-based random numbers (Philox2x32-10, Salmon et al. "Parallel Random Numbers: As Easy as 1, 2, 3").
+// The result only depends on (counter, key): particles use their randomSeed as the counter and the
+// ParticleSystemRandomnessIds value of the module as the key, so modules can evaluate their randoms in any order.
+// Only 32 bit integer math is used, so the scalar and SIMD paths produce identical values on every platform.
+
+static const int kParticleSystemRandomRounds = 10;
+static const UInt32 kParticleSystemRandomMultiplier = 0xD256D193;
+static const UInt32 kParticleSystemRandomKeyIncrement = 0x9E3779B9;
+
+inline UInt32 ParticleSystemRandomUInt32 (UInt32 counter, UInt32 key)
+{
+	UInt32 c0 = counter;
+	UInt32 c1 = 0;
+	for (int i = 0; i < kParticleSystemRandomRounds; ++i)
+	{
+		const UInt64 product = UInt64(kParticleSystemRandomMultiplier) * UInt64(c0);
+		c0 = UInt32(product >> 32) ^ key ^ c1;
+		c1 = UInt32(product);
+		key += kParticleSystemRandomKeyIncrement;
+	}
+	return c0;
+}
+
+// Four randoms per call. counter and out don't need to be aligned.
+inline void ParticleSystemRandomUInt32x4 (const UInt32* counter, UInt32 key, UInt32* out)
+{
+#if UNITY_SUPPORTS_SSE
+	const __m128i multiplier = _mm_set1_epi32 ((int)kParticleSystemRandomMultiplier);
+	const __m128i lowMask = _mm_set_epi32 (0, -1, 0, -1);
+	const __m128i highMask = _mm_set_epi32 (-1, 0, -1, 0);
+	__m128i c0 = _mm_loadu_si128 ((const __m128i*)counter);
+	__m128i c1 = _mm_setzero_si128 ();
+	for (int i = 0; i < kParticleSystemRandomRounds; ++i)
+	{
+		// _mm_mul_epu32 only multiplies the even lanes, so the odd lanes are shifted down and multiplied separately
+		const __m128i productEven = _mm_mul_epu32 (c0, multiplier);
+		const __m128i productOdd = _mm_mul_epu32 (_mm_srli_epi64 (c0, 32), multiplier);
+		const __m128i low = _mm_or_si128 (_mm_and_si128 (productEven, lowMask), _mm_slli_epi64 (productOdd, 32));
+		const __m128i high = _mm_or_si128 (_mm_srli_epi64 (productEven, 32), _mm_and_si128 (productOdd, highMask));
+		c0 = _mm_xor_si128 (_mm_xor_si128 (high, _mm_set1_epi32 ((int)key)), c1);
+		c1 = low;
+		key += kParticleSystemRandomKeyIncrement;
+	}
+	_mm_storeu_si128 ((__m128i*)out, c0);
+#else
+	out[0] = ParticleSystemRandomUInt32 (counter[0], key);
+	out[1] = ParticleSystemRandomUInt32 (counter[1], key);
+	out[2] = ParticleSystemRandomUInt32 (counter[2], key);
+	out[3] = ParticleSystemRandomUInt32 (counter[3], key);
+#endif
+}
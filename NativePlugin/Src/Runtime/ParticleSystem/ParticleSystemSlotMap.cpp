@@ -0,0 +1,86 @@
+#include "PluginPrefix.h"
+#include "ParticleSystemSlotMap.h"
+#include "Threads/AtomicOps.h"
+
+ParticleSystemSlotMap::ParticleSystemSlotMap()
+	: m_SlotCount(1)	// Index 0 is the null handle
+{
+	for (int i = 0; i < kMaxPages; ++i)
+		m_Pages[i] = NULL;
+	m_FreeSlots = CreateConcurrentStack();
+}
+
+ParticleSystemSlotMap::~ParticleSystemSlotMap()
+{
+	DestroyConcurrentStack(m_FreeSlots);
+	for (int i = 0; i < kMaxPages; ++i)
+	{
+		if (m_Pages[i] != NULL)
+			UNITY_FREE(kMemParticleSystem, m_Pages[i]);
+	}
+}
+
+ParticleSystemSlotMap::Slot* ParticleSystemSlotMap::GetOrCreatePage(int pageIndex)
+{
+	Slot* page = m_Pages[pageIndex];
+	if (page != NULL)
+		return page;
+
+	Slot* newPage = static_cast<Slot*>(UNITY_MALLOC(kMemParticleSystem, sizeof(Slot) * kPageSize));
+	for (int i = 0; i < kPageSize; ++i)
+	{
+		Slot& slot = newPage[i];
+		slot.freeNode.data[0] = &slot;
+		slot.pendingNode.data[0] = &slot;
+		slot.system = NULL;
+		slot.generation = 0;
+		slot.pendingFlags = 0;
+		slot.index = (pageIndex << kPageShift) + i;
+	}
+
+	// Threads taking the first slots of a page race to create it, the losers use the winner's page
+	if (!AtomicCompareExchangePointer(reinterpret_cast<void* volatile*>(&m_Pages[pageIndex]), newPage, NULL))
+	{
+		UNITY_FREE(kMemParticleSystem, newPage);
+		return m_Pages[pageIndex];
+	}
+	return newPage;
+}
+
+int ParticleSystemSlotMap::Create(ParticleSystem* system)
+{
+	Slot* slot;
+	ConcurrentNode* node = m_FreeSlots->Pop();
+	if (node != NULL)
+	{
+		slot = static_cast<Slot*>(node->data[0]);
+	}
+	else
+	{
+		int index;
+		do
+		{
+			index = m_SlotCount;
+			if (index >= kMaxSlots)
+				return -1;
+		}
+		while (!AtomicCompareExchange(&m_SlotCount, index + 1, index));
+
+		// GetSlot returns NULL for the index until the page is published
+		slot = &GetOrCreatePage(index >> kPageShift)[index & (kPageSize - 1)];
+	}
+
+	slot->system = system;
+	return slot->index;
+}
+
+void ParticleSystemSlotMap::Release(int index)
+{
+	Slot* slot = GetSlot(index);
+	if (slot == NULL || slot->system == NULL)
+		return;
+
+	slot->system = NULL;
+	AtomicAdd(&slot->generation, 1);
+	m_FreeSlots->Push(&slot->freeNode);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Threads/ConcurrentContainers.h"
+#include "Threads/ThreadUtility.h"
+#include "Utilities/UniqueIDGenerator.h"
+#include <string.h>
+
+class ParticleSystem;
+
+// Slots of the particle systems. Scripts refer to a system by a 32-bit handle laid out like UniqueSmallID, the slot
+// index and the low 8 bits of the slot's generation, so handles to released slots are rejected until the version
+// wraps around after 256 reuses of the same slot. Like in UniqueIDGenerator index 0 is reserved, 0 is the null handle.
+// Create, Release and Get are lock-free and can be called from any thread. Slots are allocated in pages that
+// are only freed on destruction, so a slot can still be read after its system is gone: system is NULL then,
+// and generation was bumped so a released and reused slot can be told apart from the one a handle was made for.
+class ParticleSystemSlotMap
+{
+public:
+	enum
+	{
+		kPageShift = 8,
+		kPageSize = 1 << kPageShift,
+		kMaxPages = 256,
+		kMaxSlots = kPageSize * kMaxPages
+	};
+
+	struct Slot
+	{
+		ConcurrentNode           freeNode;       // Link in the free slots, data[0] points back to the slot
+		ConcurrentNode           pendingNode;    // Link in the manager's pending changes, data[0] points back to the slot
+		ParticleSystem* volatile system;
+		volatile int             generation;
+		volatile int             pendingFlags;   // Owned by the manager
+		int                      index;
+	};
+
+	ParticleSystemSlotMap();
+	~ParticleSystemSlotMap();
+
+	// Returns the slot index, or -1 if all slots are in use
+	int             Create(ParticleSystem* system);
+	// The system must have been taken out of use, the slot is reused by later Create calls
+	void            Release(int index);
+
+	Slot*           GetSlot(int index) const;
+	ParticleSystem* Get(int index) const;
+
+	UniqueSmallID   GetHandle(int index) const;
+	// Returns NULL for the null handle and for handles to released slots
+	ParticleSystem* Get(UniqueSmallID handle) const;
+
+	static UniqueSmallID HandleFromInt(int value) { UniqueSmallID handle; memcpy(&handle, &value, sizeof(handle)); return handle; }
+	static int           HandleToInt(UniqueSmallID handle) { int value; memcpy(&value, &handle, sizeof(value)); return value; }
+
+	// Upper bound of the slot indices in use
+	int             GetSlotCount() const { return m_SlotCount; }
+
+private:
+	Slot*           GetOrCreatePage(int pageIndex);
+
+	Slot* volatile   m_Pages[kMaxPages];
+	volatile int     m_SlotCount;
+	ConcurrentStack* m_FreeSlots;
+};
+
+inline ParticleSystemSlotMap::Slot* ParticleSystemSlotMap::GetSlot(int index) const
+{
+	if ((unsigned)index >= (unsigned)m_SlotCount)
+		return NULL;
+
+	Slot* page = m_Pages[index >> kPageShift];
+	return page != NULL ? &page[index & (kPageSize - 1)] : NULL;
+}
+
+inline ParticleSystem* ParticleSystemSlotMap::Get(int index) const
+{
+	Slot* slot = GetSlot(index);
+	return slot != NULL ? slot->system : NULL;
+}
+
+inline UniqueSmallID ParticleSystemSlotMap::GetHandle(int index) const
+{
+	UniqueSmallID handle;
+	Slot* slot = GetSlot(index);
+	if (slot != NULL && slot->system != NULL)
+	{
+		handle.index = index;
+		handle.version = slot->generation;
+	}
+	return handle;
+}
+
+inline ParticleSystem* ParticleSystemSlotMap::Get(UniqueSmallID handle) const
+{
+	Slot* slot = GetSlot(handle.index);
+	if (slot == NULL)
+		return NULL;
+
+	// Release clears the system before bumping the generation, a slot reused in between fails the version check
+	ParticleSystem* system = slot->system;
+	UnityMemoryBarrier();
+	return UInt8(slot->generation) == handle.version ? system : NULL;
+}
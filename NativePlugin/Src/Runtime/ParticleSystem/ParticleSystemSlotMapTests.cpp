@@ -0,0 +1,154 @@
+#include "PluginPrefix.h"
+
+#if ENABLE_UNIT_TESTS
+
+#include "Runtime/Testing/Testing.h"
+#include "ParticleSystemSlotMap.h"
+#include "Threads/Thread.h"
+#include "Threads/AtomicOps.h"
+
+SUITE (ParticleSystemSlotMapTests)
+{
+	// The slot map only stores the pointers, so tests use fake systems that are never dereferenced
+	static ParticleSystem* FakeSystem(size_t value)
+	{
+		return reinterpret_cast<ParticleSystem*>(value << 4);
+	}
+
+	TEST (ParticleSystemSlotMap_Create_ReturnsHandleToSystem)
+	{
+		ParticleSystemSlotMap slotMap;
+		const int index = slotMap.Create(FakeSystem(1));
+
+		CHECK (index > 0);
+		CHECK_EQUAL (FakeSystem(1), slotMap.Get(index));
+		CHECK_EQUAL (FakeSystem(1), slotMap.Get(slotMap.GetHandle(index)));
+	}
+
+	TEST (ParticleSystemSlotMap_NullHandle_ReturnsNull)
+	{
+		ParticleSystemSlotMap slotMap;
+		slotMap.Create(FakeSystem(1));
+
+		CHECK_EQUAL (0, ParticleSystemSlotMap::HandleToInt(UniqueSmallID()));
+		CHECK (slotMap.Get(ParticleSystemSlotMap::HandleFromInt(0)) == NULL);
+	}
+
+	TEST (ParticleSystemSlotMap_ReleasedSlot_RejectsStaleHandle)
+	{
+		ParticleSystemSlotMap slotMap;
+		const int index = slotMap.Create(FakeSystem(1));
+		const UniqueSmallID staleHandle = slotMap.GetHandle(index);
+		slotMap.Release(index);
+
+		CHECK (slotMap.Get(staleHandle) == NULL);
+
+		// The reused slot gets a new generation, the old handle must not resolve to the new system
+		CHECK_EQUAL (index, slotMap.Create(FakeSystem(2)));
+		CHECK (slotMap.Get(staleHandle) == NULL);
+		CHECK_EQUAL (FakeSystem(2), slotMap.Get(slotMap.GetHandle(index)));
+	}
+
+	TEST (ParticleSystemSlotMap_GenerationWrapsAfter256Reuses)
+	{
+		ParticleSystemSlotMap slotMap;
+		const int index = slotMap.Create(FakeSystem(1));
+		const UniqueSmallID firstHandle = slotMap.GetHandle(index);
+
+		for (int i = 1; i < 256; ++i)
+		{
+			slotMap.Release(index);
+			CHECK_EQUAL (index, slotMap.Create(FakeSystem(1)));
+			CHECK (slotMap.Get(firstHandle) == NULL);
+		}
+
+		// Only 8 bits of the generation are in the handle, the 256th reuse matches the first handle again
+		slotMap.Release(index);
+		CHECK_EQUAL (index, slotMap.Create(FakeSystem(2)));
+		CHECK_EQUAL (ParticleSystemSlotMap::HandleToInt(firstHandle), ParticleSystemSlotMap::HandleToInt(slotMap.GetHandle(index)));
+		CHECK_EQUAL (FakeSystem(2), slotMap.Get(firstHandle));
+	}
+
+	TEST (ParticleSystemSlotMap_CreateBeyondOnePage_AddsPages)
+	{
+		ParticleSystemSlotMap slotMap;
+		const int count = ParticleSystemSlotMap::kPageSize * 3;
+		for (int i = 1; i <= count; ++i)
+			CHECK_EQUAL (i, slotMap.Create(FakeSystem(i)));
+
+		CHECK_EQUAL (count + 1, slotMap.GetSlotCount());
+		for (int i = 1; i <= count; ++i)
+		{
+			CHECK_EQUAL (i, slotMap.GetSlot(i)->index);
+			CHECK_EQUAL (FakeSystem(i), slotMap.Get(slotMap.GetHandle(i)));
+		}
+		CHECK (slotMap.GetSlot(count + 1) == NULL);
+	}
+
+	struct ConcurrentData
+	{
+		enum { kThreadCount = 4, kHeldCount = 64, kRounds = 2000 };
+
+		ParticleSystemSlotMap slotMap;
+		volatile int failures;
+	};
+
+	struct ConcurrentThreadData
+	{
+		ConcurrentData* shared;
+		size_t id;
+	};
+
+	static void* CreateAndReleaseThread(void* userData)
+	{
+		ConcurrentThreadData& data = *static_cast<ConcurrentThreadData*>(userData);
+		ParticleSystemSlotMap& slotMap = data.shared->slotMap;
+
+		int indices[ConcurrentData::kHeldCount];
+		UniqueSmallID handles[ConcurrentData::kHeldCount];
+		for (int round = 0; round < ConcurrentData::kRounds; ++round)
+		{
+			for (int i = 0; i < ConcurrentData::kHeldCount; ++i)
+			{
+				indices[i] = slotMap.Create(FakeSystem(data.id));
+				handles[i] = slotMap.GetHandle(indices[i]);
+			}
+
+			// No other thread may have been handed one of the slots this thread holds
+			for (int i = 0; i < ConcurrentData::kHeldCount; ++i)
+			{
+				if (indices[i] <= 0 || slotMap.Get(handles[i]) != FakeSystem(data.id))
+					AtomicIncrement(&data.shared->failures);
+			}
+
+			for (int i = 0; i < ConcurrentData::kHeldCount; ++i)
+				slotMap.Release(indices[i]);
+		}
+		return NULL;
+	}
+
+	TEST (ParticleSystemSlotMap_ConcurrentCreateAndRelease_NeverSharesSlots)
+	{
+		ConcurrentData shared;
+		shared.failures = 0;
+
+		Thread threads[ConcurrentData::kThreadCount];
+		ConcurrentThreadData threadData[ConcurrentData::kThreadCount];
+		for (int i = 0; i < ConcurrentData::kThreadCount; ++i)
+		{
+			threadData[i].shared = &shared;
+			threadData[i].id = i + 1;
+			threads[i].Run(CreateAndReleaseThread, &threadData[i]);
+		}
+		for (int i = 0; i < ConcurrentData::kThreadCount; ++i)
+			threads[i].WaitForExit();
+
+		CHECK_EQUAL (0, shared.failures);
+		// Released slots are reused, without that the threads would have used kRounds times as many
+		CHECK (shared.slotMap.GetSlotCount() <= 2 * ConcurrentData::kThreadCount * ConcurrentData::kHeldCount);
+		for (int i = 1; i < shared.slotMap.GetSlotCount(); ++i)
+			CHECK (shared.slotMap.Get(i) == NULL);
+	}
+}
+
+#endif // ENABLE_UNIT_TESTS
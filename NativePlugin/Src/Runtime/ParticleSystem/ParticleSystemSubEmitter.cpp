@@ -0,0 +1,161 @@
+#include "PluginPrefix.h"
+#include "ParticleSystemSubEmitter.h"
+#include "ParticleSystem.h"
+#include "ParticleSystemParticles.h"
+#include "Math/Matrix4x4.h"
+
+size_t ParticleSystemSubEmitterQueue::Push(const ParticleSystemSubEmitterEvent* events, size_t count)
+{
+	size_t pushed = 0;
+	while (pushed < count)
+	{
+		const size_t blockCount = std::min<size_t>(count - pushed, kMaxEventsPerBlock);
+		const int size = int(blockCount * sizeof(ParticleSystemSubEmitterEvent));
+		AtomicCircularBufferHandle* handle = m_Buffer.ReserveSpaceForData(size);
+		if (handle == NULL)
+			break;
+
+		m_Buffer.CopyDataAndMakeAvailableForRead(handle, (unsigned char*)(events + pushed), 0, size);
+		pushed += blockCount;
+	}
+	return pushed;
+}
+
+void ParticleSystemSubEmitterQueue::PopAll(dynamic_array<ParticleSystemSubEmitterEvent>& out)
+{
+	for (int size = m_Buffer.GetNextPayloadSize(); size != 0; size = m_Buffer.GetNextPayloadSize())
+	{
+		const size_t first = out.size();
+		out.resize_uninitialized(first + size / sizeof(ParticleSystemSubEmitterEvent));
+		m_Buffer.ReadNextPayload((unsigned char*)&out[first], size);
+	}
+}
+
+bool ParticleSystemSubEmitters::Add(ParticleSystem* emitter, ParticleSystemSubType type, float rate, UInt32 burstCount)
+{
+	int* typeCount;
+	int maxTypeCount;
+	switch (type)
+	{
+	case kParticleSystemSubTypeBirth: typeCount = &m_BirthCount; maxTypeCount = kParticleSystemMaxSubBirth; break;
+	case kParticleSystemSubTypeCollision: typeCount = &m_CollisionCount; maxTypeCount = kParticleSystemMaxSubCollision; break;
+	case kParticleSystemSubTypeDeath: typeCount = &m_DeathCount; maxTypeCount = kParticleSystemMaxSubDeath; break;
+	default: return false;
+	}
+
+	if (*typeCount >= maxTypeCount)
+		return false;
+
+	Entry& entry = m_Entries[m_Count++];
+	entry.emitter = emitter;
+	entry.type = type;
+	entry.rate = rate;
+	entry.burstCount = burstCount;
+	entry.accumulatorIndex = (type == kParticleSystemSubTypeBirth) ? m_BirthCount : -1;
+	entry.events.clear();
+	++*typeCount;
+	return true;
+}
+
+void ParticleSystemSubEmitters::Remove(const ParticleSystem* emitter)
+{
+	for (int i = 0; i < m_Count; ++i)
+	{
+		if (m_Entries[i].emitter == emitter)
+		{
+			m_Entries[i].emitter = NULL;
+			m_Entries[i].events.clear();
+		}
+	}
+}
+
+bool ParticleSystemSubEmitters::Contains(const ParticleSystem* emitter) const
+{
+	for (int i = 0; i < m_Count; ++i)
+	{
+		if (m_Entries[i].emitter == emitter)
+			return true;
+	}
+	return false;
+}
+
+void ParticleSystemSubEmitters::Clear()
+{
+	for (int i = 0; i < m_Count; ++i)
+	{
+		m_Entries[i].emitter = NULL;
+		m_Entries[i].events.clear();
+	}
+	m_Count = 0;
+	m_BirthCount = 0;
+	m_DeathCount = 0;
+	m_CollisionCount = 0;
+}
+
+void ParticleSystemSubEmitters::RecordDeath(const ParticleSystemParticles& ps, size_t index)
+{
+	for (int i = 0; i < m_Count; ++i)
+	{
+		Entry& entry = m_Entries[i];
+		if (entry.type != kParticleSystemSubTypeDeath || entry.emitter == NULL)
+			continue;
+
+		ParticleSystemSubEmitterEvent& event = entry.events.push_back();
+		event.position = ps.position[index];
+		event.velocity = ps.velocity[index];
+		event.particleCount = entry.burstCount;
+	}
+}
+
+void ParticleSystemSubEmitters::RecordBirths(ParticleSystemParticles& ps, size_t fromIndex, float dt)
+{
+	const size_t particleCount = ps.array_size();
+	for (int i = 0; i < m_Count; ++i)
+	{
+		Entry& entry = m_Entries[i];
+		if (entry.type != kParticleSystemSubTypeBirth || entry.emitter == NULL || fromIndex >= particleCount)
+			continue;
+
+		// Every parent particle emits at the sub-emitter's rate, the fractions carry over to the next step
+		const float toEmit = entry.rate * dt;
+		float* accumulator = &ps.emitAccumulator[entry.accumulatorIndex][0];
+		for (size_t q = fromIndex; q < particleCount; ++q)
+		{
+			accumulator[q] += toEmit;
+			const UInt32 count = UInt32(accumulator[q]);
+			if (count == 0)
+				continue;
+
+			accumulator[q] -= float(count);
+			ParticleSystemSubEmitterEvent& event = entry.events.push_back();
+			event.position = ps.position[q];
+			event.velocity = ps.velocity[q];
+			event.particleCount = count;
+		}
+	}
+}
+
+void ParticleSystemSubEmitters::Flush(bool isLocalSpace, const Matrix4x4f& localToWorld)
+{
+	for (int i = 0; i < m_Count; ++i)
+	{
+		Entry& entry = m_Entries[i];
+		const size_t count = entry.events.size();
+		if (count == 0)
+			continue;
+
+		if (isLocalSpace)
+		{
+			for (size_t e = 0; e < count; ++e)
+			{
+				entry.events[e].position = localToWorld.MultiplyPoint3(entry.events[e].position);
+				entry.events[e].velocity = localToWorld.MultiplyVector3(entry.events[e].velocity);
+			}
+		}
+
+		ParticleSystemSubEmitterQueue* queue = entry.emitter->GetSubEmitterQueue();
+		if (queue != NULL)
+			queue->Push(entry.events.begin(), count);
+		entry.events.resize_uninitialized(0);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ParticleSystemCommon.h"
+#include "Math/Vector3.h"
+#include "Utilities/dynamic_array.h"
+#include "Threads/MultiWriterSingleReaderAtomicCircularBuffer.h"
+
+class ParticleSystem;
+class Matrix4x4f;
+struct ParticleSystemParticles;
+
+// Request from a parent particle to start particleCount particles in a sub-emitter
+struct ParticleSystemSubEmitterEvent
+{
+	Vector3f position;		// World space
+	Vector3f velocity;		// World space
+	UInt32 particleCount;
+};
+
+// Spawn events waiting for one sub-emitter. Parent jobs on any worker thread push the events of a frame in blocks,
+// and only the sub-emitter's own job pops them, which it does in the update stage after its parents.
+// Neither side takes a lock. The queue doesn't grow: events that don't fit are dropped.
+class ParticleSystemSubEmitterQueue
+{
+public:
+	enum { kSizeInBytes = 64 * 1024, kMaxEventsPerBlock = 256 };
+
+	ParticleSystemSubEmitterQueue() : m_Buffer(kSizeInBytes) {}
+
+	// Returns the number of events that could be queued
+	size_t Push(const ParticleSystemSubEmitterEvent* events, size_t count);
+	// Appends all queued events to out
+	void PopAll(dynamic_array<ParticleSystemSubEmitterEvent>& out);
+
+private:
+	MultiWriterSingleReaderAtomicCircularBuffer m_Buffer;
+};
+
+// Parent side: collects the birth and death events of the parent particles during the parent's update
+// and hands them to the sub-emitters' queues at the end of it.
+class ParticleSystemSubEmitters
+{
+public:
+	ParticleSystemSubEmitters() : m_Count(0), m_BirthCount(0), m_DeathCount(0), m_CollisionCount(0) {}
+
+	// rate is the number of particles per second a birth sub-emitter starts along every parent particle,
+	// burstCount the number of particles a death sub-emitter starts when a parent particle dies.
+	// Returns false if the parent already has the maximum number of sub-emitters of this type.
+	bool Add(ParticleSystem* emitter, ParticleSystemSubType type, float rate, UInt32 burstCount);
+	// For a sub-emitter that is being destroyed, its entries stay unused until Clear
+	void Remove(const ParticleSystem* emitter);
+	void Clear();
+
+	bool IsEmpty() const { return m_Count == 0; }
+	bool Contains(const ParticleSystem* emitter) const;
+	int GetCount() const { return m_Count; }
+	// NULL for entries of removed sub-emitters
+	ParticleSystem* GetEmitter(int index) const { return m_Entries[index].emitter; }
+	bool HasDeathEmitters() const { return m_DeathCount != 0; }
+	int GetBirthCount() const { return m_BirthCount; }
+
+	// Called from the parent's update job
+	void RecordDeath(const ParticleSystemParticles& ps, size_t index);
+	void RecordBirths(ParticleSystemParticles& ps, size_t fromIndex, float dt);
+	void Flush(bool isLocalSpace, const Matrix4x4f& localToWorld);
+
+private:
+	struct Entry
+	{
+		Entry() : emitter(NULL), type(kParticleSystemSubTypeBirth), rate(0.0f), burstCount(0), accumulatorIndex(-1) {}
+
+		ParticleSystem* emitter;
+		ParticleSystemSubType type;
+		float rate;
+		UInt32 burstCount;
+		int accumulatorIndex;	// Birth only, index into ParticleSystemParticles::emitAccumulator
+		dynamic_array<ParticleSystemSubEmitterEvent> events;
+	};
+
+	Entry m_Entries[kParticleSystemMaxSubTotal];
+	int m_Count;
+	int m_BirthCount;
+	int m_DeathCount;
+	int m_CollisionCount;
+};
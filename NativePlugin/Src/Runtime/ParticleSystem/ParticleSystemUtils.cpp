@@ -14,6 +14,47 @@ void ResetGlobalRandomSeed ()
 	randomSeed = 0x1337;
 }
 
+void GenerateRandomUInt32Batch(const UInt32* seeds, UInt32 randomId, UInt32* out, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		ParticleSystemRandomUInt32x4(seeds + i, randomId, out + i);
+	for (; i < count; ++i)
+		out[i] = ParticleSystemRandomUInt32(seeds[i], randomId);
+}
+
+void GenerateRandomBatch(const UInt32* seeds, UInt32 randomId, float* out, size_t count)
+{
+	UInt32 random[4];
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		ParticleSystemRandomUInt32x4(seeds + i, randomId, random);
+		out[i + 0] = Rand::GetFloatFromInt(random[0]);
+		out[i + 1] = Rand::GetFloatFromInt(random[1]);
+		out[i + 2] = Rand::GetFloatFromInt(random[2]);
+		out[i + 3] = Rand::GetFloatFromInt(random[3]);
+	}
+	for (; i < count; ++i)
+		out[i] = GenerateRandom(seeds[i], randomId);
+}
+
+void GenerateRandomByteBatch(const UInt32* seeds, UInt32 randomId, UInt8* out, size_t count)
+{
+	UInt32 random[4];
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		ParticleSystemRandomUInt32x4(seeds + i, randomId, random);
+		out[i + 0] = Rand::GetByteFromInt(random[0]);
+		out[i + 1] = Rand::GetByteFromInt(random[1]);
+		out[i + 2] = Rand::GetByteFromInt(random[2]);
+		out[i + 3] = Rand::GetByteFromInt(random[3]);
+	}
+	for (; i < count; ++i)
+		out[i] = GenerateRandomByte(seeds[i], randomId);
+}
+
 Vector2f CalculateInverseLerpOffsetScale (const Vector2f& range)
 {
 	float scale = 1.0F / (range.y - range.x);
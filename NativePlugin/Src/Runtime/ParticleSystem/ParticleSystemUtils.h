@@ -2,6 +2,7 @@
 #define SHURIKENUTILS_H
 
 #include "ParticleSystemCommon.h"
+#include "ParticleSystemRandom.h"
 #include "Math/Vector2.h"
 #include "Math/Random/Random.h"
 #include "Utilities/Utility.h"
@@ -19,12 +20,18 @@ inline float InverseLerpFast01 (const Vector2f& scaleOffset, float v)
 	return clamp01 (v * scaleOffset.x + scaleOffset.y);
 }
 
-inline float GenerateRandom(UInt32 randomIn)
+inline float GenerateRandom(UInt32 seed, UInt32 randomId)
 {
-	Rand rand(randomIn);
-	return Random01(rand);
+	return Rand::GetFloatFromInt(ParticleSystemRandomUInt32(seed, randomId));
 }
 
+// out[i] = ParticleSystemRandomUInt32(seeds[i], randomId), four particles at a time
+void GenerateRandomUInt32Batch(const UInt32* seeds, UInt32 randomId, UInt32* out, size_t count);
+// out[i] = GenerateRandom(seeds[i], randomId), four particles at a time
+void GenerateRandomBatch(const UInt32* seeds, UInt32 randomId, float* out, size_t count);
+// out[i] = GenerateRandomByte(seeds[i], randomId), four particles at a time
+void GenerateRandomByteBatch(const UInt32* seeds, UInt32 randomId, UInt8* out, size_t count);
+
 inline void GenerateRandom3(Vector3f& randomOut, UInt32 randomIn)
 {
 	Rand rand(randomIn);
@@ -33,10 +40,9 @@ inline void GenerateRandom3(Vector3f& randomOut, UInt32 randomIn)
 	randomOut.z = Random01(rand);
 }
 
-inline UInt8 GenerateRandomByte (UInt32 seed)
+inline UInt8 GenerateRandomByte (UInt32 seed, UInt32 randomId)
 {
-	Rand rand (seed);
-	return Rand::GetByteFromInt (rand.Get ());
+	return Rand::GetByteFromInt (ParticleSystemRandomUInt32 (seed, randomId));
 }
 
 UInt32 GetGlobalRandomSeed ();
@@ -9,18 +9,6 @@ struct DualMinMaxPolyCurves
 	MinMaxPolyCurves rot;
 };
 
-template<ParticleSystemCurveEvalMode mode>
-void UpdateTpl(const MinMaxCurve& curve, ParticleSystemParticles& ps, const size_t fromIndex, const size_t toIndex)
-{
-	if ( !ps.usesRotationalSpeed ) return;
-	for (size_t q = fromIndex; q < toIndex; ++q)
-	{
-		const float time = NormalizedTime(ps, q);
-		const float random = GenerateRandom(ps.randomSeed[q] + kParticleSystemRotationCurveId);
-		ps.rotationalSpeed[q] += Evaluate<mode> (curve, time, random);
-	}
-}
-
 template<bool isOptimized>
 void UpdateProceduralTpl(const DualMinMaxPolyCurves& curves, ParticleSystemParticles& ps)
 {
@@ -28,7 +16,7 @@ void UpdateProceduralTpl(const DualMinMaxPolyCurves& curves, ParticleSystemParti
 	for (size_t q=0; q<count; q++)
 	{
 		float time = NormalizedTime(ps, q);
-		float random = GenerateRandom(ps.randomSeed[q] + kParticleSystemRotationCurveId);
+		float random = GenerateRandom(ps.randomSeed[q], kParticleSystemRotationCurveId);
 		float range = ps.startLifetime[q];
 		float value;
 		if(isOptimized)
@@ -42,7 +30,7 @@ void UpdateProceduralTpl(const DualMinMaxPolyCurves& curves, ParticleSystemParti
 RotationModule::RotationModule() : ParticleSystemModule(false)
 {}
 
-void RotationModule::Init(ParticleSystemInitState* initState)
+void RotationModule::Init(const ParticleSystemInitState* initState)
 {
     if (initState->rotationModuleEnable)
     {
@@ -57,15 +45,20 @@ void RotationModule::Init(ParticleSystemInitState* initState)
 
 void RotationModule::Update(const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, const size_t toIndex)
 {
-	if (m_Curve.minMaxState == kMMCScalar)
-		UpdateTpl<kEMScalar>(m_Curve, ps, fromIndex, toIndex);
-	else if(m_Curve.IsOptimized() && m_Curve.UsesMinMax())
-		UpdateTpl<kEMOptimizedMinMax>(m_Curve, ps, fromIndex, toIndex);
-	else if(m_Curve.IsOptimized())
-		UpdateTpl<kEMOptimized>(m_Curve, ps, fromIndex, toIndex);
-	else 
-		UpdateTpl<kEMSlow>(m_Curve, ps, fromIndex, toIndex);
+	if (!ps.usesRotationalSpeed)
+		return;
 
+	float time[kParticleSystemCurveBatchSize];
+	float value[kParticleSystemCurveBatchSize];
+	for (size_t from = fromIndex; from < toIndex; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, toIndex - from);
+		NormalizedTimeBatch(ps, from, count, time);
+		EvaluateBatch(m_Curve, time, &ps.randomSeed[from], value, count, kParticleSystemRotationCurveId);
+		float* rotationalSpeed = &ps.rotationalSpeed[from];
+		for (size_t i = 0; i < count; ++i)
+			rotationalSpeed[i] += value[i];
+	}
 }
 
 void RotationModule::UpdateProcedural (const ParticleSystemState& state, ParticleSystemParticles& ps)
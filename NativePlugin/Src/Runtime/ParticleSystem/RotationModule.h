@@ -9,7 +9,7 @@ class RotationModule : public ParticleSystemModule
 public:
 	RotationModule();
 
-    void Init(ParticleSystemInitState* initState);
+    void Init(const ParticleSystemInitState* initState);
 	void Update (const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const size_t fromIndex, const size_t toIndex);
 	void UpdateProcedural (const ParticleSystemState& state, ParticleSystemParticles& ps);
 	void CheckConsistency() {};
@@ -6,151 +6,80 @@
 //#include "Graphics/TriStripper.h"
 //#include "Geometry/ComputionalGeometry.h"
 
-enum MeshDistributionMode
-{
-    kDistributionVertex,
-    kDistributionTriangle,
-};
-
+// Random values a shape needs per particle at most (up to 4 for the position, 2 for a random direction)
+enum { kShapeMaxRandomValues = 6, kShapeRandomDirectionIndex = 4 };
 
-/// This gives a random barycentric coord (on the edge of triangle)
-// @TODO: Stupid: Make this in a faster way
-inline Vector3f RandomBarycentricCoordEdge(Rand& rand)
+// Same distribution as RandomUnitVector, from two uniform random values per vector
+static void SampleUnitVectors(const float* randomZ, const float* randomAngle, Vector3f* out, size_t count)
 {
-    float u = rand.GetFloat();
-    float v = rand.GetFloat();
-    if (u + v > 1.0F)
-    {
-        u = 1.0F - u;
-        v = 1.0F - v;
-    }
-    float w = 1.0F - u - v;
-
-    int edge = RangedRandom(rand, 0, 2);
-    if (0 == edge)
-    {
-        v += 0.5f * u;
-        w += 0.5f * u;
-        u = 0.0f;
-    }
-    else if (1 == edge)
-    {
-        u += 0.5f * v;
-        w += 0.5f * v;
-        v = 0.0f;
-    }
-    else
+    for (size_t i = 0; i < count; ++i)
     {
-        u += 0.5f * w;
-        v += 0.5f * w;
-        w = 0.0f;
+        const float z = 1.0f - 2.0f * randomZ[i];
+        const float a = (1.0f - randomAngle[i]) * 2.0F * kPI;
+        const float r = sqrt(1.0f - z * z);
+        out[i] = Vector3f(r * cos(a), r * sin(a), z);
     }
-
-    return Vector3f(u, v, w);
 }
 
-
-// TODO: It could make sense to initialize in separated loops. i.e. separate position and velcoity vectors
-inline void EmitterStoreData(const Matrix4x4f& localToWorld, const Vector3f& scale, ParticleSystemParticles& ps, size_t q, Vector3f& pos, Vector3f& n, Rand& random, bool randomDirection)
+// Same distribution as RandomUnitVector2
+static void SampleUnitVectors2(const float* randomAngle, Vector2f* out, size_t count)
 {
-    if (randomDirection)
-        n = RandomUnitVector(random);
-
-    n = NormalizeSafe(n);
-
-    pos = Scale(pos, scale);
-
-    Vector3f vel = Magnitude(ps.velocity[q]) * n;
-    vel = localToWorld.MultiplyVector3(vel);
-
-    // @TODO: Sooo... why multiply point and then undo the result of it? Why not just MultiplyVector?
-    pos = localToWorld.MultiplyPoint3(pos) - localToWorld.GetPosition();
-    ps.position[q] += pos;
-    ps.velocity[q] = vel;
-
-    if (ps.usesAxisOfRotation)
+    for (size_t i = 0; i < count; ++i)
     {
-        Vector3f tan = Cross(-n, Vector3f::zAxis);
-        if (SqrMagnitude(tan) <= 0.01)
-            tan = Cross(-pos, Vector3f::zAxis);
-        if (SqrMagnitude(tan) <= 0.01)
-            tan = Vector3f::yAxis;
-        ps.axisOfRotation[q] = Normalize(tan);
+        const float a = (1.0f - randomAngle[i]) * 2.0F * kPI;
+        out[i] = Vector2f(cos(a), sin(a));
     }
 }
 
-inline void EmitterStoreData(const Matrix4x4f& localToWorld, const Vector3f& scale, ParticleSystemParticles& ps, size_t q, Vector3f& pos, Vector3f& n, ColorRGBA32& color, Rand& random, bool randomDirection)
+// Same distribution as RandomPointInsideUnitCircle
+static void SamplePointsInsideUnitCircle(const float* randomAngle, const float* randomRadius, Vector2f* out, size_t count)
 {
-    EmitterStoreData(localToWorld, scale, ps, q, pos, n, random, randomDirection);
-    ps.color[q] *= color;
+    SampleUnitVectors2(randomAngle, out, count);
+    for (size_t i = 0; i < count; ++i)
+        out[i] *= sqrt(1.0f - randomRadius[i]);
 }
 
+// Emission direction for cones: points away from the axis by the cone angle
+static void ConeDirections(const Vector2f* directionXY, float sinA, float cosA, Vector3f* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = Vector3f(directionXY[i].x * sinA, directionXY[i].y * sinA, cosA);
+}
 
-template<MeshDistributionMode distributionMode>
-void GetPositionMesh(Vector3f& pos,
-    Vector3f& n,
-    ColorRGBA32& color,
-    const ParticleSystemEmitterMeshVertex* vertexData,
-    const int vertexCount,
-    const MeshTriangleData* triangleData,
-    const UInt32 numPrimitives,
-    float totalTriangleArea,
-    Rand& random,
-    bool edge)
+// Moves the sampled positions and directions from shape space into the particle streams.
+// Positions and directions are transformed in bulk; only the rotation/scale part of the matrix is needed for both,
+// as particles already start at the emitter position.
+static void EmitterStoreData(const Matrix4x4f& localToWorld, const Vector3f& scale, ParticleSystemParticles& ps, size_t from, size_t count, Vector3f* pos, Vector3f* n, Vector3f* temp)
 {
-    // position/normal of particle is vertex/vertex normal from mesh
-    if (kDistributionVertex == distributionMode)
+    for (size_t i = 0; i < count; ++i)
     {
-        int vertexIndex = RangedRandom(random, 0, vertexCount);
-        pos = vertexData[vertexIndex].position;
-        n = vertexData[vertexIndex].normal;
-        color = vertexData[vertexIndex].color;
+        n[i] = NormalizeSafe(n[i]);
+        pos[i] = Scale(pos[i], scale);
+        temp[i] = Magnitude(ps.velocity[from + i]) * n[i];
     }
-    else if (kDistributionTriangle == distributionMode)
-    {
-        float randomArea = RangedRandom(random, 0.0f, totalTriangleArea);
-        float accArea = 0.0f;
-        UInt32 triangleIndex = 0;
 
-        for (UInt32 i = 0; i < numPrimitives; i++)
+    TransformPoints3x3(localToWorld, temp, &ps.velocity[from], int(count));
+    TransformPoints3x3(localToWorld, pos, pos, int(count));
+
+    Vector3f* position = &ps.position[from];
+    for (size_t i = 0; i < count; ++i)
+        position[i] += pos[i];
+
+    if (ps.usesAxisOfRotation)
+    {
+        Vector3f* axisOfRotation = &ps.axisOfRotation[from];
+        for (size_t i = 0; i < count; ++i)
         {
-            const MeshTriangleData& data = triangleData[i];
-            accArea += data.area;
-            if (accArea >= randomArea)
-            {
-                triangleIndex = i;
-                break;
-            }
+            Vector3f tan = Cross(-n[i], Vector3f::zAxis);
+            if (SqrMagnitude(tan) <= 0.01)
+                tan = Cross(-pos[i], Vector3f::zAxis);
+            if (SqrMagnitude(tan) <= 0.01)
+                tan = Vector3f::yAxis;
+            axisOfRotation[i] = Normalize(tan);
         }
-
-        const MeshTriangleData& data = triangleData[triangleIndex];
-        UInt16 a = data.indices[0];
-        UInt16 b = data.indices[1];
-        UInt16 c = data.indices[2];
-
-        Vector3f barycenter;
-        if (edge)
-            barycenter = RandomBarycentricCoordEdge(random);
-        else
-            barycenter = RandomBarycentricCoord(random);
-
-        // Interpolate vertex with barycentric coordinate
-        pos = barycenter.x * vertexData[a].position + barycenter.y * vertexData[b].position + barycenter.z * vertexData[c].position;
-        n = barycenter.x * vertexData[a].normal + barycenter.y * vertexData[b].normal + barycenter.z * vertexData[c].normal;
-
-        // TODO: Don't convert to floats!!!
-        ColorRGBAf color1 = vertexData[a].color;
-        ColorRGBAf color2 = vertexData[b].color;
-        ColorRGBAf color3 = vertexData[c].color;
-        color = barycenter.x * color1 + barycenter.y * color2 + barycenter.z * color3;
     }
 }
 
-static bool CompareMeshTriangleData(const MeshTriangleData& a, const MeshTriangleData& b)
-{
-    return (a.area > b.area);
-}
-
 // ------------------------------------------------------------------------------------------
 
 // todo
@@ -164,15 +93,25 @@ ShapeModule::ShapeModule() : ParticleSystemModule(false)
 , m_BoxX(1.0f)
 , m_BoxY(1.0f)
 , m_BoxZ(1.0f)
+, m_MeshId(0)
+, m_MeshDistribution(kDistributionTriangle)
 , m_RandomDirection(false)
 {
 }
 
 void ShapeModule::Start(const ParticleSystemInitState& initState, const ParticleSystemState& state, ParticleSystemParticles& ps, const Matrix4x4f& matrix, size_t fromIndex, float t)
 {
-    const float normalizedT = t / initState.lengthInSec;
+    const size_t count = ps.array_size();
+    if (fromIndex >= count || m_Type < kSphere || m_Type >= kMax)
+        return;
 
-    Rand& random = GetRandom();
+    const ParticleSystemEmitterMesh* mesh = NULL;
+    if (m_Type == kMesh)
+    {
+        mesh = ParticleSystemEmitterMesh::Find(m_MeshId);
+        if (mesh == NULL || mesh->IsEmpty())
+            return;
+    }
 
     const float r = m_Radius;
 
@@ -181,127 +120,124 @@ void ShapeModule::Start(const ParticleSystemInitState& initState, const Particle
     float cosA = Cos(a);
     float length = m_Length;
 
-    const size_t count = ps.array_size();
-    switch (m_Type)
-    {
-    case kSphere:
+    const bool isCone = (m_Type == kCone || m_Type == kConeShell);
+    const bool randomDirection = m_RandomDirection && !isCone;
+    const int positionRandomValueCount = (m_Type == kMesh) ? (int)ParticleSystemEmitterMesh::kMaxRandomValues : 3;
+
+    // One value from the module's random stream per call, the particles use it as the counter for the stateless generator
+    const UInt32 counter = GetRandom().Get();
+
+    UInt32 particleCounter[kParticleSystemCurveBatchSize];
+    float random[kShapeMaxRandomValues][kParticleSystemCurveBatchSize];
+    Vector2f posXY[kParticleSystemCurveBatchSize];
+    Vector2f nXY[kParticleSystemCurveBatchSize];
+    Vector3f pos[kParticleSystemCurveBatchSize];
+    Vector3f n[kParticleSystemCurveBatchSize];
+    Vector3f temp[kParticleSystemCurveBatchSize];
+    ColorRGBA32 meshColor[kParticleSystemCurveBatchSize];
+
+    for (size_t from = fromIndex; from < count; from += kParticleSystemCurveBatchSize)
     {
-        for (size_t q = fromIndex; q < count; ++q)
+        const size_t batchCount = std::min<size_t>(kParticleSystemCurveBatchSize, count - from);
+
+        const UInt32 firstCounter = counter + UInt32(from - fromIndex);
+        for (size_t i = 0; i < batchCount; ++i)
+            particleCounter[i] = firstCounter + UInt32(i);
+        for (int k = 0; k < positionRandomValueCount; ++k)
+            GenerateRandomBatch(particleCounter, kParticleSystemShapeId + k, random[k], batchCount);
+        // Cones sample their random direction in the cone from these too
+        if (m_RandomDirection)
         {
-            Vector3f pos = RandomPointInsideUnitSphere(random) * r;
-            Vector3f n = pos;
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
+            GenerateRandomBatch(particleCounter, kParticleSystemShapeId + kShapeRandomDirectionIndex, random[kShapeRandomDirectionIndex], batchCount);
+            GenerateRandomBatch(particleCounter, kParticleSystemShapeId + kShapeRandomDirectionIndex + 1, random[kShapeRandomDirectionIndex + 1], batchCount);
         }
-        break;
-    }
-    case kSphereShell:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
+
+        switch (m_Type)
         {
-            Vector3f pos = RandomUnitVector(random) * r;
-            Vector3f n = pos;
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
-        }
-        break;
-    }
-    case kHemiSphere:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
+        case kSphere:
+        case kHemiSphere:
         {
-            Vector3f pos = RandomPointInsideUnitSphere(random) * r;
-            if (pos.z < 0.0f)
-                pos.z *= -1.0f;
-            Vector3f n = pos;
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
+            SampleUnitVectors(random[0], random[1], pos, batchCount);
+            for (size_t i = 0; i < batchCount; ++i)
+                pos[i] *= pow(random[2][i], 1.0F / 3.0F) * r;
+            break;
         }
-        break;
-    }
-    case kHemiSphereShell:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
+        case kSphereShell:
+        case kHemiSphereShell:
         {
-            Vector3f pos = RandomUnitVector(random) * r;
-            if (pos.z < 0.0f)
-                pos.z *= -1.0f;
-            Vector3f n = pos;
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
+            SampleUnitVectors(random[0], random[1], pos, batchCount);
+            for (size_t i = 0; i < batchCount; ++i)
+                pos[i] *= r;
+            break;
         }
-        break;
-    }
-    case kCone:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
+        case kCone:
+        case kConeShell:
         {
-            Vector2f posXY = RandomPointInsideUnitCircle(random);
-            Vector2f nXY;
-            if (m_RandomDirection)
-                nXY = RandomPointInsideUnitCircle(random) * sinA;
+            if (m_Type == kCone)
+                SamplePointsInsideUnitCircle(random[0], random[1], posXY, batchCount);
             else
-                nXY = Vector2f(posXY.x, posXY.y)* sinA;
-            Vector3f n(nXY.x, nXY.y, cosA);
-            Vector3f pos(posXY.x * r, posXY.y * r, 0.0f);
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, false);
-        }
-        break;
-    }
-    case kConeShell:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
-        {
-            Vector2f posXY = NormalizeSafe(RandomUnitVector2(random));
+                SampleUnitVectors2(random[0], posXY, batchCount);
 
-            Vector2f nXY;
             if (m_RandomDirection)
-                nXY = RandomPointInsideUnitCircle(random) * sinA;
+                SamplePointsInsideUnitCircle(random[kShapeRandomDirectionIndex], random[kShapeRandomDirectionIndex + 1], nXY, batchCount);
+            ConeDirections(m_RandomDirection ? nXY : posXY, sinA, cosA, n, batchCount);
+
+            for (size_t i = 0; i < batchCount; ++i)
+                pos[i] = Vector3f(posXY[i].x * r, posXY[i].y * r, 0.0f);
+            break;
+        }
+        case kConeVolume:
+        case kConeVolumeShell:
+        {
+            if (m_Type == kConeVolume)
+                SamplePointsInsideUnitCircle(random[0], random[1], posXY, batchCount);
             else
-                nXY = Vector2f(posXY.x, posXY.y)* sinA;
-            Vector3f n(nXY.x, nXY.y, cosA);
-            Vector3f pos(posXY.x * r, posXY.y * r, 0.0f);
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, false);
+                SampleUnitVectors2(random[0], posXY, batchCount);
+
+            ConeDirections(posXY, sinA, cosA, n, batchCount);
+            for (size_t i = 0; i < batchCount; ++i)
+                pos[i] = Vector3f(posXY[i].x * r, posXY[i].y * r, 0.0f) + length * random[2][i] * NormalizeSafe(n[i]);
+            break;
         }
-        break;
-    }
-    case kConeVolume:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
+        case kBox:
         {
-            Vector2f posXY = RandomPointInsideUnitCircle(random);
-            Vector2f nXY = Vector2f(posXY.x, posXY.y)* sinA;
-            Vector3f n(nXY.x, nXY.y, cosA);
-            Vector3f pos(posXY.x * r, posXY.y * r, 0.0f);
-            pos += length * Random01(random) * NormalizeSafe(n);
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
+            const Vector3f extents(0.5f * m_BoxX, 0.5f * m_BoxY, 0.5f * m_BoxZ);
+            for (size_t i = 0; i < batchCount; ++i)
+            {
+                pos[i] = Vector3f(extents.x - 2.0f * extents.x * random[0][i],
+                                  extents.y - 2.0f * extents.y * random[1][i],
+                                  extents.z - 2.0f * extents.z * random[2][i]);
+                n[i] = Vector3f::zAxis;
+            }
+            break;
         }
-        break;
-    }
-    case kConeVolumeShell:
-    {
-        for (size_t q = fromIndex; q < count; ++q)
+        case kMesh:
         {
-            Vector2f posXY = NormalizeSafe(RandomUnitVector2(random));
-            Vector2f nXY = Vector2f(posXY.x, posXY.y)* sinA;
-            Vector3f n(nXY.x, nXY.y, cosA);
-            Vector3f pos = Vector3f(posXY.x * r, posXY.y * r, 0.0f);
-            pos += length * Random01(random) * NormalizeSafe(n);
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
+            const float* meshRandom[ParticleSystemEmitterMesh::kMaxRandomValues] = { random[0], random[1], random[2], random[3] };
+            mesh->Sample(m_MeshDistribution, meshRandom, pos, n, meshColor, batchCount);
+            break;
         }
-        break;
-    }
-    case kBox:
-    {
-        const Vector3f extents(0.5f * m_BoxX, 0.5f * m_BoxY, 0.5f * m_BoxZ);
-        for (size_t q = fromIndex; q < count; ++q)
+        }
+
+        if (m_Type == kHemiSphere || m_Type == kHemiSphereShell)
+            for (size_t i = 0; i < batchCount; ++i)
+                pos[i].z = Abs(pos[i].z);
+
+        if (m_Type <= kHemiSphereShell)
+            std::copy(pos, pos + batchCount, n);
+
+        if (randomDirection)
+            SampleUnitVectors(random[kShapeRandomDirectionIndex], random[kShapeRandomDirectionIndex + 1], n, batchCount);
+
+        EmitterStoreData(matrix, *emitterScale, ps, from, batchCount, pos, n, temp);
+
+        if (m_Type == kMesh)
         {
-            Vector3f pos = RandomPointInsideCube(random, extents);
-            Vector3f n = Vector3f::zAxis;
-            EmitterStoreData(matrix, *emitterScale, ps, q, pos, n, random, m_RandomDirection);
+            ColorRGBA32* color = &ps.color[from];
+            for (size_t i = 0; i < batchCount; ++i)
+                color[i] *= meshColor[i];
         }
     }
-    break;
-    default:
-    {
-    }
-    }
 }
 
 void ShapeModule::CheckConsistency()
@@ -315,7 +251,7 @@ void ShapeModule::CheckConsistency()
     m_BoxZ = max(0.0f, m_BoxZ);
 }
 
-void ShapeModule::Init(ParticleSystemInitState* initState)
+void ShapeModule::Init(const ParticleSystemInitState* initState)
 {
     SetEnabled(initState->shapeModuleEnable);
 
@@ -3,21 +3,7 @@
 #include "ParticleSystemModule.h"
 #include "Math/Random/rand.h"
 #include "Utilities/LinkedList.h"
-
-struct MeshTriangleData
-{
-    float area;
-    UInt16 indices[3];
-};
-
-struct ParticleSystemEmitterMeshVertex
-{
-    Vector3f position;
-    Vector3f normal;
-    ColorRGBA32 color;
-};
-
-class Mesh;
+#include "ParticleSystemEmitterMesh.h"
 
 class ShapeModule : public ParticleSystemModule
 {
@@ -26,7 +12,7 @@ public:
 
     enum { kSphere, kSphereShell, kHemiSphere, kHemiSphereShell, kCone, kBox, kMesh, kConeShell, kConeVolume, kConeVolumeShell, kMax };
 
-    void Init(ParticleSystemInitState* initState);
+    void Init(const ParticleSystemInitState* initState);
     void ResetSeed(const ParticleSystemInitState& initState);
     //void CalculateProceduralBounds(MinMaxAABB& bounds, const Vector3f& emitterScale, Vector2f minMaxBounds) const; todo
 
@@ -35,6 +21,8 @@ public:
 
     inline void SetShapeType(int type) { m_Type = type; };
     inline void SetRadius(float radius) { m_Radius = radius; };
+    // Emits from the cached ParticleSystemEmitterMesh with the given id, see ParticleSystemEmitterMesh::Get
+    inline void SetMesh(int meshId, MeshDistributionMode distribution) { m_MeshId = meshId; m_MeshDistribution = distribution; };
 
 private:
     Rand& GetRandom();
@@ -49,6 +37,10 @@ private:
     float m_BoxY;
     float m_BoxZ;
 
+    // Mesh stuff
+    int m_MeshId;
+    MeshDistributionMode m_MeshDistribution;
+
     bool m_RandomDirection;
     Rand m_Random;
 };
@@ -2,21 +2,10 @@
 #include "SizeModule.h"
 #include "ParticleSystemUtils.h"
 
-template<ParticleSystemCurveEvalMode mode>
-void UpdateTpl(const MinMaxCurve& curve, const ParticleSystemParticles& ps, float* tempSize, size_t fromIndex, size_t toIndex)
-{
-	for (size_t q = fromIndex; q < toIndex; ++q)
-	{
-		const float time = NormalizedTime(ps, q);
-		const float random = GenerateRandom(ps.randomSeed[q] + kParticleSystemSizeCurveId);
-		tempSize[q] *= std::max<float>(0.0f, Evaluate<mode> (curve, time, random));
-	}
-}
-
 SizeModule::SizeModule() : ParticleSystemModule(false)
 {}
 
-void SizeModule::Init(ParticleSystemInitState* initState)
+void SizeModule::Init(const ParticleSystemInitState* initState)
 {
     if (initState->sizeModuleEnable)
     {
@@ -31,12 +20,14 @@ void SizeModule::Init(ParticleSystemInitState* initState)
 
 void SizeModule::Update (const ParticleSystemParticles& ps, float* tempSize, size_t fromIndex, size_t toIndex)
 {
-	if(m_Curve.minMaxState == kMMCScalar)
-		UpdateTpl<kEMScalar>(m_Curve, ps, tempSize, fromIndex, toIndex);
-	else if (m_Curve.IsOptimized() && m_Curve.UsesMinMax ())
-		UpdateTpl<kEMOptimizedMinMax>(m_Curve, ps, tempSize, fromIndex, toIndex);
-	else if(m_Curve.IsOptimized())
-		UpdateTpl<kEMOptimized>(m_Curve, ps, tempSize, fromIndex, toIndex);
-	else
-		UpdateTpl<kEMSlow>(m_Curve, ps, tempSize, fromIndex, toIndex);
+	float time[kParticleSystemCurveBatchSize];
+	float value[kParticleSystemCurveBatchSize];
+	for (size_t from = fromIndex; from < toIndex; from += kParticleSystemCurveBatchSize)
+	{
+		const size_t count = std::min<size_t>(kParticleSystemCurveBatchSize, toIndex - from);
+		NormalizedTimeBatch(ps, from, count, time);
+		EvaluateBatch(m_Curve, time, &ps.randomSeed[from], value, count, kParticleSystemSizeCurveId);
+		for (size_t i = 0; i < count; ++i)
+			tempSize[from + i] *= std::max<float>(0.0f, value[i]);
+	}
 }
@@ -6,7 +6,7 @@ template<ParticleSystemCurveEvalMode mode>
 void UpdateWholeSheetTpl(float cycles, const MinMaxCurve& curve, const ParticleSystemParticles& ps, float* tempSheetIndex, size_t fromIndex, size_t toIndex)
 {
 	for (size_t q = fromIndex; q < toIndex; ++q)
-		tempSheetIndex[q] = Repeat (cycles * Evaluate(curve, NormalizedTime(ps, q), GenerateRandom(ps.randomSeed[q] + kParticleSystemUVCurveId)), 1.0f);
+		tempSheetIndex[q] = Repeat (cycles * Evaluate(curve, NormalizedTime(ps, q), GenerateRandom(ps.randomSeed[q], kParticleSystemUVCurveId)), 1.0f);
 }
 
 UVModule::UVModule () : ParticleSystemModule(false)
@@ -29,9 +29,9 @@ void UVModule::Update (const ParticleSystemParticles& ps, float* tempSheetIndex,
 		{
 			for (size_t q = fromIndex; q < toIndex; ++q)
 			{
-				const float t = cycles * Evaluate(m_Curve, NormalizedTime(ps, q), GenerateRandom(ps.randomSeed[q] + kParticleSystemUVCurveId));
+				const float t = cycles * Evaluate(m_Curve, NormalizedTime(ps, q), GenerateRandom(ps.randomSeed[q], kParticleSystemUVCurveId));
 				const float x = Repeat (t, 1.0f);
-				const float randomValue = GenerateRandom(ps.randomSeed[q] + kParticleSystemUVRowSelectionId);
+				const float randomValue = GenerateRandom(ps.randomSeed[q], kParticleSystemUVRowSelectionId);
 				const float startRow = Floorf (randomValue * rows);
 				float from = startRow * animRange;
 				float to = from + animRange;
@@ -45,7 +45,7 @@ void UVModule::Update (const ParticleSystemParticles& ps, float* tempSheetIndex,
 			float to = from + animRange;
 			for (size_t q = fromIndex; q < toIndex; ++q)
 			{
-				const float t = cycles * Evaluate(m_Curve, NormalizedTime(ps, q), GenerateRandom(ps.randomSeed[q] + kParticleSystemUVCurveId));
+				const float t = cycles * Evaluate(m_Curve, NormalizedTime(ps, q), GenerateRandom(ps.randomSeed[q], kParticleSystemUVCurveId));
 				const float x = Repeat (t, 1.0f);
 				tempSheetIndex[q] = Lerp (from, to, x);
 			}
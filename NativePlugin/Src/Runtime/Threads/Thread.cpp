@@ -43,6 +43,8 @@ UNITY_THREAD_FUNCTION_RETURN_SIGNATURE Thread::RunThreadWrapper (void* ptr)
 	
 	#if ENABLE_MEMORY_MANAGER
 	GetMemoryManager().ThreadCleanup();
+	#else
+	FlushThreadSmallBlockCache();
 	#endif
 
 	thread->m_Thread.Exit(thread, result);				// PlatformThread (Posix/Winapi/Custom)
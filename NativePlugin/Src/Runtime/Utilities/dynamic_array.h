@@ -282,6 +282,10 @@ public:
 
 	bool owns_data() { return (m_capacity & k_reference_bit) == 0; }
 
+	// Blocks are freed with the label they were allocated with, only change the label while empty
+	void set_memory_label(MemLabelRef label) { m_label = label; }
+	MemLabelId get_memory_label() const { return m_label; }
+
 	bool equals(const dynamic_array& other) const
 	{
 		if(m_size != other.m_size)
@@ -0,0 +1,476 @@
+// Replays a stream written by AllocationTracer (see Src/Runtime/Allocator/AllocationTraceFormat.h) and reports
+// fragmentation, pool occupancy and hot allocation sites.
+//
+// usage: AllocationTraceReplay <trace> [-top count] [-timeline seconds] [-e plugin binary]
+//
+// Counts and bytes of sampled traces are scaled by the sample interval. Holes between blocks are only exact
+// for traces taken with a sample interval of 1, with sampling they are an upper bound.
+
+#include "PrefixConfigure.h"
+#include "Allocator/AllocationTraceFormat.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// Without pool events (plugin built without the MemoryManager) live blocks are grouped into regions of this size
+static const UInt64 kHeapRegionSize = 1024 * 1024;
+
+struct LiveBlock
+{
+	UInt64 size;
+	UInt16 label;
+	UInt32 site;
+};
+
+struct AllocationSite
+{
+	std::vector<UInt64> frames;
+	UInt16 label;
+	UInt64 allocations;
+	UInt64 bytes;
+	UInt64 liveCount;
+	UInt64 liveBytes;
+};
+
+struct LabelTotals
+{
+	LabelTotals() : allocations(0), deallocations(0), liveCount(0), liveBytes(0), peakLiveBytes(0) {}
+
+	UInt64 allocations;
+	UInt64 deallocations;
+	UInt64 liveCount;
+	UInt64 liveBytes;
+	UInt64 peakLiveBytes;
+};
+
+struct RegionStats
+{
+	UInt64 base;
+	UInt64 size;
+	UInt64 usedBytes;
+	UInt64 blockCount;
+	UInt64 freeBytes;
+	UInt64 largestHole;
+};
+
+typedef std::map<UInt64, LiveBlock> LiveBlockMap;
+typedef std::map<UInt64, UInt64> PoolMap;
+
+struct Replay
+{
+	Replay() : sampleInterval(1), moduleBase(0), timestampFrequency(1), firstTimestamp(0), lastTimestamp(0),
+		eventCount(0), unmatchedDeallocations(0), reusedAddresses(0), threadCount(0) {}
+
+	UInt32 sampleInterval;
+	UInt64 moduleBase;
+	UInt64 timestampFrequency;
+	std::vector<std::string> labelNames;
+
+	LiveBlockMap live;
+	PoolMap pools;
+	std::vector<AllocationSite> sites;
+	std::map<std::vector<UInt64>, UInt32> siteIndex;
+	std::vector<LabelTotals> labels;
+
+	UInt64 firstTimestamp;
+	UInt64 lastTimestamp;
+	UInt64 eventCount;
+	UInt64 unmatchedDeallocations;	// Blocks allocated before the trace started
+	UInt64 reusedAddresses;			// Allocations at an address that was still live, counted as a deallocation first
+	UInt32 threadCount;
+};
+
+static const char* GetLabelName(const Replay& replay, int label)
+{
+	if (label >= 0 && label < (int)replay.labelNames.size())
+		return replay.labelNames[label].c_str();
+	return label == kAllocationTraceNoLabel ? "Pool" : "Unknown";
+}
+
+static double ToSeconds(const Replay& replay, UInt64 timestamp)
+{
+	return double(timestamp - replay.firstTimestamp) / double(replay.timestampFrequency);
+}
+
+static double Scaled(const Replay& replay, UInt64 value)
+{
+	return double(value) * double(replay.sampleInterval);
+}
+
+static void ReleaseBlock(Replay& replay, LiveBlockMap::iterator it)
+{
+	const LiveBlock& block = it->second;
+	LabelTotals& totals = replay.labels[block.label];
+	totals.deallocations++;
+	totals.liveCount--;
+	totals.liveBytes -= block.size;
+
+	AllocationSite& site = replay.sites[block.site];
+	site.liveCount--;
+	site.liveBytes -= block.size;
+	replay.live.erase(it);
+}
+
+static void ReplayRecord(Replay& replay, const AllocationTraceRecord& record, const std::vector<UInt64>& frames)
+{
+	if (replay.eventCount++ == 0)
+		replay.firstTimestamp = record.timestamp;
+	replay.lastTimestamp = record.timestamp;
+	replay.threadCount = std::max(replay.threadCount, record.thread);
+
+	if (record.type == kAllocationTracePoolCreate)
+	{
+		replay.pools[record.address] = record.size;
+		return;
+	}
+	if (record.type == kAllocationTracePoolDestroy)
+	{
+		replay.pools.erase(record.address);
+		return;
+	}
+
+	const UInt16 label = record.label < replay.labels.size() ? record.label : UInt16(replay.labels.size() - 1);
+	if (record.type == kAllocationTraceDeallocate)
+	{
+		LiveBlockMap::iterator it = replay.live.find(record.address);
+		if (it == replay.live.end())
+			replay.unmatchedDeallocations++;
+		else
+			ReleaseBlock(replay, it);
+		return;
+	}
+
+	LiveBlockMap::iterator previous = replay.live.find(record.address);
+	if (previous != replay.live.end())
+	{
+		replay.reusedAddresses++;
+		ReleaseBlock(replay, previous);
+	}
+
+	std::map<std::vector<UInt64>, UInt32>::iterator siteIt = replay.siteIndex.find(frames);
+	if (siteIt == replay.siteIndex.end())
+	{
+		AllocationSite site;
+		site.frames = frames;
+		site.label = label;
+		site.allocations = site.bytes = site.liveCount = site.liveBytes = 0;
+		siteIt = replay.siteIndex.insert(std::make_pair(frames, UInt32(replay.sites.size()))).first;
+		replay.sites.push_back(site);
+	}
+
+	AllocationSite& site = replay.sites[siteIt->second];
+	site.allocations++;
+	site.bytes += record.size;
+	site.liveCount++;
+	site.liveBytes += record.size;
+
+	LabelTotals& totals = replay.labels[label];
+	totals.allocations++;
+	totals.liveCount++;
+	totals.liveBytes += record.size;
+	totals.peakLiveBytes = std::max(totals.peakLiveBytes, totals.liveBytes);
+
+	LiveBlock block;
+	block.size = record.size;
+	block.label = label;
+	block.site = siteIt->second;
+	replay.live[record.address] = block;
+}
+
+// Used bytes and holes of the live blocks in [base, base + size). Regions without pool events only know the
+// blocks, so their holes are measured between the first and the last block.
+static RegionStats AnalyzeRegion(const Replay& replay, UInt64 base, UInt64 size, bool isPool)
+{
+	RegionStats stats;
+	stats.base = base;
+	stats.size = size;
+	stats.usedBytes = stats.blockCount = stats.freeBytes = stats.largestHole = 0;
+
+	const UInt64 end = base + size;
+	UInt64 cursor = base;
+	bool first = true;
+	for (LiveBlockMap::const_iterator it = replay.live.lower_bound(base); it != replay.live.end() && it->first < end; ++it)
+	{
+		const UInt64 blockEnd = std::min(it->first + it->second.size, end);
+		if (it->first > cursor && (isPool || !first))
+		{
+			const UInt64 hole = it->first - cursor;
+			stats.freeBytes += hole;
+			stats.largestHole = std::max(stats.largestHole, hole);
+		}
+		stats.usedBytes += blockEnd - it->first;
+		stats.blockCount++;
+		cursor = std::max(cursor, blockEnd);
+		first = false;
+	}
+
+	if (isPool && end > cursor)
+	{
+		stats.freeBytes += end - cursor;
+		stats.largestHole = std::max(stats.largestHole, end - cursor);
+	}
+	return stats;
+}
+
+static void CollectRegions(const Replay& replay, std::vector<RegionStats>& regions)
+{
+	regions.clear();
+	if (!replay.pools.empty())
+	{
+		for (PoolMap::const_iterator it = replay.pools.begin(); it != replay.pools.end(); ++it)
+			regions.push_back(AnalyzeRegion(replay, it->first, it->second, true));
+		return;
+	}
+
+	UInt64 region = ~UInt64(0);
+	for (LiveBlockMap::const_iterator it = replay.live.begin(); it != replay.live.end(); ++it)
+	{
+		const UInt64 base = it->first & ~(kHeapRegionSize - 1);
+		if (base == region)
+			continue;
+		region = base;
+		regions.push_back(AnalyzeRegion(replay, base, kHeapRegionSize, false));
+	}
+}
+
+// External fragmentation: 1 - largest hole / free bytes, weighted by the free bytes of every region
+static double GetFragmentation(const std::vector<RegionStats>& regions)
+{
+	double weighted = 0.0;
+	double freeBytes = 0.0;
+	for (size_t i = 0; i < regions.size(); ++i)
+	{
+		if (regions[i].freeBytes == 0)
+			continue;
+		weighted += double(regions[i].freeBytes - regions[i].largestHole);
+		freeBytes += double(regions[i].freeBytes);
+	}
+	return freeBytes > 0.0 ? weighted / freeBytes : 0.0;
+}
+
+static UInt64 GetLiveBytes(const Replay& replay)
+{
+	UInt64 total = 0;
+	for (size_t i = 0; i < replay.labels.size(); ++i)
+		total += replay.labels[i].liveBytes;
+	return total;
+}
+
+static void PrintTimelineLine(const Replay& replay, UInt64 timestamp)
+{
+	std::vector<RegionStats> regions;
+	CollectRegions(replay, regions);
+	UInt64 reserved = 0;
+	for (PoolMap::const_iterator it = replay.pools.begin(); it != replay.pools.end(); ++it)
+		reserved += it->second;
+
+	printf("%10.2f %14.0f %14llu %8zu %13.3f\n", ToSeconds(replay, timestamp), Scaled(replay, GetLiveBytes(replay)),
+		(unsigned long long)reserved, regions.size(), GetFragmentation(regions));
+}
+
+static std::string Symbolize(const Replay& replay, const char* binary, UInt64 frame, std::map<UInt64, std::string>& cache)
+{
+	char buffer[512];
+	const UInt64 offset = frame >= replay.moduleBase ? frame - replay.moduleBase : frame;
+	snprintf(buffer, sizeof(buffer), "0x%llx", (unsigned long long)offset);
+	if (binary == NULL)
+		return buffer;
+
+	std::map<UInt64, std::string>::iterator it = cache.find(offset);
+	if (it != cache.end())
+		return it->second;
+
+	// Return addresses point after the call, step back into it for the line
+	char command[1024];
+	snprintf(command, sizeof(command), "addr2line -f -C -e '%s' 0x%llx", binary, (unsigned long long)(offset > 0 ? offset - 1 : 0));
+	std::string result = buffer;
+	if (FILE* pipe = popen(command, "r"))
+	{
+		char function[512], line[512];
+		if (fgets(function, sizeof(function), pipe) && fgets(line, sizeof(line), pipe))
+		{
+			function[strcspn(function, "\n")] = 0;
+			line[strcspn(line, "\n")] = 0;
+			if (strcmp(function, "??") != 0)
+				result = std::string(function) + " (" + line + ")";
+		}
+		pclose(pipe);
+	}
+	cache[offset] = result;
+	return result;
+}
+
+struct SiteAllocationsGreater
+{
+	const Replay* replay;
+	bool operator()(UInt32 a, UInt32 b) const { return replay->sites[a].allocations > replay->sites[b].allocations; }
+};
+
+struct SiteLiveBytesGreater
+{
+	const Replay* replay;
+	bool operator()(UInt32 a, UInt32 b) const { return replay->sites[a].liveBytes > replay->sites[b].liveBytes; }
+};
+
+template<class Compare>
+static void PrintSites(const Replay& replay, const char* title, Compare compare, size_t top, const char* binary, std::map<UInt64, std::string>& symbols)
+{
+	std::vector<UInt32> order(replay.sites.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = UInt32(i);
+	std::sort(order.begin(), order.end(), compare);
+
+	printf("\n%s\n", title);
+	for (size_t i = 0; i < order.size() && i < top; ++i)
+	{
+		const AllocationSite& site = replay.sites[order[i]];
+		printf("#%zu %s: %.0f allocations, %.0f bytes, %.0f live (%.0f bytes)\n", i + 1, GetLabelName(replay, site.label),
+			Scaled(replay, site.allocations), Scaled(replay, site.bytes), Scaled(replay, site.liveCount), Scaled(replay, site.liveBytes));
+		for (size_t f = 0; f < site.frames.size(); ++f)
+			printf("    %s\n", Symbolize(replay, binary, site.frames[f], symbols).c_str());
+	}
+}
+
+static bool ReadHeader(FILE* file, Replay& replay)
+{
+	AllocationTraceHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.tag, kAllocationTraceTag, sizeof(header.tag)) != 0)
+	{
+		fprintf(stderr, "Not an allocation trace\n");
+		return false;
+	}
+	if (header.version != kAllocationTraceVersion)
+	{
+		fprintf(stderr, "Unsupported trace version %u\n", header.version);
+		return false;
+	}
+
+	replay.sampleInterval = std::max<UInt32>(header.sampleInterval, 1);
+	replay.moduleBase = header.moduleBase;
+	replay.timestampFrequency = std::max<UInt64>(header.timestampFrequency, 1);
+	for (UInt32 i = 0; i < header.labelCount; ++i)
+	{
+		UInt8 length = 0;
+		char name[256];
+		if (fread(&length, 1, 1, file) != 1 || fread(name, 1, length, file) != length)
+			return false;
+		replay.labelNames.push_back(std::string(name, length));
+	}
+
+	// One more slot for labels out of range
+	replay.labels.resize(replay.labelNames.size() + 1);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = NULL;
+	const char* binary = NULL;
+	size_t top = 10;
+	double timelineInterval = 0.0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-top") == 0 && i + 1 < argc)
+			top = (size_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-timeline") == 0 && i + 1 < argc)
+			timelineInterval = atof(argv[++i]);
+		else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+			binary = argv[++i];
+		else if (path == NULL && argv[i][0] != '-')
+			path = argv[i];
+		else
+			path = NULL, i = argc;
+	}
+	if (path == NULL)
+	{
+		fprintf(stderr, "usage: %s <trace> [-top count] [-timeline seconds] [-e plugin binary]\n", argv[0]);
+		return 1;
+	}
+
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Can't open %s\n", path);
+		return 1;
+	}
+
+	Replay replay;
+	if (!ReadHeader(file, replay))
+	{
+		fclose(file);
+		return 1;
+	}
+
+	if (timelineInterval > 0.0)
+		printf("%10s %14s %14s %8s %13s\n", "seconds", "live bytes", "pool bytes", "regions", "fragmentation");
+
+	AllocationTraceRecord record;
+	std::vector<UInt64> frames;
+	double nextTimeline = 0.0;
+	UInt64 lastTimelineEvent = 0;
+	bool truncated = false;
+	while (fread(&record, sizeof(record), 1, file) == 1)
+	{
+		frames.resize(std::min<int>(record.frameCount, kAllocationTraceMaxFrames));
+		if (!frames.empty() && fread(&frames[0], sizeof(UInt64), frames.size(), file) != frames.size())
+		{
+			truncated = true;
+			break;
+		}
+
+		if (timelineInterval > 0.0 && replay.eventCount != 0 && ToSeconds(replay, record.timestamp) >= nextTimeline)
+		{
+			PrintTimelineLine(replay, record.timestamp);
+			lastTimelineEvent = replay.eventCount;
+			nextTimeline = (std::floor(ToSeconds(replay, record.timestamp) / timelineInterval) + 1.0) * timelineInterval;
+		}
+		ReplayRecord(replay, record, frames);
+	}
+	fclose(file);
+	if (timelineInterval > 0.0 && replay.eventCount != lastTimelineEvent)
+		PrintTimelineLine(replay, replay.lastTimestamp);
+
+	printf("\n%s: %llu events over %.2f seconds from %u threads, sample interval %u%s\n", path, (unsigned long long)replay.eventCount,
+		replay.eventCount != 0 ? ToSeconds(replay, replay.lastTimestamp) : 0.0, replay.threadCount, replay.sampleInterval, truncated ? ", truncated" : "");
+	if (replay.unmatchedDeallocations != 0 || replay.reusedAddresses != 0)
+		printf("%llu deallocations of blocks from before the trace, %llu allocations at live addresses\n",
+			(unsigned long long)replay.unmatchedDeallocations, (unsigned long long)replay.reusedAddresses);
+
+	printf("\n%-28s %14s %14s %12s %16s %16s\n", "label", "allocations", "deallocations", "live", "live bytes", "peak live bytes");
+	for (size_t i = 0; i < replay.labels.size(); ++i)
+	{
+		const LabelTotals& totals = replay.labels[i];
+		if (totals.allocations == 0 && totals.deallocations == 0)
+			continue;
+		printf("%-28s %14.0f %14.0f %12.0f %16.0f %16.0f\n", GetLabelName(replay, int(i)), Scaled(replay, totals.allocations),
+			Scaled(replay, totals.deallocations), Scaled(replay, totals.liveCount), Scaled(replay, totals.liveBytes), Scaled(replay, totals.peakLiveBytes));
+	}
+
+	std::vector<RegionStats> regions;
+	CollectRegions(replay, regions);
+	const bool hasPools = !replay.pools.empty();
+	printf("\n%s at the end of the trace\n", hasPools ? "Pools" : "Heap regions (no pool events in the trace)");
+	printf("%18s %12s %10s %12s %12s %12s %13s\n", "base", "size", "blocks", "used", "free", "largest hole", hasPools ? "occupancy" : "fragmentation");
+	for (size_t i = 0; i < regions.size(); ++i)
+	{
+		const RegionStats& region = regions[i];
+		const double last = hasPools ? std::min(1.0, Scaled(replay, region.usedBytes) / double(region.size))
+			: (region.freeBytes != 0 ? 1.0 - double(region.largestHole) / double(region.freeBytes) : 0.0);
+		printf("%#18llx %12llu %10.0f %12.0f %12llu %12llu %13.3f\n", (unsigned long long)region.base, (unsigned long long)region.size,
+			Scaled(replay, region.blockCount), Scaled(replay, region.usedBytes), (unsigned long long)region.freeBytes, (unsigned long long)region.largestHole, last);
+	}
+	printf("External fragmentation: %.3f%s\n", GetFragmentation(regions), replay.sampleInterval > 1 ? " (sampled trace, holes are overestimated)" : "");
+
+	std::map<UInt64, std::string> symbols;
+	SiteAllocationsGreater byAllocations = { &replay };
+	SiteLiveBytesGreater byLiveBytes = { &replay };
+	PrintSites(replay, "Hot allocation sites", byAllocations, top, binary, symbols);
+	PrintSites(replay, "Sites holding the most live memory", byLiveBytes, top, binary, symbols);
+	return 0;
+}